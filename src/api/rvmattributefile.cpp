@@ -0,0 +1,298 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#include "rvmattributefile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RVM_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    /// Trims a line in place, returns the trimmed size.
+    inline size_t trim(const char*& begin, const char* end) {
+        while (begin < end && isSpace(*begin)) {
+            begin++;
+        }
+        while (end > begin && isSpace(end[-1])) {
+            end--;
+        }
+        return end - begin;
+    }
+
+    /// Finds the end of the line starting at p, without the newline.
+    inline const char* lineEnd(const char* p, const char* end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        return eol ? eol : end;
+    }
+
+    /// Checks that no byte has its high bit set, 16 or 32 bytes at a time when possible.
+    inline bool isAscii(const char* p, size_t size) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 32 <= size; i += 32) {
+            if (_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)))) {
+                return false;
+            }
+        }
+#endif
+#if defined(RVM_SSE2)
+        for (; i + 16 <= size; i += 16) {
+            if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)))) {
+                return false;
+            }
+        }
+#endif
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, p + i, 8);
+            if (word & 0x8080808080808080ull) {
+                return false;
+            }
+        }
+        for (; i < size; i++) {
+            if (uint8_t(p[i]) >= 0x80) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Appends ISO 8859-1 text converted to UTF-8, without reallocating: out has to be reserved.
+    void latin_to_utf8(const char* latin, size_t size, vector<char>& out) {
+        for (size_t i = 0; i < size; i++) {
+            const uint8_t c = latin[i];
+            if (c < 0x80) {
+                out.push_back(c);
+            } else {
+                // Found non-ASCII character, assume ISO 8859-1
+                out.push_back(0xc0 | (c & 0xc0) >> 6);
+                out.push_back(0x80 | (c & 0x3f));
+            }
+        }
+    }
+
+    /// Number of parsed blocks the background thread can hold ahead of the parser
+    const size_t QUEUE_SIZE = 256;
+
+    const size_t NO_BLOCK = size_t(-1);
+
+}
+
+RVMAttributeFile::RVMAttributeFile() :
+    m_useFilterExpression(false),
+    m_nextBlock(0),
+    m_parsedBlock(NO_BLOCK),
+    m_stop(false) {
+}
+
+RVMAttributeFile::~RVMAttributeFile() {
+    close();
+}
+
+bool RVMAttributeFile::open(const string& filename) {
+    close();
+    if (!m_file.open(filename)) {
+        return false;
+    }
+
+    const char* const end = m_file.data() + m_file.size();
+    const char* p = m_file.data();
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        const char* line = p;
+        const size_t size = trim(line, eol);
+        if (size > 4 && memcmp(line, "NEW ", 4) == 0) {
+            Blocks& blocks = m_blocks[string(line + 4, size - 4)];
+            blocks.next = 0;
+            blocks.numbers.push_back(m_offsets.size());
+            // The block starts on the next line
+            m_offsets.push_back(eol - m_file.data() + 1);
+        }
+        p = eol + 1;
+    }
+
+    m_stop = false;
+    m_nextBlock = 0;
+    m_parsedBlock = NO_BLOCK;
+    if (!m_offsets.empty()) {
+        m_producer = thread(&RVMAttributeFile::produce, this);
+    }
+    return true;
+}
+
+void RVMAttributeFile::close() {
+    if (m_producer.joinable()) {
+        {
+            lock_guard<mutex> guard(m_lock);
+            m_stop = true;
+        }
+        m_changed.notify_all();
+        m_producer.join();
+    }
+    m_queue.clear();
+    m_free.clear();
+    m_offsets.clear();
+    m_blocks.clear();
+    m_file.close();
+}
+
+void RVMAttributeFile::setFilter(const vector<string>& names) {
+    m_filterNames = names;
+    sort(m_filterNames.begin(), m_filterNames.end());
+    m_useFilterExpression = false;
+}
+
+void RVMAttributeFile::setFilter(const regex& expression) {
+    m_filterNames.clear();
+    m_filterExpression = expression;
+    m_useFilterExpression = true;
+}
+
+bool RVMAttributeFile::accept(string_view name) const {
+    if (m_useFilterExpression) {
+        return regex_match(name.begin(), name.end(), m_filterExpression);
+    }
+    return m_filterNames.empty() || binary_search(m_filterNames.begin(), m_filterNames.end(), name);
+}
+
+void RVMAttributeFile::produce() {
+    unique_lock<mutex> guard(m_lock);
+    while (true) {
+        m_changed.wait(guard, [this]() { return m_stop || m_queue.size() < QUEUE_SIZE; });
+        if (m_stop || m_nextBlock >= m_offsets.size()) {
+            return;
+        }
+        Batch batch;
+        if (!m_free.empty()) {
+            batch.attributes = std::move(m_free.back());
+            m_free.pop_back();
+        }
+        batch.number = m_nextBlock++;
+        m_parsedBlock = batch.number;
+        guard.unlock();
+
+        parseBlock(batch.number, batch.attributes);
+
+        guard.lock();
+        m_parsedBlock = NO_BLOCK;
+        m_queue.push_back(std::move(batch));
+        m_changed.notify_all();
+    }
+}
+
+void RVMAttributeFile::recycle(Attributes& attributes) {
+    if (m_free.size() < QUEUE_SIZE) {
+        attributes.clear();
+        m_free.push_back(std::move(attributes));
+    }
+}
+
+bool RVMAttributeFile::read(const string& name, Attributes& attributes) {
+    attributes.clear();
+    auto it = m_blocks.find(name);
+    if (it == m_blocks.end() || it->second.next >= it->second.numbers.size()) {
+        return false;
+    }
+    const size_t number = it->second.numbers[it->second.next++];
+
+    if (m_producer.joinable()) {
+        unique_lock<mutex> guard(m_lock);
+        while (true) {
+            // Blocks before the requested one are not needed any more
+            while (!m_queue.empty() && m_queue.front().number < number) {
+                recycle(m_queue.front().attributes);
+                m_queue.pop_front();
+            }
+            m_changed.notify_all();
+            if (!m_queue.empty() && m_queue.front().number == number) {
+                swap(attributes, m_queue.front().attributes);
+                recycle(m_queue.front().attributes);
+                m_queue.pop_front();
+                return true;
+            }
+            if (m_parsedBlock != number) {
+                break;
+            }
+            m_changed.wait(guard);
+        }
+        // Not parsed yet: read it here and let the background thread go on after it.
+        // Otherwise, the block was skipped earlier, read it again.
+        if (m_nextBlock <= number) {
+            m_nextBlock = number + 1;
+            m_changed.notify_all();
+        }
+    }
+
+    parseBlock(number, attributes);
+    return true;
+}
+
+void RVMAttributeFile::parseBlock(size_t number, Attributes& attributes) const {
+    attributes.clear();
+
+    // Key/value lines, up to the first line that is not an attribute
+    const char* const end = m_file.data() + m_file.size();
+    const char* p = m_file.data() + m_offsets[number];
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        const char* begin = p;
+        size_t size = trim(begin, eol);
+        if (!isAscii(begin, size)) {
+            // The converted block can not be larger than twice the text up to the next block
+            vector<char>& text = attributes.m_text;
+            if (text.empty()) {
+                const size_t next = number + 1 < m_offsets.size() ? m_offsets[number + 1] : m_file.size();
+                text.reserve(2 * (next - m_offsets[number]));
+            }
+            const size_t offset = text.size();
+            latin_to_utf8(begin, size, text);
+            begin = text.data() + offset;
+            size = text.size() - offset;
+        }
+        const string_view line(begin, size);
+        const size_t i = line.find(":=");
+        if (i == string_view::npos) {
+            break;
+        }
+        const string_view key = line.substr(0, i);
+        if (accept(key)) {
+            // The value starts after ":=" and a space
+            attributes.m_pairs.emplace_back(key, i + 4 <= size ? line.substr(i + 4) : string_view());
+        }
+        p = eol + 1;
+    }
+}
@@ -0,0 +1,152 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#ifndef RVMATTRIBUTEFILE_H
+#define RVMATTRIBUTEFILE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rvmmappedfile.h"
+
+/**
+ * @brief Attribute companion file (.att) of an RVM file.
+ *
+ * The file is memory mapped and indexed once: each "NEW <name>" line is recorded in a hash table,
+ * so the attributes of a group are found directly, whatever the order of the groups in the file.
+ * When several blocks have the same name, they are returned in file order.
+ *
+ * Blocks are parsed ahead, in file order, by a background thread and handed over through a bounded queue.
+ * Blocks requested out of order are parsed on the calling thread.
+ *
+ * Attributes are not copied: they point into the mapped file, unless a line has non-ASCII characters
+ * and has to be converted to UTF-8. Buffers of consumed blocks are recycled.
+ */
+class RVMAttributeFile
+{
+    public:
+        /**
+         * @brief Key/value pairs of an attribute block, valid while the file is open.
+         */
+        class Attributes
+        {
+            public:
+                typedef std::pair<std::string_view, std::string_view> Pair;
+
+                std::vector<Pair>::const_iterator begin() const { return m_pairs.begin(); }
+                std::vector<Pair>::const_iterator end() const { return m_pairs.end(); }
+                size_t size() const { return m_pairs.size(); }
+                bool empty() const { return m_pairs.empty(); }
+                void clear() { m_pairs.clear(); m_text.clear(); }
+
+            private:
+                friend class RVMAttributeFile;
+
+                std::vector<Pair>   m_pairs;
+                /// Lines converted to UTF-8. Never grows past its reserved size, so that the views stay valid.
+                std::vector<char>   m_text;
+        };
+
+        RVMAttributeFile();
+        ~RVMAttributeFile();
+
+        /**
+         * @brief Maps and indexes an attribute file, then starts parsing it in the background.
+         * @param filename the file name
+         * @return true if the file could be opened.
+         */
+        bool open(const std::string& filename);
+        void close();
+        bool isOpen() const { return m_file.isOpen(); }
+
+        /**
+         * @brief Keeps only the named attributes. Has to be set before opening the file.
+         * @param names the attribute names, all attributes are kept if empty.
+         */
+        void setFilter(const std::vector<std::string>& names);
+        /**
+         * @brief Keeps only the attributes whose whole name matches a regular expression.
+         */
+        void setFilter(const std::regex& expression);
+        bool hasFilter() const { return !m_filterNames.empty() || m_useFilterExpression; }
+
+        /**
+         * @brief Reads the next attribute block of a group.
+         * @param name the group name.
+         * @param attributes receives the key/value pairs, converted to UTF-8.
+         * @return true if a block was found for this name.
+         */
+        bool read(const std::string& name, Attributes& attributes);
+
+    private:
+        RVMAttributeFile(const RVMAttributeFile&) = delete;
+        RVMAttributeFile& operator=(const RVMAttributeFile&) = delete;
+
+        /// Numbers of the blocks of a name, in file order, and the next one to read.
+        struct Blocks
+        {
+            std::vector<size_t>     numbers;
+            size_t                  next;
+        };
+
+        /// Attributes of a block, parsed by the background thread.
+        struct Batch
+        {
+            size_t                  number;
+            Attributes              attributes;
+        };
+
+        void parseBlock(size_t number, Attributes& attributes) const;
+        bool accept(std::string_view name) const;
+        /// Keeps the buffers of a consumed block for a next one, must be called with the lock held.
+        void recycle(Attributes& attributes);
+        void produce();
+
+        RVMMappedFile                               m_file;
+        /// Sorted attribute names to keep
+        std::vector<std::string>                    m_filterNames;
+        std::regex                                  m_filterExpression;
+        bool                                        m_useFilterExpression;
+        /// Position of the first line of each block
+        std::vector<size_t>                         m_offsets;
+        std::unordered_map<std::string, Blocks>     m_blocks;
+
+        std::thread                                 m_producer;
+        std::mutex                                  m_lock;
+        std::condition_variable                     m_changed;
+        std::deque<Batch>                           m_queue;
+        /// Consumed blocks, whose buffers are reused
+        std::vector<Attributes>                     m_free;
+        /// Next block to be parsed by the background thread, and the one being parsed
+        size_t                                      m_nextBlock;
+        size_t                                      m_parsedBlock;
+        bool                                        m_stop;
+};
+
+#endif // RVMATTRIBUTEFILE_H
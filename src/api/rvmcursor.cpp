@@ -0,0 +1,173 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#include "rvmcursor.h"
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RVM_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+    inline uint32_t byteSwap(uint32_t word) {
+#if defined(__GNUC__)
+        return __builtin_bswap32(word);
+#else
+        return (word >> 24) | ((word >> 8) & 0xff00) | ((word << 8) & 0xff0000) | (word << 24);
+#endif
+    }
+
+    inline int firstBit(uint32_t mask) {
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return int(index);
+#else
+        int index = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+
+    /// First letters of the RVM keywords: HEAD, END, MODL, CNTB, CNTE, PRIM and COLR.
+    inline bool isKeywordStart(char c) {
+        return c == 'C' || c == 'E' || c == 'H' || c == 'M' || c == 'P';
+    }
+
+    /**
+     * Finds the first position of three zero bytes followed by the first letter of a keyword.
+     * Returns end if there is none.
+     */
+    const char* findCandidate(const char* p, const char* end) {
+#if defined(__AVX2__)
+        const __m256i zero256 = _mm256_setzero_si256();
+        for (; end - p >= 64; p += 32) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+            const uint64_t zeros = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero256)))
+                | uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, zero256)))) << 32;
+            __m256i la = _mm256_cmpeq_epi8(a, _mm256_set1_epi8('C'));
+            __m256i lb = _mm256_cmpeq_epi8(b, _mm256_set1_epi8('C'));
+            for (char c : { 'E', 'H', 'M', 'P' }) {
+                la = _mm256_or_si256(la, _mm256_cmpeq_epi8(a, _mm256_set1_epi8(c)));
+                lb = _mm256_or_si256(lb, _mm256_cmpeq_epi8(b, _mm256_set1_epi8(c)));
+            }
+            const uint64_t letters = uint32_t(_mm256_movemask_epi8(la)) | uint64_t(uint32_t(_mm256_movemask_epi8(lb))) << 32;
+            const uint32_t candidates = uint32_t(zeros & (zeros >> 1) & (zeros >> 2) & (letters >> 3));
+            if (candidates) {
+                return p + firstBit(candidates);
+            }
+        }
+#endif
+#if defined(RVM_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        for (; end - p >= 32; p += 16) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+            const uint32_t zeros = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)))
+                | uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(b, zero))) << 16;
+            __m128i la = _mm_cmpeq_epi8(a, _mm_set1_epi8('C'));
+            __m128i lb = _mm_cmpeq_epi8(b, _mm_set1_epi8('C'));
+            for (char c : { 'E', 'H', 'M', 'P' }) {
+                la = _mm_or_si128(la, _mm_cmpeq_epi8(a, _mm_set1_epi8(c)));
+                lb = _mm_or_si128(lb, _mm_cmpeq_epi8(b, _mm_set1_epi8(c)));
+            }
+            const uint32_t letters = uint32_t(_mm_movemask_epi8(la)) | uint32_t(_mm_movemask_epi8(lb)) << 16;
+            const uint32_t candidates = zeros & (zeros >> 1) & (zeros >> 2) & (letters >> 3) & 0xffff;
+            if (candidates) {
+                return p + firstBit(candidates);
+            }
+        }
+#endif
+        for (; end - p >= 4; ++p) {
+            if (p[0] == 0 && p[1] == 0 && p[2] == 0 && isKeywordStart(p[3])) {
+                return p;
+            }
+        }
+        return end;
+    }
+
+}
+
+bool RVMCursor::findIdentifier() {
+    Identifier id;
+    const char* p = m_current;
+    while ((p = findCandidate(p, m_end)) != m_end) {
+        m_current = p;
+        readIdentifier(id);
+        if (!id.empty() && id.isValid()) {
+            m_current = p;
+            m_failed = false;
+            return true;
+        }
+        ++p;
+    }
+    m_current = m_end;
+    return false;
+}
+
+void RVMCursor::decodeWords(const char* in, void* out, size_t count) {
+    char* dst = static_cast<char*>(out);
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i mask256 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 8 <= count; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(v, mask256));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(RVM_SSE2)
+    // No byte shuffle before SSSE3: swap the bytes of each 16 bit half, then the halves.
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflelo_epi16(_mm_shufflehi_epi16(v, 0xb1), 0xb1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), v);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        uint32_t word;
+        memcpy(&word, in + i * 4, 4);
+        word = byteSwap(word);
+        memcpy(dst + i * 4, &word, 4);
+    }
+}
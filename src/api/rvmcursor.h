@@ -0,0 +1,263 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#ifndef RVMCURSOR_H
+#define RVMCURSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief Four character RVM chunk identifier (HEAD, MODL, CNTB, PRIM, CNTE, COLR or END).
+ */
+struct Identifier
+{
+    inline bool operator==(const char* rhs) const
+    {
+        return chrs[0] == rhs[0] && chrs[1] == rhs[1]
+            && chrs[2] == rhs[2] && chrs[3] == rhs[3];
+    }
+
+    inline bool operator!=(const char* rhs) const
+    {
+        return chrs[0] != rhs[0] || chrs[1] != rhs[1]
+            || chrs[2] != rhs[2] || chrs[3] != rhs[3];
+    }
+
+    inline bool empty() const
+    {
+        return *chrs == 0;
+    }
+
+    bool isValid() const
+    {
+        static const char* const keywords[] = { "HEAD", "END", "MODL", "CNTB", "PRIM", "CNTE", "COLR" };
+        for (const char* keyword : keywords)
+            if (*this == keyword)
+                return true;
+
+        return false;
+    }
+
+    inline std::string toString() const
+    {
+        return std::string(chrs, chrs + 4);
+    }
+
+    char        chrs[4];
+};
+
+/**
+ * @brief The RVMCursor class
+ * A read position over a contiguous block of RVM data.
+ *
+ * The cursor does not own the data: it is either a memory mapped file (@see RVMMappedFile)
+ * or a buffer provided by the caller. All numbers are stored big endian in RVM files
+ * and are decoded directly from the bytes, without any intermediate copy.
+ *
+ * Reading past the end never throws: zeros are returned and the cursor is marked as failed,
+ * in the same way as an exhausted std::istream would behave.
+ */
+class RVMCursor
+{
+    public:
+        RVMCursor(const char* data, size_t size) :
+            m_begin(data),
+            m_current(data),
+            m_end(data + size),
+            m_failed(false) {
+        }
+
+        inline const char* begin() const { return m_begin; }
+        inline const char* current() const { return m_current; }
+        inline const char* end() const { return m_end; }
+
+        inline size_t size() const { return m_end - m_begin; }
+        inline size_t position() const { return m_current - m_begin; }
+        inline size_t remaining() const { return m_end - m_current; }
+        inline bool atEnd() const { return m_current == m_end; }
+        inline bool failed() const { return m_failed; }
+        /**
+         * @brief Resets the failed state, e.g. after moving back to valid data.
+         */
+        inline void clear() { m_failed = false; }
+
+        /**
+         * @brief Moves the cursor to an absolute position in the data.
+         */
+        inline void seek(size_t position) {
+            if (position > size()) {
+                m_failed = true;
+                position = size();
+            }
+            m_current = m_begin + position;
+        }
+
+        /**
+         * @brief Advances the cursor.
+         * @param bytes number of bytes to skip.
+         */
+        inline void skip(size_t bytes) {
+            if (request(bytes))
+                m_current += bytes;
+        }
+
+        /**
+         * @brief Checks that enough data is left. If not, the cursor is moved to the end and marked as failed.
+         * @return true if the requested number of bytes can be read.
+         */
+        inline bool request(size_t bytes) {
+            if (bytes <= remaining())
+                return true;
+            m_current = m_end;
+            m_failed = true;
+            return false;
+        }
+
+        /**
+         * @brief Reads a big endian 32 bit word.
+         */
+        inline uint32_t readUInt32() {
+            if (!request(4))
+                return 0;
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(m_current);
+            m_current += 4;
+            return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+
+        /**
+         * @brief Reads a big endian 32 bit float.
+         */
+        inline float readFloat() {
+            const uint32_t word = readUInt32();
+            float value;
+            memcpy(&value, &word, sizeof(value));
+            return value;
+        }
+
+        /**
+         * @brief Reads a run of big endian 32 bit floats.
+         * @param out receives the values, zeros if there is not enough data left.
+         * @param count number of values to read.
+         */
+        inline void readFloats(float* out, size_t count) {
+            if (!request(count * 4)) {
+                memset(out, 0, count * sizeof(float));
+                return;
+            }
+            decodeWords(m_current, out, count);
+            m_current += count * 4;
+        }
+
+        /**
+         * @brief Converts big endian 32 bit words to the byte order of the (little endian) host.
+         *
+         * Uses SSSE3 or AVX2 byte shuffles when the compiler targets them, and a scalar loop otherwise.
+         * @param in the big endian words, without any alignment requirement.
+         * @param out receives count native words (not aliasing in).
+         * @param count number of words.
+         */
+        static void decodeWords(const char* in, void* out, size_t count);
+
+        /**
+         * @brief Copies raw bytes, without any endianness conversion.
+         */
+        inline void readBytes(char* out, size_t bytes) {
+            if (!request(bytes)) {
+                memset(out, 0, bytes);
+                return;
+            }
+            memcpy(out, m_current, bytes);
+            m_current += bytes;
+        }
+
+        /**
+         * @brief Reads a chunk identifier.
+         *
+         * Each character is stored in the last byte of a 32 bit word whose first three bytes are zero.
+         * END is the only three letter identifier.
+         *
+         * @param id receives the identifier, empty if the data at the cursor position is not an identifier.
+         */
+        inline Identifier& readIdentifier(Identifier& id) {
+            char* chrs = id.chrs;
+            if (!request(12)) {
+                *chrs = 0;
+                return id;
+            }
+            for (int i = 0; i < 3; ++i, m_current += 4) {
+                // the first three bytes of the current double word have to be zero
+                if (m_current[0] != 0 || m_current[1] != 0 || m_current[2] != 0) {
+                    *chrs = 0;
+                    return id;
+                }
+                chrs[i] = m_current[3];
+            }
+
+            // check if we have the end identifier
+            if (chrs[0] == 'E' && chrs[1] == 'N' && chrs[2] == 'D') {
+                chrs[3] = 0;
+                return id;
+            }
+
+            if (remaining() < 4 || m_current[0] != 0 || m_current[1] != 0 || m_current[2] != 0) {
+                *chrs = 0;
+                return id;
+            }
+            chrs[3] = m_current[3];
+            m_current += 4;
+            return id;
+        }
+
+        /**
+         * @brief Moves the cursor to the next valid chunk identifier, starting at the current position.
+         *
+         * Candidates (three zero bytes followed by the first letter of a keyword) are searched
+         * 16 or 32 bytes at a time with SIMD compares when available, then checked one by one.
+         * @return true if an identifier was found, false if the end of the data was reached.
+         */
+        bool findIdentifier();
+
+        /**
+         * @brief Reads a string, stored as its length in words followed by the zero padded characters.
+         */
+        inline std::string& readString(std::string& str) {
+            const size_t size = size_t(readUInt32()) * 4;
+            if (!request(size)) {
+                str.clear();
+                return str;
+            }
+            const char* nul = static_cast<const char*>(memchr(m_current, 0, size));
+            str.assign(m_current, nul ? nul : m_current + size);
+            m_current += size;
+            return str;
+        }
+
+    private:
+        const char*     m_begin;
+        const char*     m_current;
+        const char*     m_end;
+        bool            m_failed;
+};
+
+#endif // RVMCURSOR_H
@@ -0,0 +1,238 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#include "rvmeventbuffer.h"
+
+#include <cstring>
+#include <type_traits>
+
+using namespace std;
+
+namespace {
+
+    template<typename T>
+    inline T primitive_(const float* values) {
+        T params;
+        memcpy(&params, values, sizeof(T));
+        return params;
+    }
+
+    inline std::array<float, 12> matrix_(const float* values) {
+        std::array<float, 12> matrix;
+        memcpy(matrix.data(), values, sizeof(float) * 12);
+        return matrix;
+    }
+
+}
+
+RVMEventBuffer::RVMEventBuffer() : RVMReader() {
+}
+
+RVMEventBuffer::~RVMEventBuffer() {
+}
+
+void RVMEventBuffer::push(EventType type, uint32_t integer) {
+    Event event;
+    event.type = type;
+    event.integer = integer;
+    event.string = m_strings.size();
+    event.value = m_values.size();
+    m_events.push_back(event);
+}
+
+void RVMEventBuffer::pushMatrix(const std::array<float, 12>& matrix) {
+    m_values.insert(m_values.end(), matrix.begin(), matrix.end());
+}
+
+template<typename T>
+void RVMEventBuffer::pushPrimitive(EventType type, const std::array<float, 12>& matrix, const T& params) {
+    static_assert(std::is_trivially_copyable<T>::value && sizeof(T) % sizeof(float) == 0, "Primitives are float arrays");
+    push(type);
+    pushMatrix(matrix);
+    const size_t size = m_values.size();
+    m_values.resize(size + sizeof(T) / sizeof(float));
+    memcpy(&m_values[size], &params, sizeof(T));
+}
+
+void RVMEventBuffer::startDocument() {
+    push(StartDocument);
+}
+
+void RVMEventBuffer::endDocument() {
+    push(EndDocument);
+}
+
+void RVMEventBuffer::startHeader(const string& banner, const string& fileNote, const string& date, const string& user, const string& encoding) {
+    push(StartHeader);
+    m_strings.push_back(banner);
+    m_strings.push_back(fileNote);
+    m_strings.push_back(date);
+    m_strings.push_back(user);
+    m_strings.push_back(encoding);
+}
+
+void RVMEventBuffer::endHeader() {
+    push(EndHeader);
+}
+
+void RVMEventBuffer::startModel(const string& projectName, const string& name) {
+    push(StartModel);
+    m_strings.push_back(projectName);
+    m_strings.push_back(name);
+}
+
+void RVMEventBuffer::endModel() {
+    push(EndModel);
+}
+
+void RVMEventBuffer::startGroup(const string& name, const Vector3F& translation, const int& materialId) {
+    push(StartGroup, uint32_t(materialId));
+    m_strings.push_back(name);
+    m_values.insert(m_values.end(), translation.m_values, translation.m_values + 3);
+}
+
+void RVMEventBuffer::endGroup() {
+    push(EndGroup);
+}
+
+void RVMEventBuffer::startMetaData() {
+    push(StartMetaData);
+}
+
+void RVMEventBuffer::endMetaData() {
+    push(EndMetaData);
+}
+
+void RVMEventBuffer::startMetaDataPair(string_view name, string_view value) {
+    push(StartMetaDataPair);
+    m_strings.emplace_back(name);
+    m_strings.emplace_back(value);
+}
+
+void RVMEventBuffer::endMetaDataPair() {
+    push(EndMetaDataPair);
+}
+
+void RVMEventBuffer::createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params) {
+    pushPrimitive(Pyramid, matrix, params);
+}
+
+void RVMEventBuffer::createBox(const std::array<float, 12>& matrix, const Primitives::Box& params) {
+    pushPrimitive(Box, matrix, params);
+}
+
+void RVMEventBuffer::createRectangularTorus(const std::array<float, 12>& matrix, const Primitives::RectangularTorus& params) {
+    pushPrimitive(RectangularTorus, matrix, params);
+}
+
+void RVMEventBuffer::createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& params) {
+    pushPrimitive(CircularTorus, matrix, params);
+}
+
+void RVMEventBuffer::createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& params) {
+    pushPrimitive(EllipticalDish, matrix, params);
+}
+
+void RVMEventBuffer::createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& params) {
+    pushPrimitive(SphericalDish, matrix, params);
+}
+
+void RVMEventBuffer::createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& params) {
+    pushPrimitive(Snout, matrix, params);
+}
+
+void RVMEventBuffer::createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& params) {
+    pushPrimitive(Cylinder, matrix, params);
+}
+
+void RVMEventBuffer::createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& params) {
+    pushPrimitive(Sphere, matrix, params);
+}
+
+void RVMEventBuffer::createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx) {
+    push(Line);
+    pushMatrix(matrix);
+    m_values.push_back(startx);
+    m_values.push_back(endx);
+}
+
+void RVMEventBuffer::createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
+    push(FacetGroup, uint32_t(m_facetGroups.append(facetGroup)));
+    pushMatrix(matrix);
+}
+
+void RVMEventBuffer::updateColorPalette(std::uint32_t index, const std::array<std::uint8_t, 4>& color) {
+    push(ColorPalette, index);
+    for (auto c : color) {
+        m_values.push_back(c);
+    }
+}
+
+void RVMEventBuffer::replay(RVMReader& reader, const std::function<void(const string&)>& groupStarted) const {
+    for (const Event& event : m_events) {
+        const string* s = m_strings.data() + event.string;
+        const float* v = m_values.data() + event.value;
+        switch (event.type) {
+            case StartDocument: reader.startDocument(); break;
+            case EndDocument: reader.endDocument(); break;
+            case StartHeader: reader.startHeader(s[0], s[1], s[2], s[3], s[4]); break;
+            case EndHeader: reader.endHeader(); break;
+            case StartModel: reader.startModel(s[0], s[1]); break;
+            case EndModel: reader.endModel(); break;
+            case StartGroup: {
+                reader.startGroup(s[0], Vector3F(v[0], v[1], v[2]), int(event.integer));
+                if (groupStarted) {
+                    groupStarted(s[0]);
+                }
+            } break;
+            case EndGroup: reader.endGroup(); break;
+            case StartMetaData: reader.startMetaData(); break;
+            case EndMetaData: reader.endMetaData(); break;
+            case StartMetaDataPair: reader.startMetaDataPair(s[0], s[1]); break;
+            case EndMetaDataPair: reader.endMetaDataPair(); break;
+            case Pyramid: reader.createPyramid(matrix_(v), primitive_<Primitives::Pyramid>(v + 12)); break;
+            case Box: reader.createBox(matrix_(v), primitive_<Primitives::Box>(v + 12)); break;
+            case RectangularTorus: reader.createRectangularTorus(matrix_(v), primitive_<Primitives::RectangularTorus>(v + 12)); break;
+            case CircularTorus: reader.createCircularTorus(matrix_(v), primitive_<Primitives::CircularTorus>(v + 12)); break;
+            case EllipticalDish: reader.createEllipticalDish(matrix_(v), primitive_<Primitives::EllipticalDish>(v + 12)); break;
+            case SphericalDish: reader.createSphericalDish(matrix_(v), primitive_<Primitives::SphericalDish>(v + 12)); break;
+            case Snout: reader.createSnout(matrix_(v), primitive_<Primitives::Snout>(v + 12)); break;
+            case Cylinder: reader.createCylinder(matrix_(v), primitive_<Primitives::Cylinder>(v + 12)); break;
+            case Sphere: reader.createSphere(matrix_(v), primitive_<Primitives::Sphere>(v + 12)); break;
+            case Line: reader.createLine(matrix_(v), v[12], v[13]); break;
+            case FacetGroup: reader.createFacetGroup(matrix_(v), m_facetGroups.facetGroup(event.integer)); break;
+            case ColorPalette: {
+                std::array<std::uint8_t, 4> color;
+                for (int i = 0; i < 4; i++) {
+                    color[i] = std::uint8_t(v[i]);
+                }
+                reader.updateColorPalette(event.integer, color);
+            } break;
+        }
+    }
+}
+
+void RVMEventBuffer::clear() {
+    m_events.clear();
+    m_strings.clear();
+    m_values.clear();
+    m_facetGroups.clear();
+}
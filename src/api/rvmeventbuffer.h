@@ -0,0 +1,127 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#ifndef RVMEVENTBUFFER_H
+#define RVMEVENTBUFFER_H
+
+#include <cstdint>
+#include <functional>
+
+#include "rvmreader.h"
+
+/**
+ * @brief RVM reader that records the events it receives, to send them later to another reader.
+ *
+ * Used to decode parts of a model on separate threads and replay them in document order.
+ * Strings and numbers are stored in flat arrays, facet groups are kept as received.
+ */
+class RVMEventBuffer : public RVMReader
+{
+    public:
+        RVMEventBuffer();
+        virtual ~RVMEventBuffer();
+
+        virtual void startDocument();
+        virtual void endDocument();
+
+        virtual void startHeader(const std::string& banner, const std::string& fileNote, const std::string& date, const std::string& user, const std::string& encoding);
+        virtual void endHeader();
+
+        virtual void startModel(const std::string& projectName, const std::string& name);
+        virtual void endModel();
+
+        virtual void startGroup(const std::string& name, const Vector3F& translation, const int& materialId);
+        virtual void endGroup();
+
+        virtual void startMetaData();
+        virtual void endMetaData();
+
+        virtual void startMetaDataPair(std::string_view name, std::string_view value);
+        virtual void endMetaDataPair();
+
+        virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
+
+        virtual void createBox(const std::array<float, 12>& matrix, const Primitives::Box& params);
+
+        virtual void createRectangularTorus(const std::array<float, 12>& matrix, const Primitives::RectangularTorus& params);
+
+        virtual void createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& params);
+
+        virtual void createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& params);
+
+        virtual void createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& params);
+
+        virtual void createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& params);
+
+        virtual void createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& params);
+
+        virtual void createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& params);
+
+        virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
+
+        using RVMReader::createFacetGroup;
+        virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
+
+        virtual void updateColorPalette(std::uint32_t index, const std::array<std::uint8_t, 4>& color);
+
+        /**
+         * @brief Sends the recorded events to a reader, in the order they were received.
+         * @param reader the destination reader.
+         * @param groupStarted if set, called after each replayed startGroup with the group name.
+         */
+        void replay(RVMReader& reader, const std::function<void(const std::string&)>& groupStarted = nullptr) const;
+
+        /**
+         * @brief Releases all recorded events.
+         */
+        void clear();
+
+        bool empty() const { return m_events.empty(); }
+        size_t size() const { return m_events.size(); }
+
+    private:
+        enum EventType : uint8_t {
+            StartDocument, EndDocument, StartHeader, EndHeader, StartModel, EndModel,
+            StartGroup, EndGroup, StartMetaData, EndMetaData, StartMetaDataPair, EndMetaDataPair,
+            Pyramid, Box, RectangularTorus, CircularTorus, EllipticalDish, SphericalDish,
+            Snout, Cylinder, Sphere, Line, FacetGroup, ColorPalette
+        };
+
+        /// An event, with the position of its data in the arrays of the buffer.
+        struct Event
+        {
+            EventType   type;
+            uint32_t    integer;
+            size_t      string;
+            size_t      value;
+        };
+
+        void push(EventType type, uint32_t integer = 0);
+        void pushMatrix(const std::array<float, 12>& matrix);
+        template<typename T> void pushPrimitive(EventType type, const std::array<float, 12>& matrix, const T& params);
+
+        std::vector<Event>          m_events;
+        std::vector<std::string>    m_strings;
+        std::vector<float>          m_values;
+        RVMFacetGroupArena          m_facetGroups;
+};
+
+#endif // RVMEVENTBUFFER_H
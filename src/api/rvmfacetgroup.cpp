@@ -0,0 +1,125 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmfacetgroup.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void RVMFacetGroup::toNested(FGroup& result) const {
+    result.resize(polygonCount());
+    for (size_t p = 0; p < result.size(); p++) {
+        result[p].resize(contourEnd(p) - contourBegin(p));
+        for (size_t c = 0; c < result[p].size(); c++) {
+            const RVMSpan<PositionNormalTuple> vertices = contour(contourBegin(p) + c);
+            result[p][c].assign(vertices.begin(), vertices.end());
+        }
+    }
+}
+
+RVMFacetGroupArena::RVMFacetGroupArena() {
+    clear();
+}
+
+void RVMFacetGroupArena::clear() {
+    m_vertices.clear();
+    m_contours.assign(1, 0);
+    m_polygons.assign(1, 0);
+    m_groups.assign(1, 0);
+}
+
+PositionNormalTuple* RVMFacetGroupArena::addContour(size_t vertexCount) {
+    const size_t offset = m_vertices.size();
+    m_vertices.resize(offset + vertexCount);
+    m_contours.push_back(uint32_t(m_vertices.size()));
+    return m_vertices.mutableData() + offset;
+}
+
+void RVMFacetGroupArena::endPolygon() {
+    m_polygons.push_back(uint32_t(m_contours.size() - 1));
+}
+
+size_t RVMFacetGroupArena::endFacetGroup() {
+    m_groups.push_back(uint32_t(m_polygons.size() - 1));
+    return m_groups.size() - 2;
+}
+
+size_t RVMFacetGroupArena::append(const RVMFacetGroup& facetGroup) {
+    for (size_t p = 0; p < facetGroup.polygonCount(); p++) {
+        for (size_t c = facetGroup.contourBegin(p); c < facetGroup.contourEnd(p); c++) {
+            const RVMSpan<PositionNormalTuple> vertices = facetGroup.contour(c);
+            copy(vertices.begin(), vertices.end(), addContour(vertices.size()));
+        }
+        endPolygon();
+    }
+    return endFacetGroup();
+}
+
+size_t RVMFacetGroupArena::append(const FGroup& facetGroup) {
+    for (const auto& polygon : facetGroup) {
+        for (const auto& contour : polygon) {
+            copy(contour.begin(), contour.end(), addContour(contour.size()));
+        }
+        endPolygon();
+    }
+    return endFacetGroup();
+}
+
+namespace {
+
+    /// Offsets starting with 0, never decreasing, and ending at most at limit.
+    bool validOffsets_(const uint32_t* offsets, size_t count, size_t limit) {
+        if (count == 0 || offsets[0] != 0 || offsets[count - 1] > limit) {
+            return false;
+        }
+        for (size_t i = 1; i < count; i++) {
+            if (offsets[i] < offsets[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+bool RVMFacetGroupArena::map(const PositionNormalTuple* vertices, size_t vertexCount, const uint32_t* contours, size_t contourCount,
+                             const uint32_t* polygons, size_t polygonCount, const uint32_t* groups, size_t groupCount) {
+    if (!validOffsets_(contours, contourCount, vertexCount) || !validOffsets_(polygons, polygonCount, contourCount - 1)
+            || !validOffsets_(groups, groupCount, polygonCount - 1)) {
+        clear();
+        return false;
+    }
+    m_vertices.map(vertices, vertexCount);
+    m_contours.map(contours, contourCount);
+    m_polygons.map(polygons, polygonCount);
+    m_groups.map(groups, groupCount);
+    return true;
+}
+
+RVMFacetGroup RVMFacetGroupArena::facetGroup(size_t index) const {
+    RVMFacetGroup result;
+    result.polygons = RVMSpan<uint32_t>(m_polygons.data() + m_groups[index], m_groups[index + 1] - m_groups[index] + 1);
+    result.contours = RVMSpan<uint32_t>(m_contours.data(), m_contours.size());
+    result.vertices = RVMSpan<PositionNormalTuple>(m_vertices.data(), m_vertices.size());
+    return result;
+}
@@ -0,0 +1,164 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMFACETGROUP_H
+#define RVMFACETGROUP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "rvmmappedarray.h"
+#include "vector3f.h"
+
+typedef std::pair<Vector3F, Vector3F> PositionNormalTuple;
+typedef std::vector<std::vector<std::vector<PositionNormalTuple> > > FGroup;
+
+/**
+ * @brief A read only view on contiguous elements, as std::span.
+ *
+ * The span does not own the elements: they have to outlive it.
+ */
+template<typename T>
+class RVMSpan
+{
+    public:
+        RVMSpan() : m_data(0), m_size(0) {}
+        RVMSpan(const T* data, size_t size) : m_data(data), m_size(size) {}
+
+        inline const T* data() const { return m_data; }
+        inline size_t size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline const T* begin() const { return m_data; }
+        inline const T* end() const { return m_data + m_size; }
+        inline const T& operator[](size_t i) const { return m_data[i]; }
+
+        inline RVMSpan subspan(size_t offset, size_t count) const { return RVMSpan(m_data + offset, count); }
+
+    private:
+        const T*    m_data;
+        size_t      m_size;
+};
+
+/**
+ * @brief A facet group stored flat, as spans over the arrays of a RVMFacetGroupArena.
+ *
+ * Polygons are made of contours, which are made of vertices. Instead of nested vectors,
+ * each level is a run of offsets in the next one: the contours of polygon p are [polygons[p], polygons[p + 1]),
+ * the vertices of contour c are [contours[c], contours[c + 1]).
+ * Offsets are absolute: contours and vertices can be shared by all the facet groups of an arena.
+ */
+struct RVMFacetGroup
+{
+    inline size_t polygonCount() const { return polygons.empty() ? 0 : polygons.size() - 1; }
+    inline size_t contourBegin(size_t polygon) const { return polygons[polygon]; }
+    inline size_t contourEnd(size_t polygon) const { return polygons[polygon + 1]; }
+    inline RVMSpan<PositionNormalTuple> contour(size_t contour) const {
+        return vertices.subspan(contours[contour], contours[contour + 1] - contours[contour]);
+    }
+    /// Number of vertices of all the polygons.
+    inline size_t vertexCount() const {
+        return polygons.empty() ? 0 : contours[polygons[polygons.size() - 1]] - contours[polygons[0]];
+    }
+
+    /**
+     * @brief Copies the facet group to nested vectors (polygons, contours, vertices).
+     */
+    void toNested(FGroup& result) const;
+
+    /// Offsets in contours of the polygons, and the end of the last one.
+    RVMSpan<uint32_t>               polygons;
+    /// Offsets in vertices of the contours, and the end of the last one.
+    RVMSpan<uint32_t>               contours;
+    RVMSpan<PositionNormalTuple>    vertices;
+};
+
+/**
+ * @brief Storage of facet groups, filled contour by contour.
+ *
+ * The parser keeps one arena, cleared for each facet group so that its memory is reused.
+ * Scene models and event buffers keep all their facet groups in one arena.
+ * A scene model loaded from a cache maps its arena on the cached arrays.
+ * Views returned by facetGroup are invalidated by any change to the arena.
+ */
+class RVMFacetGroupArena
+{
+    public:
+        RVMFacetGroupArena();
+
+        /**
+         * @brief Removes all the facet groups, keeping the allocated memory.
+         */
+        void clear();
+
+        /**
+         * @brief Adds a contour to the current polygon.
+         * @param vertexCount number of vertices of the contour.
+         * @return the vertices of the contour, to be filled by the caller.
+         */
+        PositionNormalTuple* addContour(size_t vertexCount);
+        /**
+         * @brief Ends the current polygon, made of the contours added since the previous polygon.
+         */
+        void endPolygon();
+        /**
+         * @brief Ends the current facet group, made of the polygons ended since the previous group.
+         * @return the index of the group.
+         */
+        size_t endFacetGroup();
+
+        /**
+         * @brief Adds a copy of a facet group.
+         * @return the index of the group.
+         */
+        size_t append(const RVMFacetGroup& facetGroup);
+        size_t append(const FGroup& facetGroup);
+
+        /// Number of facet groups.
+        size_t size() const { return m_groups.size() - 1; }
+        RVMFacetGroup facetGroup(size_t index) const;
+
+        /// Storage, for serialization.
+        const RVMMappedArray<PositionNormalTuple>& vertices() const { return m_vertices; }
+        const RVMMappedArray<uint32_t>& contours() const { return m_contours; }
+        const RVMMappedArray<uint32_t>& polygons() const { return m_polygons; }
+        const RVMMappedArray<uint32_t>& groups() const { return m_groups; }
+
+        /**
+         * @brief Borrows the storage of an arena saved elsewhere, without copying it.
+         * @return false, leaving the arena empty, if the offsets are not consistent.
+         */
+        bool map(const PositionNormalTuple* vertices, size_t vertexCount, const uint32_t* contours, size_t contourCount,
+                 const uint32_t* polygons, size_t polygonCount, const uint32_t* groups, size_t groupCount);
+
+    private:
+        RVMMappedArray<PositionNormalTuple> m_vertices;
+        /// Offsets of the contours in m_vertices, starting with 0.
+        RVMMappedArray<uint32_t>            m_contours;
+        /// Offsets of the polygons in m_contours, starting with 0.
+        RVMMappedArray<uint32_t>            m_polygons;
+        /// Offsets of the facet groups in m_polygons, starting with 0.
+        RVMMappedArray<uint32_t>            m_groups;
+};
+
+#endif // RVMFACETGROUP_H
@@ -0,0 +1,60 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmfilehelper.h"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    /// Numbers the temporary files of the process.
+    atomic<unsigned> tmpCounter_(0);
+
+}
+
+string RVMFileHelper::temporaryFilename(const string& filename) {
+    return filename + "." + to_string(getpid()) + "." + to_string(tmpCounter_++) + ".tmp";
+}
+
+bool RVMFileHelper::replace(const string& temporaryFilename, const string& filename, bool written) {
+    if (written) {
+#ifdef _WIN32
+        // rename does not replace an existing file on Windows.
+        remove(filename.data());
+#endif
+        if (rename(temporaryFilename.data(), filename.data()) == 0) {
+            return true;
+        }
+    }
+    remove(temporaryFilename.data());
+    return false;
+}
@@ -0,0 +1,50 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMFILEHELPER_H
+#define RVMFILEHELPER_H
+
+#include <string>
+
+/**
+ * @brief Writes the index and cache files as a whole.
+ *
+ * A file is written to a temporary file unique to the process and the call, then renamed over the final one,
+ * so that concurrent runs neither mix their writes nor read or map a partial file.
+ */
+class RVMFileHelper
+{
+    public:
+        /**
+         * @brief Returns a new temporary file name in the directory of a file.
+         */
+        static std::string temporaryFilename(const std::string& filename);
+
+        /**
+         * @brief Renames a temporary file over the final one, or removes it if it could not be written.
+         * @param written true if the temporary file was written completely.
+         * @return true if the final file was replaced.
+         */
+        static bool replace(const std::string& temporaryFilename, const std::string& filename, bool written);
+};
+
+#endif // RVMFILEHELPER_H
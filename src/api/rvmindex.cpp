@@ -0,0 +1,200 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#include "rvmindex.h"
+#include "rvmfilehelper.h"
+
+#include <fstream>
+
+using namespace std;
+
+namespace {
+
+    const char INDEX_MAGIC[8] = { 'P', 'M', 'U', 'C', 'T', 'O', 'C', 0 };
+    const uint32_t INDEX_VERSION = 1;
+
+    /// Number of parameter words of each primitive kind, facet groups (11) excepted.
+    const uint32_t PRIMITIVE_WORDS[] = { 0, 7, 3, 4, 3, 2, 2, 9, 2, 1, 2 };
+
+    template<typename T>
+    inline void write_(ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    inline bool read_(istream& in, T& value) {
+        return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    inline void skipString(RVMCursor& in) {
+        in.skip(size_t(in.readUInt32()) * 4);
+    }
+
+}
+
+bool RVMIndex::skipPrimitive(RVMCursor& in) {
+    in.skip(4 * 3); // Garbage and version
+    const uint32_t kind = in.readUInt32();
+    in.skip(4 * (12 + 6)); // Matrix and bounding box
+
+    if (kind >= 1 && kind <= 10) {
+        in.skip(4 * PRIMITIVE_WORDS[kind]);
+    } else if (kind == 11) {
+        const uint32_t nbPolygons = in.readUInt32();
+        if (nbPolygons > in.remaining() / 4) {
+            in.skip(in.remaining() + 1);
+            return false;
+        }
+        for (uint32_t p = 0; p < nbPolygons && !in.failed(); p++) {
+            const uint32_t nbContours = in.readUInt32();
+            if (nbContours > in.remaining() / 4) {
+                in.skip(in.remaining() + 1);
+                return false;
+            }
+            for (uint32_t c = 0; c < nbContours && !in.failed(); c++) {
+                // Each vertex is a position and a normal
+                in.skip(size_t(in.readUInt32()) * 24);
+            }
+        }
+    } else {
+        return false;
+    }
+    return !in.failed();
+}
+
+bool RVMIndex::build(RVMCursor& in) {
+    m_entries.clear();
+    vector<size_t> groups;
+
+    Identifier id;
+    while (!in.failed()) {
+        const size_t offset = in.position();
+        in.readIdentifier(id);
+        if (id.empty()) {
+            return false;
+        }
+
+        if (id == "END") {
+            return groups.empty();
+        }
+        if (id == "CNTE") {
+            if (groups.empty()) {
+                return false;
+            }
+            in.skip(4 * 3);
+            Entry& group = m_entries[groups.back()];
+            group.size = in.position() - group.offset;
+            groups.pop_back();
+            continue;
+        }
+
+        m_entries.emplace_back();
+        Entry& entry = m_entries.back();
+        entry.offset = offset;
+        entry.size = 0;
+        entry.depth = uint32_t(groups.size());
+        entry.id = id;
+
+        if (id == "CNTB") {
+            in.skip(4 * 3); // Garbage and version
+            in.readString(entry.name);
+            in.skip(4 * 4); // Translation and material
+            groups.push_back(m_entries.size() - 1);
+            continue;
+        }
+        if (id == "PRIM") {
+            if (!skipPrimitive(in)) {
+                return false;
+            }
+        } else if (id == "COLR") {
+            in.skip(4 * 5); // Garbage, version, index and color
+        } else {
+            return false;
+        }
+        entry.size = in.position() - offset;
+    }
+    return false;
+}
+
+bool RVMIndex::load(const string& filename, uint64_t rvmSize, int64_t rvmTime) {
+    m_entries.clear();
+
+    ifstream in(filename.data(), ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(INDEX_MAGIC)];
+    uint32_t version;
+    uint64_t size, count;
+    int64_t time;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0
+            || !read_(in, version) || version != INDEX_VERSION
+            || !read_(in, size) || size != rvmSize
+            || !read_(in, time) || time != rvmTime
+            || !read_(in, count) || count > rvmSize / 16) {
+        return false;
+    }
+
+    m_entries.resize(size_t(count));
+    for (auto& entry : m_entries) {
+        uint32_t nameSize;
+        if (!read_(in, entry.offset) || !read_(in, entry.size) || !read_(in, entry.depth)
+                || !in.read(entry.id.chrs, 4) || !read_(in, nameSize) || nameSize > rvmSize) {
+            m_entries.clear();
+            return false;
+        }
+        entry.name.resize(nameSize);
+        if (nameSize && !in.read(&entry.name[0], nameSize)) {
+            m_entries.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RVMIndex::save(const string& filename, uint64_t rvmSize, int64_t rvmTime) const {
+    const string tmpFilename = RVMFileHelper::temporaryFilename(filename);
+    ofstream out(tmpFilename.data(), ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    write_(out, INDEX_VERSION);
+    write_(out, rvmSize);
+    write_(out, rvmTime);
+    write_(out, uint64_t(m_entries.size()));
+    for (const auto& entry : m_entries) {
+        write_(out, entry.offset);
+        write_(out, entry.size);
+        write_(out, entry.depth);
+        out.write(entry.id.chrs, 4);
+        write_(out, uint32_t(entry.name.size()));
+        out.write(entry.name.data(), entry.name.size());
+    }
+    out.close();
+    return RVMFileHelper::replace(tmpFilename, filename, !out.fail());
+}
+
+string RVMIndex::indexFilename(const string& rvmFilename) {
+    return rvmFilename + ".idx";
+}
@@ -0,0 +1,97 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#ifndef RVMINDEX_H
+#define RVMINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rvmcursor.h"
+
+/**
+ * @brief Table of contents of the chunks of an RVM file.
+ *
+ * The index records the position, size, depth and name of every group (CNTB), primitive (PRIM)
+ * and color (COLR) chunk of the model. It is built by a light scan of the file, that never decodes
+ * geometry, and can be saved in a sidecar file next to the RVM file to be reused by later runs.
+ *
+ * The parser uses it to seek directly to the requested object. @see RVMParser::setUseIndex
+ */
+class RVMIndex
+{
+    public:
+        struct Entry
+        {
+            /// Position of the chunk identifier in the file.
+            uint64_t        offset;
+            /// Size of the chunk in bytes. For a group, it includes all its children and the closing CNTE.
+            uint64_t        size;
+            /// Number of enclosing groups.
+            uint32_t        depth;
+            Identifier      id;
+            /// Group name, empty for other chunks.
+            std::string     name;
+        };
+
+        /**
+         * @brief Scans the chunks of a model.
+         * @param in a cursor positioned just after the MODL chunk. It is moved after the END identifier.
+         * @return true if the model structure was valid.
+         */
+        bool build(RVMCursor& in);
+
+        /**
+         * @brief Reads a saved index.
+         * @param filename the index file name.
+         * @param rvmSize, rvmTime size and modification time of the RVM file, used to discard outdated indexes.
+         * @return true if a valid index was loaded.
+         */
+        bool load(const std::string& filename, uint64_t rvmSize, int64_t rvmTime);
+        /**
+         * @brief Writes the index, in the byte order of the host.
+         * The file is replaced as a whole, so that concurrent runs never read a partial index.
+         * @return true on success.
+         */
+        bool save(const std::string& filename, uint64_t rvmSize, int64_t rvmTime) const;
+
+        const std::vector<Entry>& entries() const { return m_entries; }
+        void clear() { m_entries.clear(); }
+
+        /**
+         * @brief Name of the index sidecar file of an RVM file.
+         */
+        static std::string indexFilename(const std::string& rvmFilename);
+
+        /**
+         * @brief Skips the content of a primitive chunk without decoding it.
+         * Facet groups are skipped using their polygon, contour and vertex counts only.
+         * @param in a cursor positioned just after the PRIM identifier.
+         * @return false if the primitive is unknown or truncated. In the latter case, the cursor is marked as failed.
+         */
+        static bool skipPrimitive(RVMCursor& in);
+
+    private:
+        std::vector<Entry>  m_entries;
+};
+
+#endif // RVMINDEX_H
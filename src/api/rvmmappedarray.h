@@ -0,0 +1,111 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+
+#ifndef RVMMAPPEDARRAY_H
+#define RVMMAPPEDARRAY_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Array whose elements are either owned or borrowed from a mapped file.
+ *
+ * Filled like a vector, the array owns its elements. Mapped with map, it is a read only view on elements
+ * stored elsewhere, e.g. in a memory mapped cache, that have to outlive it. The first change to a mapped array
+ * copies its elements. Element access is read only, so that reading never copies: changes go through set.
+ */
+template<typename T>
+class RVMMappedArray
+{
+    public:
+        RVMMappedArray() : m_data(0), m_size(0), m_mapped(false) {}
+        RVMMappedArray(const RVMMappedArray& other) : m_values(other.m_values), m_data(other.m_data), m_size(other.m_size), m_mapped(other.m_mapped) {
+            if (!m_mapped) {
+                sync();
+            }
+        }
+        RVMMappedArray& operator=(const RVMMappedArray& other) {
+            if (this != &other) {
+                m_values = other.m_values;
+                m_data = other.m_data;
+                m_size = other.m_size;
+                m_mapped = other.m_mapped;
+                if (!m_mapped) {
+                    sync();
+                }
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Borrows elements stored elsewhere, releasing the owned ones.
+         */
+        void map(const T* data, size_t size) {
+            std::vector<T>().swap(m_values);
+            m_data = data;
+            m_size = size;
+            m_mapped = true;
+        }
+        bool mapped() const { return m_mapped; }
+
+        inline const T* data() const { return m_data; }
+        inline size_t size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline const T* begin() const { return m_data; }
+        inline const T* end() const { return m_data + m_size; }
+        inline const T& operator[](size_t i) const { return m_data[i]; }
+        inline const T& front() const { return m_data[0]; }
+        inline const T& back() const { return m_data[m_size - 1]; }
+
+        /// Elements, to be changed in place.
+        inline T* mutableData() { own(); return m_values.data(); }
+        inline void set(size_t i, const T& value) { own(); m_values[i] = value; }
+
+        void push_back(const T& value) { own(); m_values.push_back(value); sync(); }
+        template<typename Iterator>
+        void append(Iterator first, Iterator last) { own(); m_values.insert(m_values.end(), first, last); sync(); }
+        void resize(size_t size) { own(); m_values.resize(size); sync(); }
+        void assign(size_t size, const T& value) { m_mapped = false; m_values.assign(size, value); sync(); }
+        void clear() { m_mapped = false; m_values.clear(); sync(); }
+        void reserve(size_t size) { own(); m_values.reserve(size); sync(); }
+
+    private:
+        inline void own() {
+            if (m_mapped) {
+                m_values.assign(m_data, m_data + m_size);
+                m_mapped = false;
+                sync();
+            }
+        }
+        inline void sync() {
+            m_data = m_values.data();
+            m_size = m_values.size();
+        }
+
+        std::vector<T>  m_values;
+        const T*        m_data;
+        size_t          m_size;
+        bool            m_mapped;
+};
+
+#endif // RVMMAPPEDARRAY_H
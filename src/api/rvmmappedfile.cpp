@@ -0,0 +1,157 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#include "rvmmappedfile.h"
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RVMMappedFile::RVMMappedFile() :
+    m_data(0),
+    m_size(0),
+    m_time(0),
+    m_open(false)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE),
+    m_mapping(0)
+#endif
+{
+}
+
+RVMMappedFile::~RVMMappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool RVMMappedFile::open(const std::string& filename) {
+    close();
+
+    HANDLE file = CreateFileA(filename.data(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    FILETIME time;
+    if (!GetFileTime(file, 0, 0, &time)) {
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_time = (int64_t(time.dwHighDateTime) << 32 | time.dwLowDateTime) / 10000000;
+    m_open = true;
+
+    // Empty files can not be mapped, but are valid.
+    if (m_size == 0) {
+        return true;
+    }
+
+    m_mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if (!m_mapping) {
+        close();
+        return false;
+    }
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void RVMMappedFile::close() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+    m_data = 0;
+    m_mapping = 0;
+    m_file = INVALID_HANDLE_VALUE;
+    m_size = 0;
+    m_time = 0;
+    m_open = false;
+}
+
+#else
+
+bool RVMMappedFile::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.data(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    m_time = static_cast<int64_t>(st.st_mtime);
+    m_open = true;
+
+    // Empty files can not be mapped, but are valid.
+    if (m_size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void* data = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid once the descriptor is closed.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        m_size = 0;
+        m_open = false;
+        return false;
+    }
+    // The parser reads the file from start to end.
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+    return true;
+}
+
+void RVMMappedFile::close() {
+    if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = 0;
+    m_size = 0;
+    m_time = 0;
+    m_open = false;
+}
+
+#endif
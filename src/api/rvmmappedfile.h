@@ -0,0 +1,74 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#ifndef RVMMAPPEDFILE_H
+#define RVMMAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Used by the parser to decode RVM data directly from the page cache,
+ * without going through a stream buffer.
+ */
+class RVMMappedFile
+{
+    public:
+        RVMMappedFile();
+        ~RVMMappedFile();
+
+        /**
+         * @brief Maps a file in memory. Any previously mapped file is released.
+         * @param filename the file name
+         * @return true if the file could be mapped.
+         */
+        bool open(const std::string& filename);
+        /**
+         * @brief Releases the mapping.
+         */
+        void close();
+
+        bool isOpen() const { return m_open; }
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        /**
+         * @brief Last modification time of the file, in seconds. Only meant for comparisons.
+         */
+        int64_t modificationTime() const { return m_time; }
+
+    private:
+        RVMMappedFile(const RVMMappedFile&) = delete;
+        RVMMappedFile& operator=(const RVMMappedFile&) = delete;
+
+        const char*     m_data;
+        size_t          m_size;
+        int64_t         m_time;
+        bool            m_open;
+#ifdef _WIN32
+        void*           m_file;
+        void*           m_mapping;
+#endif
+};
+
+#endif // RVMMAPPEDFILE_H
@@ -0,0 +1,409 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmmeshcache.h"
+#include "rvmfilehelper.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+namespace {
+
+    const char CACHE_MAGIC[8] = { 'P', 'M', 'U', 'C', 'M', 'S', 'H', 0 };
+    /// To be increased whenever the tesselation of a primitive changes.
+    const uint32_t CACHE_VERSION = 1;
+
+    template<typename T>
+    inline void write_(ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    inline bool read_(istream& in, T& value) {
+        return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    // Indexes are stored on 32 bits whatever their width in memory.
+    inline void writeIndexes(ostream& out, const RVMMeshIndex& indexes) {
+        write_(out, uint32_t(indexes.size()));
+        if (indexes.wide()) {
+            out.write(reinterpret_cast<const char*>(indexes.wideIndices().data()), indexes.size() * sizeof(uint32_t));
+        } else {
+            vector<uint32_t> values(indexes.size());
+            indexes.copy(values.data());
+            out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint32_t));
+        }
+    }
+
+    inline bool readIndexes(istream& in, RVMMeshIndex& indexes, uint32_t maxIndex) {
+        uint32_t count;
+        if (!read_(in, count) || count > (1u << 28)) {
+            return false;
+        }
+        vector<uint32_t> values(count);
+        if (count && !in.read(reinterpret_cast<char*>(values.data()), count * sizeof(uint32_t))) {
+            return false;
+        }
+        for (uint32_t index : values) {
+            if (index >= maxIndex) {
+                return false;
+            }
+        }
+        indexes.assign(values.begin(), values.end(), maxIndex);
+        return true;
+    }
+
+    // Vectors are stored as their number followed by their x, y, z.
+    inline void writeVectors(ostream& out, const vector<float>& values) {
+        write_(out, uint32_t(values.size() / 3));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+    }
+
+    inline bool readVectors(istream& in, vector<float>& values) {
+        uint32_t count;
+        if (!read_(in, count) || count > (1u << 28)) {
+            return false;
+        }
+        values.resize(size_t(count) * 3);
+        return count == 0 || bool(in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(float)));
+    }
+
+}
+
+bool RVMMeshCache::Key::operator==(const Key& other) const {
+    return hash == other.hash && type == other.type
+        && maxSideSize == other.maxSideSize && minSides == other.minSides
+        && memcmp(values, other.values, sizeof(values)) == 0;
+}
+
+RVMMeshCache::RVMMeshCache(float tolerance) :
+    m_tolerance(tolerance > 0 ? tolerance : 0),
+    m_hits(0),
+    m_misses(0) {
+}
+
+RVMMeshCache::RVMMeshCache(const shared_ptr<RVMMeshCache>& shared) :
+    m_tolerance(shared->m_tolerance),
+    m_shared(shared),
+    m_hits(0),
+    m_misses(0) {
+}
+
+RVMMeshCache::Key RVMMeshCache::key(int type, const float* params, int count, float maxSideSize, int minSides) const {
+    Key key;
+    memset(&key, 0, sizeof(key));
+    key.type = uint8_t(type);
+    key.maxSideSize = maxSideSize;
+    key.minSides = minSides;
+    for (int i = 0; i < count && i < MAX_PARAMETERS; i++) {
+        if (m_tolerance > 0) {
+            key.values[i] = llround(double(params[i]) / m_tolerance);
+        } else {
+            // Exact bit pattern, except that -0 and 0 are the same value.
+            const float value = params[i] == 0 ? 0.f : params[i];
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            key.values[i] = bits;
+        }
+    }
+
+    updateHash(key);
+    return key;
+}
+
+void RVMMeshCache::updateHash(Key& key) {
+    // FNV-1a over the words of the key
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t word) {
+        hash = (hash ^ word) * 1099511628211ULL;
+    };
+    mix(key.type);
+    for (int64_t value : key.values) {
+        mix(uint64_t(value));
+    }
+    uint32_t sideSize;
+    memcpy(&sideSize, &key.maxSideSize, sizeof(sideSize));
+    mix(sideSize);
+    mix(uint32_t(key.minSides));
+    key.hash = hash;
+}
+
+shared_ptr<const Mesh> RVMMeshCache::find(const Key& key, const function<Mesh()>& make) {
+    if (m_shared) {
+        bool built = false;
+        shared_ptr<const Mesh> mesh = m_shared->find(key, [&]() {
+            built = true;
+            return make();
+        });
+        (built ? m_misses : m_hits)++;
+        return mesh;
+    }
+    {
+        lock_guard<mutex> guard(m_lock);
+        auto it = m_meshes.find(key);
+        if (it != m_meshes.end()) {
+            m_hits++;
+            return it->second;
+        }
+    }
+    // Tesselate without holding the lock. If another thread did the same meanwhile, its mesh is kept.
+    shared_ptr<const Mesh> mesh = make_shared<const Mesh>(make());
+    lock_guard<mutex> guard(m_lock);
+    m_misses++;
+    return m_meshes.emplace(key, mesh).first->second;
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makePyramid(const Primitives::Pyramid& pyramid, float maxSideSize, int minSides) {
+    return find(key(Pyramid, pyramid, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makePyramid(pyramid, maxSideSize, minSides);
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeBox(const Primitives::Box& box, float maxSideSize, int minSides) {
+    return find(key(Box, box, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makeBox(box, maxSideSize, minSides);
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeRectangularTorus(const Primitives::RectangularTorus& torus, float maxSideSize, int minSides) {
+    return find(key(RectangularTorus, torus, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makeRectangularTorus(torus, maxSideSize, minSides);
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeCircularTorus(const Primitives::CircularTorus& torus, float maxSideSize, int minSides) {
+    return find(key(CircularTorus, torus, maxSideSize, minSides), [&]() {
+        auto sides = RVMMeshHelper2::infoCircularTorusNumSides(torus, maxSideSize, minSides);
+        return RVMMeshHelper2::makeCircularTorus(torus, sides.first, sides.second);
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeEllipticalDish(const Primitives::EllipticalDish& dish, float maxSideSize, int minSides) {
+    return find(key(EllipticalDish, dish, maxSideSize, minSides), [&]() {
+        auto sides = RVMMeshHelper2::infoEllipticalDishNumSides(dish, maxSideSize, minSides);
+        return RVMMeshHelper2::makeEllipticalDish(dish, sides.first, sides.second);
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeSphericalDish(const Primitives::SphericalDish& dish, float maxSideSize, int minSides) {
+    return find(key(SphericalDish, dish, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makeSphericalDish(dish, maxSideSize, minSides);
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeSnout(const Primitives::Snout& snout, float maxSideSize, int minSides) {
+    return find(key(Snout, snout, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makeSnout(snout, RVMMeshHelper2::infoSnoutNumSides(snout, maxSideSize, minSides));
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeCylinder(const Primitives::Cylinder& cylinder, float maxSideSize, int minSides) {
+    return find(key(Cylinder, cylinder, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makeCylinder(cylinder, RVMMeshHelper2::infoCylinderNumSides(cylinder, maxSideSize, minSides));
+    });
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeSphere(const Primitives::Sphere& sphere, float maxSideSize, int minSides) {
+    return find(key(Sphere, sphere, maxSideSize, minSides), [&]() {
+        return RVMMeshHelper2::makeSphere(sphere, maxSideSize, minSides);
+    });
+}
+
+bool RVMMeshCache::unitPrimitive(int type, const float* params, float maxSideSize, int minSides, UnitPrimitive& unit) const {
+    unit.type = type;
+    unit.sides = 0;
+    fill(unit.params, unit.params + MAX_PARAMETERS, 0.f);
+    int count = 0;
+    switch (type) {
+        case Box: {
+            // Same as RVMMeshHelper2::makeBox for flat boxes
+            for (int i = 0; i < 3; i++) {
+                unit.scale[i] = params[i] == 0 ? 0.01f : params[i];
+                unit.params[i] = 1.f;
+            }
+            count = 3;
+        } break;
+        case Cylinder: {
+            const Primitives::Cylinder& cylinder = *reinterpret_cast<const Primitives::Cylinder*>(params);
+            if (cylinder.radius() == 0 || cylinder.height() == 0) {
+                return false;
+            }
+            unit.scale[0] = unit.scale[1] = cylinder.radius();
+            unit.scale[2] = cylinder.height();
+            unit.params[0] = unit.params[1] = 1.f;
+            unit.sides = RVMMeshHelper2::infoCylinderNumSides(cylinder, maxSideSize, minSides);
+            count = 2;
+        } break;
+        case Sphere: {
+            if (params[0] == 0) {
+                return false;
+            }
+            unit.scale[0] = unit.scale[1] = unit.scale[2] = params[0];
+            unit.params[0] = 1.f;
+            unit.sides = std::max(8, minSides);
+            count = 1;
+        } break;
+        case Pyramid: {
+            const Primitives::Pyramid& pyramid = *reinterpret_cast<const Primitives::Pyramid*>(params);
+            const float x = std::max(std::abs(pyramid.xbottom()), std::abs(pyramid.xtop()));
+            const float y = std::max(std::abs(pyramid.ybottom()), std::abs(pyramid.ytop()));
+            if (x == 0 || y == 0 || pyramid.height() == 0) {
+                return false;
+            }
+            unit.scale[0] = x;
+            unit.scale[1] = y;
+            unit.scale[2] = pyramid.height();
+            for (int i = 0; i < 6; i++) {
+                unit.params[i] = params[i] / unit.scale[i % 2];
+            }
+            unit.params[6] = 1.f;
+            count = 7;
+        } break;
+        case Snout: {
+            const Primitives::Snout& snout = *reinterpret_cast<const Primitives::Snout*>(params);
+            // Sheared snouts do not scale to each other.
+            const float r = std::max(std::abs(snout.dbottom()), std::abs(snout.dtop()));
+            if (r == 0 || snout.height() == 0 || snout.xbshear() != 0 || snout.ybshear() != 0
+                    || snout.xtshear() != 0 || snout.ytshear() != 0) {
+                return false;
+            }
+            unit.scale[0] = unit.scale[1] = r;
+            unit.scale[2] = snout.height();
+            unit.params[0] = snout.dbottom() / r;
+            unit.params[1] = snout.dtop() / r;
+            unit.params[2] = 1.f;
+            unit.params[3] = snout.xoffset() / r;
+            unit.params[4] = snout.yoffset() / r;
+            unit.sides = RVMMeshHelper2::infoSnoutNumSides(snout, maxSideSize, minSides);
+            count = 5;
+        } break;
+        default:
+            return false;
+    }
+
+    // The number of sides takes the place of the tesselation settings in the key.
+    unit.key = key(type | UNIT, unit.params, count, 0, int(unit.sides));
+    return true;
+}
+
+shared_ptr<const Mesh> RVMMeshCache::makeUnit(const UnitPrimitive& unit) {
+    return find(unit.key, [&]() {
+        switch (unit.type) {
+            case Box: return RVMMeshHelper2::makeBox(*reinterpret_cast<const Primitives::Box*>(unit.params), 0, 0);
+            case Cylinder: return RVMMeshHelper2::makeCylinder(*reinterpret_cast<const Primitives::Cylinder*>(unit.params), unit.sides);
+            case Sphere: return RVMMeshHelper2::makeSphere(*reinterpret_cast<const Primitives::Sphere*>(unit.params), 0, int(unit.sides));
+            case Pyramid: return RVMMeshHelper2::makePyramid(*reinterpret_cast<const Primitives::Pyramid*>(unit.params), 0, 0);
+            case Snout: return RVMMeshHelper2::makeSnout(*reinterpret_cast<const Primitives::Snout*>(unit.params), unit.sides);
+            default: return Mesh();
+        }
+    });
+}
+
+size_t RVMMeshCache::size() {
+    if (m_shared) {
+        return m_shared->size();
+    }
+    lock_guard<mutex> guard(m_lock);
+    return m_meshes.size();
+}
+
+bool RVMMeshCache::load(const string& filename) {
+    if (m_shared) {
+        return m_shared->load(filename);
+    }
+    ifstream in(filename.data(), ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(CACHE_MAGIC)];
+    uint32_t version;
+    float tolerance;
+    uint64_t count;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0
+            || !read_(in, version) || version != CACHE_VERSION
+            || !read_(in, tolerance) || tolerance != m_tolerance
+            || !read_(in, count)) {
+        return false;
+    }
+
+    vector<pair<Key, shared_ptr<const Mesh> > > meshes;
+    for (uint64_t i = 0; i < count; i++) {
+        Key key;
+        memset(&key, 0, sizeof(key));
+        Mesh mesh;
+        if (!read_(in, key.type) || !in.read(reinterpret_cast<char*>(key.values), sizeof(key.values))
+                || !read_(in, key.maxSideSize) || !read_(in, key.minSides)
+                || !readVectors(in, mesh.positions) || !readVectors(in, mesh.normals)
+                || !readIndexes(in, mesh.positionIndex, uint32_t(mesh.positionCount()))
+                || !readIndexes(in, mesh.normalIndex, uint32_t(mesh.normalCount()))) {
+            return false;
+        }
+        updateHash(key);
+        meshes.emplace_back(key, make_shared<const Mesh>(move(mesh)));
+    }
+
+    lock_guard<mutex> guard(m_lock);
+    m_meshes.insert(meshes.begin(), meshes.end());
+    return true;
+}
+
+bool RVMMeshCache::save(const string& filename) {
+    if (m_shared) {
+        return m_shared->save(filename);
+    }
+    // Each process and each call writes its own temporary file, so that concurrent runs
+    // sharing a cache file never write into the same one.
+    const string tmpFilename = RVMFileHelper::temporaryFilename(filename);
+    bool written;
+    {
+        ofstream out(tmpFilename.data(), ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+
+        lock_guard<mutex> guard(m_lock);
+        out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        write_(out, CACHE_VERSION);
+        write_(out, m_tolerance);
+        write_(out, uint64_t(m_meshes.size()));
+        for (const auto& entry : m_meshes) {
+            const Key& key = entry.first;
+            const Mesh& mesh = *entry.second;
+            write_(out, key.type);
+            out.write(reinterpret_cast<const char*>(key.values), sizeof(key.values));
+            write_(out, key.maxSideSize);
+            write_(out, key.minSides);
+            writeVectors(out, mesh.positions);
+            writeVectors(out, mesh.normals);
+            writeIndexes(out, mesh.positionIndex);
+            writeIndexes(out, mesh.normalIndex);
+        }
+        out.close();
+        written = !out.fail();
+    }
+    return RVMFileHelper::replace(tmpFilename, filename, written);
+}
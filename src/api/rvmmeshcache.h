@@ -0,0 +1,188 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMMESHCACHE_H
+#define RVMMESHCACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rvmmeshhelper.h"
+
+/**
+ * @brief Tesselated primitives, shared by all the readers of a conversion.
+ *
+ * Meshes are keyed by a fixed size key: the primitive type, its parameters and the tesselation settings.
+ * With a tolerance, parameters are rounded to multiples of it, so that primitives that only differ
+ * by less than the tolerance (e.g. pipe elements of the same nominal size) are tesselated once.
+ * The first primitive of a key gives the mesh of all the others.
+ *
+ * The cache can be used concurrently by readers running on several threads.
+ * A conversion can count its own hits and misses through a view of a cache shared with other conversions.
+ * It can be saved to a file and loaded by later runs, so that common primitives are never tesselated again.
+ */
+class RVMMeshCache
+{
+    public:
+        /// Maximum number of parameters of a primitive (snout).
+        static const int MAX_PARAMETERS = 9;
+
+        struct Key
+        {
+            bool operator==(const Key& other) const;
+
+            uint64_t    hash;
+            /// Parameters, rounded to the tolerance or as exact bit patterns.
+            int64_t     values[MAX_PARAMETERS];
+            float       maxSideSize;
+            int32_t     minSides;
+            uint8_t     type;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const { return size_t(key.hash); }
+        };
+
+        /// Flag added to the primitive type in the keys of unit meshes.
+        static const int UNIT = 0x80;
+
+        /**
+         * @brief A primitive described as a mesh of unit size, and the scale taking it to the primitive.
+         */
+        struct UnitPrimitive
+        {
+            /// Matrix placing the unit mesh where the primitive is, from the matrix of the primitive.
+            std::array<float, 12> transform(const std::array<float, 12>& matrix) const {
+                std::array<float, 12> result = matrix;
+                for (int i = 0; i < 9; i++) {
+                    result[i] *= scale[i / 3];
+                }
+                return result;
+            }
+
+            /// Type with the UNIT flag, shape of the unit primitive and number of sides.
+            Key         key;
+            /// Along x, y and z.
+            float       scale[3];
+            int         type;
+            float       params[MAX_PARAMETERS];
+            unsigned long sides;
+        };
+
+        /**
+         * @param tolerance parameters closer than this share their mesh. 0 to only share identical primitives.
+         */
+        explicit RVMMeshCache(float tolerance = 0);
+        /**
+         * @brief Creates a view of a shared cache: meshes are stored by the shared cache, hits and misses are also counted by the view.
+         */
+        explicit RVMMeshCache(const std::shared_ptr<RVMMeshCache>& shared);
+
+        float tolerance() const { return m_tolerance; }
+
+        /**
+         * @brief Builds the key of a primitive.
+         * @param type a PrimitiveTypes value
+         * @param params the parameters of the primitive
+         * @param count the number of parameters
+         */
+        Key key(int type, const float* params, int count, float maxSideSize, int minSides) const;
+        template<typename T>
+        Key key(int type, const T& params, float maxSideSize, int minSides) const {
+            return key(type, reinterpret_cast<const float*>(&params), int(sizeof(T) / sizeof(float)), maxSideSize, minSides);
+        }
+
+        /**
+         * @brief Returns the mesh of a key, built by make if it is not known yet.
+         */
+        std::shared_ptr<const Mesh> find(const Key& key, const std::function<Mesh()>& make);
+
+        /// Same as the RVMMeshHelper2 methods, the numbers of sides being computed from maxSideSize and minSides.
+        std::shared_ptr<const Mesh> makePyramid(const Primitives::Pyramid& pyramid, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeBox(const Primitives::Box& box, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeRectangularTorus(const Primitives::RectangularTorus& torus, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeCircularTorus(const Primitives::CircularTorus& torus, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeEllipticalDish(const Primitives::EllipticalDish& dish, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeSphericalDish(const Primitives::SphericalDish& dish, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeSnout(const Primitives::Snout& snout, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeCylinder(const Primitives::Cylinder& cylinder, float maxSideSize, int minSides);
+        std::shared_ptr<const Mesh> makeSphere(const Primitives::Sphere& sphere, float maxSideSize, int minSides);
+
+        /**
+         * @brief Describes a primitive as a scaled unit primitive, so that primitives only differing by their size share a mesh.
+         *
+         * The unit primitive keeps the number of sides of the primitive, so that the tesselation does not change.
+         * Boxes, cylinders and spheres always have a unit primitive.
+         * Pyramids and snouts have one if they are not flat, snouts only without shear.
+         * @param type a PrimitiveTypes value
+         * @param unit receives the unit primitive.
+         * @return false if the primitive has no unit equivalent.
+         */
+        bool unitPrimitive(int type, const float* params, float maxSideSize, int minSides, UnitPrimitive& unit) const;
+        /**
+         * @brief Returns the mesh of a unit primitive.
+         */
+        std::shared_ptr<const Mesh> makeUnit(const UnitPrimitive& unit);
+
+        /// Number of meshes found in the cache, and built.
+        size_t hits() const { return m_hits; }
+        size_t misses() const { return m_misses; }
+        /// Number of meshes in the cache.
+        size_t size();
+
+        /**
+         * @brief Adds the meshes of a cache file. Files written with another tolerance or format version are ignored.
+         * @param filename the cache file name.
+         * @return true if the file could be loaded.
+         */
+        bool load(const std::string& filename);
+        /**
+         * @brief Writes all the meshes to a file, in the byte order of the host.
+         *
+         * The file is written to a temporary file unique to the process and the call, then renamed over the final one,
+         * so that concurrent runs neither mix their writes nor read a partial file.
+         * @return true on success.
+         */
+        bool save(const std::string& filename);
+
+    private:
+        static void updateHash(Key& key);
+
+        RVMMeshCache(const RVMMeshCache&) = delete;
+        RVMMeshCache& operator=(const RVMMeshCache&) = delete;
+
+        float                                                               m_tolerance;
+        std::shared_ptr<RVMMeshCache>                                       m_shared;
+        std::mutex                                                          m_lock;
+        std::unordered_map<Key, std::shared_ptr<const Mesh>, KeyHash>       m_meshes;
+        std::atomic<size_t>                                                 m_hits;
+        std::atomic<size_t>                                                 m_misses;
+};
+
+#endif // RVMMESHCACHE_H
@@ -20,17 +20,8 @@
  */
 
 #include "rvmmeshhelper.h"
-
-#ifdef _WIN32
-#include "windows.h"
-#endif
-
-#include <GL/gl.h>
-#include <GL/glu.h>
-
-#ifndef WIN32
-#define CALLBACK
-#endif /* !WIN32 */
+#include "rvmtriangulator.h"
+#include "rvmvertexwelder.h"
 
 #include <algorithm>
 #include <cmath>
@@ -40,15 +31,21 @@
 #define M_PI 3.14159265358979323846f
 #endif
 
-#ifdef WIN32
-#undef min
-#undef max
-#endif
-
 using namespace std;
 
 RVMMeshHelper2::RVMMeshHelper2() {}
 
+// Empties a mesh for reuse, keeping its memory, and reserves the exact sizes of the next one.
+// The numbers of vertices also give the width of the indices.
+static void reset_(Mesh& mesh, size_t positions, size_t normals, size_t positionIndex, size_t normalIndex) {
+  mesh.positions.clear();
+  mesh.normals.clear();
+  mesh.positions.reserve(positions * 3);
+  mesh.normals.reserve(normals * 3);
+  mesh.positionIndex.reset(positions, positionIndex);
+  mesh.normalIndex.reset(normals, normalIndex);
+}
+
 static const float cube_positions[] = {
     -1.0f, -1.0f, -1.0f, -1.0f, 1.0f,  -1.0f, 1.0f,  1.0f,  -1.0f, 1.0f,  -1.0f, -1.0f, -1.0f, -1.0f, 1.0f,
     -1.0f, 1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  -1.0f, 1.0f,  -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f,
@@ -63,31 +60,15 @@ static const float cube_normals[] = {
 static const unsigned long cube_index[] = {0,  1,  2,  2,  3,  0,  4,  7,  5,  5,  7,  6,  8,  9,  10, 10, 11, 8,
                                            12, 14, 13, 14, 12, 15, 16, 17, 18, 18, 19, 16, 20, 22, 21, 22, 20, 23};
 
-void CALLBACK tessVertexData(void* vertex_data, void* polygon_data) {
-  Mesh* userData = (Mesh*)polygon_data;
-  userData->positionIndex.push_back((unsigned long)vertex_data);
-}
-void CALLBACK tessEdgeFlag(GLboolean flag, void* polygon_data) {}
-
-void CALLBACK tessError(GLenum err) {
-  cout << "error: " << gluErrorString(err) << endl;
+Mesh RVMMeshHelper2::makeBox(const Primitives::Box& box, const float& maxSideSize, const int& minSides) {
+  Mesh result;
+  makeBox(box, maxSideSize, minSides, result);
+  return result;
 }
 
-void CALLBACK tessCombineData(GLdouble newVert[3],
-                              GLdouble* neighbourVert[4],
-                              GLfloat neighborWeight[4],
-                              void** outData,
-                              void* polygon_data) {
-  Mesh* userData = (Mesh*)polygon_data;
-  unsigned long index = static_cast<unsigned long>(userData->positions.size());
-  userData->positions.push_back(Vector3F(float(newVert[0]), float(newVert[1]), float(newVert[2])));
-  userData->normals.push_back(Vector3F(0.0f, 1.0f, 0.0f));
-  *outData = (void*)index;
-};
-
-const Mesh RVMMeshHelper2::makeBox(const Primitives::Box& inBox, const float& maxSideSize, const int& minSides) {
-  vector<Vector3F> points;
-  vector<Vector3F> normals;
+void RVMMeshHelper2::makeBox(const Primitives::Box& inBox, const float& maxSideSize, const int& minSides, Mesh& result) {
+  const size_t indexCount = sizeof(cube_index) / sizeof(cube_index[0]);
+  reset_(result, 24, 24, indexCount, 0);
 
   Primitives::Box box;
 
@@ -107,27 +88,27 @@ const Mesh RVMMeshHelper2::makeBox(const Primitives::Box& inBox, const float& ma
     normal[0] = cube_normals[i / 4 * 3];
     normal[1] = cube_normals[i / 4 * 3 + 1];
     normal[2] = cube_normals[i / 4 * 3 + 2];
-    points.push_back(point);
-    normals.push_back(normal);
+    result.addPosition(point);
+    result.addNormal(normal);
   }
 
   // Copy the index of the box
-  vector<unsigned long> index(cube_index, cube_index + sizeof(cube_index) / sizeof(cube_index[0]));
+  result.positionIndex.assign(cube_index, cube_index + indexCount, 24);
+}
 
+Mesh RVMMeshHelper2::makeSphere(const Primitives::Sphere& sphere, const float& maxSideSize, const int& minSides) {
   Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  result.normals = normals;
+  makeSphere(sphere, maxSideSize, minSides, result);
   return result;
 }
 
-const Mesh RVMMeshHelper2::makeSphere(const Primitives::Sphere& sphere, const float& maxSideSize, const int& minSides) {
+void RVMMeshHelper2::makeSphere(const Primitives::Sphere& sphere, const float& maxSideSize, const int& minSides, Mesh& result) {
   const float radius = sphere.diameter / 2.0f;
 
   // Init sphere
   int sides = max(8, minSides);
-  vector<Vector3F> positions;
-  vector<Vector3F> normals;
+  const size_t vertexCount = size_t(sides + 1) * size_t(sides + 1);
+  reset_(result, vertexCount, vertexCount, size_t(sides) * size_t(sides) * 6, 0);
 
   for (int x = 0; x <= sides; x++) {
     float theta = float((x * M_PI) / (float)sides);
@@ -144,12 +125,12 @@ const Mesh RVMMeshHelper2::makeSphere(const Primitives::Sphere& sphere, const fl
       v[1] = -cosTheta;
       v[2] = -sinPhi * sinTheta;
 
-      normals.push_back(v);
-      positions.push_back(v * radius);
+      result.addNormal(v);
+      result.addPosition(v * radius);
     }
   }
 
-  vector<unsigned long> index;
+  RVMMeshIndex& index = result.positionIndex;
 
   for (int i = 0; i < sides; i++) {
     for (int j = 0; j < sides; j++) {
@@ -165,32 +146,36 @@ const Mesh RVMMeshHelper2::makeSphere(const Primitives::Sphere& sphere, const fl
       index.push_back(first + 1);
     }
   }
+}
 
+Mesh RVMMeshHelper2::makeRectangularTorus(const Primitives::RectangularTorus& rt,
+                                          const float& maxSideSize,
+                                          const int& minSides) {
   Mesh result;
-  result.positions = positions;
-  result.positionIndex = index;
-  result.normals = normals;
+  makeRectangularTorus(rt, maxSideSize, minSides, result);
   return result;
 }
 
-const Mesh RVMMeshHelper2::makeRectangularTorus(const Primitives::RectangularTorus& rt,
-                                                const float& maxSideSize,
-                                                const int& minSides) {
-  vector<unsigned long> index;
-  vector<Vector3F> points;
-
-  vector<unsigned long> normalindex;
-  vector<Vector3F> vectors;
-
+void RVMMeshHelper2::makeRectangularTorus(const Primitives::RectangularTorus& rt,
+                                          const float& maxSideSize,
+                                          const int& minSides,
+                                          Mesh& result) {
   int sides = int(rt.angle() * rt.routside() / maxSideSize);
   if (sides < minSides) {
     sides = minSides;
   }
 
+  // 4 vertexes and 2 normals per section, 2 normals for the faces and 2 for the caps,
+  // 8 triangles per side and 4 for the caps.
+  const size_t indexCount = (size_t(sides) * 8 + 4) * 3;
+  reset_(result, size_t(sides + 1) * 4, size_t(sides + 1) * 2 + 4, indexCount, indexCount);
+  RVMMeshIndex& index = result.positionIndex;
+  RVMMeshIndex& normalindex = result.normalIndex;
+
   // Vertexes and normals
   Vector3F v;
-  vectors.push_back(Vector3F(0, 0, -1));
-  vectors.push_back(Vector3F(0, 0, 1));
+  result.addNormal(Vector3F(0, 0, -1));
+  result.addNormal(Vector3F(0, 0, 1));
 
   for (int i = 0; i < sides + 1; i++) {
     float c = cos(rt.angle() / sides * i);
@@ -198,21 +183,21 @@ const Mesh RVMMeshHelper2::makeRectangularTorus(const Primitives::RectangularTor
     v[0] = rt.rinside() * c;
     v[1] = rt.rinside() * s;
     v[2] = -rt.height() / 2.f;
-    points.push_back(v);
+    result.addPosition(v);
     v[0] = rt.routside() * c;
     v[1] = rt.routside() * s;
     v[2] = -rt.height() / 2.f;
-    points.push_back(v);
+    result.addPosition(v);
     v[0] = rt.routside() * c;
     v[1] = rt.routside() * s;
     v[2] = rt.height() / 2.f;
-    points.push_back(v);
+    result.addPosition(v);
     v[0] = rt.rinside() * c;
     v[1] = rt.rinside() * s;
     v[2] = rt.height() / 2.f;
-    points.push_back(v);
-    vectors.push_back(Vector3F(c, s, 0));
-    vectors.push_back(Vector3F(-c, -s, 0));
+    result.addPosition(v);
+    result.addNormal(Vector3F(c, s, 0));
+    result.addNormal(Vector3F(-c, -s, 0));
   }
 
   // Sides
@@ -265,11 +250,11 @@ const Mesh RVMMeshHelper2::makeRectangularTorus(const Primitives::RectangularTor
 
   // Caps
   // - Caps normals
-  const unsigned long nci = static_cast<unsigned long>(vectors.size());
-  vectors.push_back(Vector3F(0, -1, 0));
+  const unsigned long nci = static_cast<unsigned long>(result.normalCount());
+  result.addNormal(Vector3F(0, -1, 0));
   float c = cos(rt.angle());
   float s = sin(rt.angle());
-  vectors.push_back(Vector3F(-s, c, 0));
+  result.addNormal(Vector3F(-s, c, 0));
   // - Caps indexes
   index.push_back(0);
   index.push_back(1);
@@ -303,14 +288,6 @@ const Mesh RVMMeshHelper2::makeRectangularTorus(const Primitives::RectangularTor
   normalindex.push_back(nci + 1);
   normalindex.push_back(nci + 1);
   normalindex.push_back(nci + 1);
-
-  Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  result.normals = vectors;
-  result.normalIndex = normalindex;
-
-  return result;
 }
 
 std::pair<unsigned long, unsigned long> RVMMeshHelper2::infoCircularTorusNumSides(
@@ -323,13 +300,24 @@ std::pair<unsigned long, unsigned long> RVMMeshHelper2::infoCircularTorusNumSide
   return std::make_pair(tsides, csides);
 }
 
-const Mesh RVMMeshHelper2::makeCircularTorus(const Primitives::CircularTorus& cTorus,
-                                             unsigned long tsides,
-                                             unsigned long csides) {
-  vector<unsigned long> index;
-  vector<Vector3F> points;
-  vector<unsigned long> normalindex;
-  vector<Vector3F> vectors;
+Mesh RVMMeshHelper2::makeCircularTorus(const Primitives::CircularTorus& cTorus,
+                                       unsigned long tsides,
+                                       unsigned long csides) {
+  Mesh result;
+  makeCircularTorus(cTorus, tsides, csides, result);
+  return result;
+}
+
+void RVMMeshHelper2::makeCircularTorus(const Primitives::CircularTorus& cTorus,
+                                       unsigned long tsides,
+                                       unsigned long csides,
+                                       Mesh& result) {
+  // csides vertexes per section and the caps centers, 2 triangles per side and csides per cap.
+  const size_t vertexCount = size_t(tsides + 1) * csides + 2;
+  const size_t indexCount = (size_t(tsides) * csides + csides) * 6;
+  reset_(result, vertexCount, vertexCount, indexCount, indexCount);
+  RVMMeshIndex& index = result.positionIndex;
+  RVMMeshIndex& normalindex = result.normalIndex;
 
   // Vertexes and normals
   float radius = cTorus.radius();
@@ -352,13 +340,13 @@ const Mesh RVMMeshHelper2::makeCircularTorus(const Primitives::CircularTorus& cT
       v[0] = (radius * C + offset) * c;
       v[1] = (radius * C + offset) * s;
       v[2] = radius * S;
-      points.push_back(v);
+      result.addPosition(v);
 
       n[0] = C * c;
       n[1] = C * s;
       n[2] = S;
       n.normalize();
-      vectors.push_back(n);
+      result.addNormal(n);
     }
   }
 
@@ -392,16 +380,16 @@ const Mesh RVMMeshHelper2::makeCircularTorus(const Primitives::CircularTorus& cT
 
   // Caps
   // - Caps normals
-  const unsigned long ci = static_cast<unsigned long>(vectors.size());
-  vectors.push_back(Vector3F(0, -1, 0));
+  const unsigned long ci = static_cast<unsigned long>(result.normalCount());
+  result.addNormal(Vector3F(0, -1, 0));
 
   float c = cos(cTorus.angle());
   float s = sin(cTorus.angle());
-  vectors.push_back(Vector3F(-s, c, 0));
+  result.addNormal(Vector3F(-s, c, 0));
 
   // - Caps centers
-  points.push_back(Vector3F(offset, 0, 0));
-  points.push_back(Vector3F(c * offset, s * offset, 0));
+  result.addPosition(Vector3F(offset, 0, 0));
+  result.addPosition(Vector3F(c * offset, s * offset, 0));
 
   // - Caps indexes
   for (unsigned long j = 0; j < csides; j++) {
@@ -421,22 +409,23 @@ const Mesh RVMMeshHelper2::makeCircularTorus(const Primitives::CircularTorus& cT
     normalindex.push_back(ci + 1);
     normalindex.push_back(ci + 1);
   }
-
-  Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  result.normals = vectors;
-  result.normalIndex = normalindex;
-  return result;
 }
 
 static const float pyramid[] = {
     .5, .5, -.5, .5, -.5, -.5, -.5, -.5, -.5, -.5, .5, -.5, .5, .5, .5, .5, -.5, .5, -.5, -.5, .5, -.5, .5, .5,
 };
 
-const Mesh RVMMeshHelper2::makePyramid(const Primitives::Pyramid& inP, const float& maxSideSize, const int& minSides) {
+Mesh RVMMeshHelper2::makePyramid(const Primitives::Pyramid& pyramid, const float& maxSideSize, const int& minSides) {
+  Mesh result;
+  makePyramid(pyramid, maxSideSize, minSides, result);
+  return result;
+}
+
+void RVMMeshHelper2::makePyramid(const Primitives::Pyramid& inP, const float& maxSideSize, const int& minSides, Mesh& result) {
+  // At most 2 triangles per side and per cap, degenerated ones are skipped.
+  reset_(result, 8, 0, 36, 0);
   // Coordinates
-  vector<Vector3F> points;
+  Vector3F points[8];
   for (int i = 0; i < 8; i++) {
     Vector3F p;
     p[0] = i < 4 ? pyramid[i * 3] * inP.xbottom() - inP.xoffset() * 0.5f
@@ -444,9 +433,10 @@ const Mesh RVMMeshHelper2::makePyramid(const Primitives::Pyramid& inP, const flo
     p[1] = i < 4 ? pyramid[i * 3 + 1] * inP.ybottom() - inP.yoffset() * 0.5f
                  : pyramid[i * 3 + 1] * inP.ytop() + inP.yoffset() * 0.5f;
     p[2] = pyramid[i * 3 + 2] * inP.height();
-    points.push_back(p);
+    points[i] = p;
+    result.addPosition(p);
   }
-  vector<unsigned long> index;
+  RVMMeshIndex& index = result.positionIndex;
   // Sides
   for (int i = 0; i < 4; i++) {
     if (!points[i].equals(points[i == 3 ? 0 : i + 1]) && !points[i == 3 ? 0 : i + 1].equals(points[i + 4]) &&
@@ -479,10 +469,6 @@ const Mesh RVMMeshHelper2::makePyramid(const Primitives::Pyramid& inP, const flo
     index.push_back(7);
     index.push_back(6);
   }
-  Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  return result;
 }
 
 unsigned long RVMMeshHelper2::infoCylinderNumSides(const Primitives::Cylinder& cylinder,
@@ -491,15 +477,21 @@ unsigned long RVMMeshHelper2::infoCylinderNumSides(const Primitives::Cylinder& c
   return std::max(minSides, static_cast<unsigned long>(2 * M_PI * cylinder.radius() / maxSideSize));
 }
 
-const Mesh RVMMeshHelper2::makeCylinder(const Primitives::Cylinder& cylinder, unsigned long sides) {
+Mesh RVMMeshHelper2::makeCylinder(const Primitives::Cylinder& cylinder, unsigned long sides) {
+  Mesh result;
+  makeCylinder(cylinder, sides, result);
+  return result;
+}
+
+void RVMMeshHelper2::makeCylinder(const Primitives::Cylinder& cylinder, unsigned long sides, Mesh& result) {
   const float halfHeight = cylinder.height() / 2;
 
-  vector<Vector3F> positions;
-  vector<Vector3F> normals;
+  // 2 vertexes and 1 normal per side plus the caps centers, 2 triangles per side and 1 per side in each cap.
+  reset_(result, size_t(sides) * 2 + 2, size_t(sides) + 2, size_t(sides) * 12, size_t(sides) * 12);
   const float d = float(2.0f * M_PI / static_cast<float>(sides));
 
-  vector<unsigned long> positionIndex;
-  vector<unsigned long> normalIndex;
+  RVMMeshIndex& positionIndex = result.positionIndex;
+  RVMMeshIndex& normalIndex = result.normalIndex;
 
   const unsigned long nrTrianglesSide = 2 * sides;
 
@@ -511,9 +503,9 @@ const Mesh RVMMeshHelper2::makeCylinder(const Primitives::Cylinder& cylinder, un
     const float x = sin(d * static_cast<float>(i));   // [0..1]
     const float y = -cos(d * static_cast<float>(i));  // [-1..0]
 
-    positions.push_back(Vector3F(x * cylinder.radius(), y * cylinder.radius(), -halfHeight));
-    positions.push_back(Vector3F(x * cylinder.radius(), y * cylinder.radius(), +halfHeight));
-    normals.push_back(Vector3F(x, y, 0));
+    result.addPosition(Vector3F(x * cylinder.radius(), y * cylinder.radius(), -halfHeight));
+    result.addPosition(Vector3F(x * cylinder.radius(), y * cylinder.radius(), +halfHeight));
+    result.addNormal(Vector3F(x, y, 0));
 
     v0 = i * 2;
     v1 = v0 + 1;
@@ -542,13 +534,13 @@ const Mesh RVMMeshHelper2::makeCylinder(const Primitives::Cylinder& cylinder, un
 
   // Tesselate the caps
   // bottom (index: sides*2)
-  positions.push_back(Vector3F(0, 0, -halfHeight));
+  result.addPosition(Vector3F(0, 0, -halfHeight));
   // top (index: sides*2 + 1)
-  positions.push_back(Vector3F(0, 0, +halfHeight));
+  result.addPosition(Vector3F(0, 0, +halfHeight));
   // down (index: sides)
-  normals.push_back(Vector3F(0, 0, -1));
+  result.addNormal(Vector3F(0, 0, -1));
   // up (index: sides + 1)
-  normals.push_back(Vector3F(0, 0, 1));
+  result.addNormal(Vector3F(0, 0, 1));
 
   for (unsigned long i = 0; i < sides; i++) {
     positionIndex.push_back(sides * 2);  // bottom
@@ -567,13 +559,6 @@ const Mesh RVMMeshHelper2::makeCylinder(const Primitives::Cylinder& cylinder, un
     normalIndex.push_back(sides + 1);
     normalIndex.push_back(sides + 1);
   }
-
-  Mesh result;
-  result.positions = positions;
-  result.normals = normals;
-  result.positionIndex = positionIndex;
-  result.normalIndex = normalIndex;
-  return result;
 }
 
 unsigned long RVMMeshHelper2::infoSnoutNumSides(const Primitives::Snout& snout,
@@ -583,17 +568,23 @@ unsigned long RVMMeshHelper2::infoSnoutNumSides(const Primitives::Snout& snout,
                   static_cast<unsigned long>(2.0f * M_PI * std::max(snout.dbottom(), snout.dtop()) / maxSideSize));
 }
 
-const Mesh RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned long sides) {
+Mesh RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned long sides) {
+  Mesh result;
+  makeSnout(snout, sides, result);
+  return result;
+}
+
+void RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned long sides, Mesh& result) {
   const float rbottom = snout.dbottom();
   const float rtop = snout.dtop();
   const float height = snout.height();
   const float xoffset = snout.xoffset();
   const float yoffset = snout.yoffset();
 
-  vector<unsigned long> index;
-  vector<Vector3F> points;
-  vector<unsigned long> normalindex;
-  vector<Vector3F> vectors;
+  // Same sizes as a cylinder.
+  reset_(result, size_t(sides) * 2 + 2, size_t(sides) + 2, size_t(sides) * 12, size_t(sides) * 12);
+  RVMMeshIndex& index = result.positionIndex;
+  RVMMeshIndex& normalindex = result.normalIndex;
 
   const float hh = height / 2;
 
@@ -610,13 +601,13 @@ const Mesh RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned lo
     v[0] = rbottom * c - xoffset / 2.0f;
     v[1] = rbottom * s - yoffset / 2.0f;
     v[2] = -hh;
-    points.push_back(v);
+    result.addPosition(v);
 
     // v[0] = rtop * c + xoffset; v[1] = rtop * s + yoffset; v[2] = hh;
     v[0] = rtop * c + xoffset / 2.0f;
     v[1] = rtop * s + yoffset / 2.0f;
     v[2] = hh;
-    points.push_back(v);
+    result.addPosition(v);
     if (height > 0.0f) {
       float dh = sqrt(fabs(((rtop * c + xoffset - rbottom * c) * (rtop * c + xoffset - rbottom * c) +
                             (rtop * s + yoffset - rbottom * s) * (rtop * s + yoffset - rbottom * s)) /
@@ -630,7 +621,7 @@ const Mesh RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned lo
     n[1] = 0;
     n[2] = 1;
 
-    vectors.push_back(n);
+    result.addNormal(n);
   }
 
   // Sides
@@ -654,25 +645,25 @@ const Mesh RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned lo
 
   // Caps
   // - Caps normals
-  const unsigned long nci = static_cast<unsigned long>(vectors.size());
+  const unsigned long nci = static_cast<unsigned long>(result.normalCount());
   n[0] = 0;
   n[1] = 0;
   n[2] = -1;
-  vectors.push_back(n);
+  result.addNormal(n);
   n[0] = 0;
   n[1] = 0;
   n[2] = 1;
-  vectors.push_back(n);
+  result.addNormal(n);
   // - Caps centers
-  const unsigned long ci = static_cast<unsigned long>(points.size());
+  const unsigned long ci = static_cast<unsigned long>(result.positionCount());
   v[0] = -xoffset / 2.0f;
   v[1] = -yoffset / 2.0f;
   v[2] = -hh;
-  points.push_back(v);
+  result.addPosition(v);
   v[0] = xoffset / 2.0f;
   v[1] = yoffset / 2.0f;
   v[2] = hh;
-  points.push_back(v);
+  result.addPosition(v);
   // - Caps indexes
   for (unsigned long j = 0; j < sides; j++) {
     index.push_back(j * 2);
@@ -691,14 +682,6 @@ const Mesh RVMMeshHelper2::makeSnout(const Primitives::Snout& snout, unsigned lo
     normalindex.push_back(nci + 1);
     normalindex.push_back(nci + 1);
   }
-
-  Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  result.normals = vectors;
-  result.normalIndex = normalindex;
-
-  return result;
 }
 
 std::pair<unsigned long, unsigned long> RVMMeshHelper2::infoEllipticalDishNumSides(
@@ -714,12 +697,22 @@ std::pair<unsigned long, unsigned long> RVMMeshHelper2::infoEllipticalDishNumSid
   return std::make_pair(sides, csides);
 }
 
-const Mesh RVMMeshHelper2::makeEllipticalDish(const Primitives::EllipticalDish& eDish,
-                                              unsigned long sides,
-                                              unsigned long csides) {
-  vector<unsigned long> index;
-  vector<Vector3F> points;
-  vector<Vector3F> vectors;
+Mesh RVMMeshHelper2::makeEllipticalDish(const Primitives::EllipticalDish& eDish,
+                                        unsigned long sides,
+                                        unsigned long csides) {
+  Mesh result;
+  makeEllipticalDish(eDish, sides, csides, result);
+  return result;
+}
+
+void RVMMeshHelper2::makeEllipticalDish(const Primitives::EllipticalDish& eDish,
+                                        unsigned long sides,
+                                        unsigned long csides,
+                                        Mesh& result) {
+  // csides vertexes per ring and the top, 2 triangles per side between rings and csides at the top.
+  const size_t vertexCount = size_t(sides) * csides + 1;
+  reset_(result, vertexCount, vertexCount, ((sides > 0 ? sides - 1 : 0) * 6 + 3) * size_t(csides), 0);
+  RVMMeshIndex& index = result.positionIndex;
 
   const float dishradius = eDish.diameter();
   const float secondradius = eDish.radius();
@@ -743,23 +736,23 @@ const Mesh RVMMeshHelper2::makeEllipticalDish(const Primitives::EllipticalDish&
       v[0] = dishradius * C * c;
       v[1] = dishradius * S * c;
       v[2] = secondradius * s;
-      points.push_back(v);
+      result.addPosition(v);
       n[0] = secondradius * C * c;
       n[1] = secondradius * S * c;
       n[2] = dishradius * s;
       n.normalize();
-      vectors.push_back(n);
+      result.addNormal(n);
     }
   }
 
   v[0] = 0;
   v[1] = 0;
   v[2] = secondradius;
-  points.push_back(v);
+  result.addPosition(v);
   n[0] = 0;
   n[1] = 0;
   n[2] = 1;
-  vectors.push_back(n);
+  result.addNormal(n);
 
   // Sides
   for (unsigned long i = 0; i < sides - 1; i++)
@@ -776,20 +769,22 @@ const Mesh RVMMeshHelper2::makeEllipticalDish(const Primitives::EllipticalDish&
   for (unsigned long i = 0; i < csides; i++) {
     index.push_back(csides * (sides - 1) + i);
     index.push_back(i == csides - 1 ? csides * (sides - 1) : csides * (sides - 1) + i + 1);
-    index.push_back(static_cast<unsigned long>(points.size()) - 1);
+    index.push_back(static_cast<unsigned long>(result.positionCount()) - 1);
   }
+}
 
+Mesh RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sDish,
+                                       const float& maxSideSize,
+                                       const int& minSides) {
   Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  result.normals = vectors;
-
+  makeSphericalDish(sDish, maxSideSize, minSides, result);
   return result;
 }
 
-const Mesh RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sDish,
-                                             const float& maxSideSize,
-                                             const int& minSides) {
+void RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sDish,
+                                       const float& maxSideSize,
+                                       const int& minSides,
+                                       Mesh& result) {
   const float dishradius = sDish.diameter() / 2.0f;
 
   // Asking for a sphere...
@@ -797,13 +792,10 @@ const Mesh RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sD
     Primitives::Sphere s;
     s.diameter = dishradius * 2;
 
-    return makeSphere(s, maxSideSize, minSides);
+    makeSphere(s, maxSideSize, minSides, result);
+    return;
   }
 
-  vector<unsigned long> index;
-  vector<Vector3F> points;
-  vector<Vector3F> vectors;
-
   float radius = (dishradius * dishradius + sDish.height() * sDish.height()) / (2 * sDish.height());
   float angle = asin(1 - sDish.height() / radius);
   int csides = int(2 * M_PI * radius / maxSideSize);
@@ -812,6 +804,11 @@ const Mesh RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sD
   }
   int sides = csides;
 
+  // Same sizes as an elliptical dish.
+  const size_t vertexCount = size_t(max(sides, 0)) * size_t(max(csides, 0)) + 1;
+  reset_(result, vertexCount, vertexCount, size_t(max(sides - 1, 0) * 6 + 3) * size_t(max(csides, 0)), 0);
+  RVMMeshIndex& index = result.positionIndex;
+
   // Position and normals
   Vector3F v;
   Vector3F n;
@@ -824,22 +821,22 @@ const Mesh RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sD
       v[0] = radius * C * c;
       v[1] = radius * S * c;
       v[2] = -(radius - sDish.height() - radius * s);
-      points.push_back(v);
+      result.addPosition(v);
       n[0] = radius * C * c;
       n[1] = radius * S * c;
       n[2] = radius * s;
       n.normalize();
-      vectors.push_back(n);
+      result.addNormal(n);
     }
   }
   v[0] = 0;
   v[1] = 0;
   v[2] = sDish.height();
-  points.push_back(v);
+  result.addPosition(v);
   n[0] = 0;
   n[1] = 0;
   n[2] = 1;
-  vectors.push_back(n);
+  result.addNormal(n);
 
   // Sides
   for (int i = 0; i < sides - 1; i++) {
@@ -864,71 +861,61 @@ const Mesh RVMMeshHelper2::makeSphericalDish(const Primitives::SphericalDish& sD
     index.push_back(pi);
     pi = i == csides - 1 ? csides * (sides - 1) : csides * (sides - 1) + i + 1;
     index.push_back(pi);
-    pi = static_cast<unsigned long>(points.size()) - 1;
+    pi = static_cast<unsigned long>(result.positionCount()) - 1;
     index.push_back(pi);
   }
-
-  Mesh result;
-  result.positions = points;
-  result.positionIndex = index;
-  result.normals = vectors;
-  return result;
 }
 
-pair<int, bool> createIndex(std::vector<Vertex>& references, const Vertex& newValue) {
-  unsigned int results = std::find(references.begin(), references.end(), newValue) - references.begin();
-  if (results == references.size()) {
-    references.push_back(newValue);
-    return make_pair(results, true);
-  }
-  return make_pair(results, false);
+void RVMMeshHelper2::tesselateFacetGroup(const std::vector<std::vector<std::vector<Vertex> > >& vertices,
+                                         Mesh* userData,
+                                         float weldTolerance) {
+  RVMFacetGroupArena arena;
+  arena.append(vertices);
+  tesselateFacetGroup(arena.facetGroup(0), userData, weldTolerance);
 }
 
-void RVMMeshHelper2::tesselateFacetGroup(const std::vector<std::vector<std::vector<Vertex> > >& vertices,
-                                         Mesh* userData) {
-  GLUtesselator* tobj = gluNewTess();
-  vector<Vertex> indexedVertices;
-  vector<unsigned long> indexArray;
+void RVMMeshHelper2::tesselateFacetGroup(const RVMFacetGroup& facetGroup, Mesh* userData, float weldTolerance) {
+  RVMVertexWelder welder;
+  RVMTriangulator triangulator;
+  tesselateFacetGroup(facetGroup, userData, weldTolerance, welder, triangulator);
+}
 
-  gluTessCallback(tobj, GLU_TESS_EDGE_FLAG_DATA, (void(CALLBACK*)())tessEdgeFlag);
-  gluTessCallback(tobj, GLU_TESS_VERTEX_DATA, (void(CALLBACK*)())tessVertexData);
-  gluTessCallback(tobj, GLU_TESS_COMBINE_DATA, (void(CALLBACK*)())tessCombineData);
-  gluTessCallback(tobj, GLU_ERROR, (void(CALLBACK*)())tessError);
-
-  unsigned long np = 0;
-
-  for (unsigned int i = 0; i < vertices.size(); i++) {
-    for (unsigned int j = 0; j < vertices[i].size(); j++) {
-      for (unsigned int k = 0; k < vertices[i][j].size(); k++) {
-        pair<int, bool> res = createIndex(indexedVertices, vertices[i][j][k]);
-        indexArray.push_back(res.first);
-        if (res.second) {
-          userData->positions.push_back(vertices[i][j][k].first);
-          userData->normals.push_back(vertices[i][j][k].second);
-        }
-        np++;
-      }
-    }
+void RVMMeshHelper2::tesselateFacetGroup(const RVMFacetGroup& facetGroup, Mesh* userData, float weldTolerance,
+                                         RVMVertexWelder& welder, RVMTriangulator& triangulator) {
+  const size_t count = facetGroup.vertexCount();
+  reset_(*userData, 0, 0, 0, 0);
+  if (count == 0) {
+    return;
   }
+  // The contours of a group are contiguous: the vertices are indexed from the first one.
+  const size_t first = facetGroup.contours[facetGroup.contourBegin(0)];
+  const RVMSpan<PositionNormalTuple> vertices = facetGroup.vertices.subspan(first, count);
 
-  unsigned long tessIndex = 0;
-  for (unsigned int i = 0; i < vertices.size(); i++) {
-    gluTessBeginPolygon(tobj, userData);
-    for (unsigned int j = 0; j < vertices[i].size(); j++) {
-      gluTessBeginContour(tobj);
-
-      double coords[3];
-      for (unsigned int k = 0; k < vertices[i][j].size(); k++) {
-        Vector3F vertex(vertices[i][j].at(k).first);
-        coords[0] = vertex[0];
-        coords[1] = vertex[1];
-        coords[2] = vertex[2];
-        gluTessVertex(tobj, coords, (void*)indexArray[tessIndex]);
-        tessIndex++;
-      }
-      gluTessEndContour(tobj);
+  welder.setTolerance(weldTolerance);
+  welder.clear(count);
+  vector<unsigned long> indexArray;
+  indexArray.reserve(count);
+  for (const auto& vertex : vertices) {
+    indexArray.push_back(welder.insert(vertex.first, vertex.second).first);
+  }
+  const vector<Vector3F>& positions = welder.positions();
+  const vector<Vector3F>& normals = welder.normals();
+  // Vector3F is 3 packed floats, as the arrays of the mesh.
+  static_assert(sizeof(Vector3F) == 3 * sizeof(float), "Vector3F has to be 3 packed floats");
+  const float* positionValues = reinterpret_cast<const float*>(positions.data());
+  const float* normalValues = reinterpret_cast<const float*>(normals.data());
+  userData->positions.assign(positionValues, positionValues + positions.size() * 3);
+  userData->normals.assign(normalValues, normalValues + normals.size() * 3);
+
+  vector<unsigned long> triangles;
+  vector<size_t> contourSizes;
+  for (size_t p = 0; p < facetGroup.polygonCount(); p++) {
+    contourSizes.clear();
+    for (size_t c = facetGroup.contourBegin(p); c < facetGroup.contourEnd(p); c++) {
+      contourSizes.push_back(facetGroup.contours[c + 1] - facetGroup.contours[c]);
     }
-    gluTessEndPolygon(tobj);
+    const size_t tessIndex = facetGroup.contours[facetGroup.contourBegin(p)] - first;
+    triangulator.triangulate(positions, indexArray.data() + tessIndex, contourSizes.data(), contourSizes.size(), triangles);
   }
-  gluDeleteTess(tobj);
+  userData->positionIndex.assign(triangles.begin(), triangles.end(), positions.size());
 }
@@ -27,13 +27,30 @@
 #include <algorithm>
 
 #include "vector3f.h"
+#include "rvmfacetgroup.h"
+#include "rvmmeshindex.h"
 #include "rvmprimitive.h"
+#include "rvmtriangulator.h"
+#include "rvmvertexwelder.h"
 
+/**
+ * @brief A tesselated primitive: vertices and triangles.
+ *
+ * Positions and normals are contiguous arrays of floats, x, y, z for each vertex, that writers take as they are.
+ * Triangles are given by positionIndex, 3 indices each. normalIndex is empty when normals share the position indices.
+ */
 struct Mesh {
- std::vector<unsigned long>  positionIndex;
- std::vector<unsigned long>  normalIndex;
- std::vector<Vector3F>  positions;
- std::vector<Vector3F>  normals;
+ RVMMeshIndex  positionIndex;
+ RVMMeshIndex  normalIndex;
+ std::vector<float>  positions;
+ std::vector<float>  normals;
+
+ inline size_t positionCount() const { return positions.size() / 3; }
+ inline size_t normalCount() const { return normals.size() / 3; }
+ inline Vector3F position(size_t i) const { return Vector3F(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]); }
+ inline Vector3F normal(size_t i) const { return Vector3F(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]); }
+ inline void addPosition(const Vector3F& v) { positions.insert(positions.end(), v.m_values, v.m_values + 3); }
+ inline void addNormal(const Vector3F& v) { normals.insert(normals.end(), v.m_values, v.m_values + 3); }
 };
 
 
@@ -54,6 +71,13 @@ enum PrimitiveTypes {
 
 typedef std::pair<Vector3F, Vector3F> Vertex;
 
+/**
+ * @brief Tesselates the RVM primitives.
+ *
+ * Each mesh builder comes in two forms: one returning a new mesh, and one filling a mesh given by the caller.
+ * The second empties the mesh but keeps its memory, so that a mesh reused for many primitives
+ * stops allocating once it is large enough. Sizes are reserved exactly from the numbers of sides.
+ */
 class RVMMeshHelper2
 {
     public:
@@ -67,7 +91,8 @@ class RVMMeshHelper2
          * @param minSides not used here. For consistency with the other methods.
          * @return vertexes coordinates and their index.
          */
-        static const Mesh makePyramid(const Primitives::Pyramid& inP, const float& maxSideSize, const int& minSides);
+        static Mesh makePyramid(const Primitives::Pyramid& inP, const float& maxSideSize, const int& minSides);
+        static void makePyramid(const Primitives::Pyramid& inP, const float& maxSideSize, const int& minSides, Mesh& result);
 
         /**
          * @brief Builds up indexed coordinates for the described box
@@ -78,7 +103,8 @@ class RVMMeshHelper2
          * @param minSides not used here. For consistency with the other methods.
          * @return vertexes coordinates and their index.
          */
-        static const Mesh makeBox(const Primitives::Box& box, const float& maxSideSize, const int& minSides);
+        static Mesh makeBox(const Primitives::Box& box, const float& maxSideSize, const int& minSides);
+        static void makeBox(const Primitives::Box& box, const float& maxSideSize, const int& minSides, Mesh& result);
 
         /**
          * @brief Builds up a sphere with the given radius
@@ -87,7 +113,8 @@ class RVMMeshHelper2
          * @param minSides
          * @return coordinates and normals with their indexes.
          */
-        static const Mesh makeSphere(const Primitives::Sphere &sphere, const float& maxSideSize, const int& minSides);
+        static Mesh makeSphere(const Primitives::Sphere &sphere, const float& maxSideSize, const int& minSides);
+        static void makeSphere(const Primitives::Sphere &sphere, const float& maxSideSize, const int& minSides, Mesh& result);
 
         /**
          * @brief makeCylinder
@@ -97,7 +124,8 @@ class RVMMeshHelper2
          *
          * @return Returns a mesh object.
          */
-        static const Mesh makeCylinder(const Primitives::Cylinder &cylinder, unsigned long sides);
+        static Mesh makeCylinder(const Primitives::Cylinder &cylinder, unsigned long sides);
+        static void makeCylinder(const Primitives::Cylinder &cylinder, unsigned long sides, Mesh& result);
 
         /**
          * @brief makeRectangularTorus
@@ -106,7 +134,8 @@ class RVMMeshHelper2
          * @param minSides
          * @return
          */
-        static const Mesh makeRectangularTorus(const Primitives::RectangularTorus& rt, const float& maxSideSize, const int& minSides);
+        static Mesh makeRectangularTorus(const Primitives::RectangularTorus& rt, const float& maxSideSize, const int& minSides);
+        static void makeRectangularTorus(const Primitives::RectangularTorus& rt, const float& maxSideSize, const int& minSides, Mesh& result);
 
         /**
          * @brief makeCircularTorus
@@ -117,7 +146,8 @@ class RVMMeshHelper2
          * @param minSides
          * @return
          */
-        static const Mesh makeCircularTorus(const Primitives::CircularTorus& cTorus, unsigned long tsides, unsigned long csides);
+        static Mesh makeCircularTorus(const Primitives::CircularTorus& cTorus, unsigned long tsides, unsigned long csides);
+        static void makeCircularTorus(const Primitives::CircularTorus& cTorus, unsigned long tsides, unsigned long csides, Mesh& result);
 
         /**
          * @brief makeSnout
@@ -130,7 +160,8 @@ class RVMMeshHelper2
          * @param minSides
          * @return
          */
-        static const Mesh makeSnout(const Primitives::Snout& snout, unsigned long sides);
+        static Mesh makeSnout(const Primitives::Snout& snout, unsigned long sides);
+        static void makeSnout(const Primitives::Snout& snout, unsigned long sides, Mesh& result);
 
         /**
          * @brief makeEllipticalDish
@@ -140,7 +171,8 @@ class RVMMeshHelper2
          * @param csides
          * @return
          */
-        static const Mesh makeEllipticalDish(const Primitives::EllipticalDish& eDish, unsigned long sides, unsigned long csides);
+        static Mesh makeEllipticalDish(const Primitives::EllipticalDish& eDish, unsigned long sides, unsigned long csides);
+        static void makeEllipticalDish(const Primitives::EllipticalDish& eDish, unsigned long sides, unsigned long csides, Mesh& result);
 
         /**
          * @brief makeSphericalDish
@@ -150,10 +182,38 @@ class RVMMeshHelper2
          * @param minSides
          * @return
          */
-        static const Mesh makeSphericalDish(const Primitives::SphericalDish& sDish , const float& maxSideSize, const int& minSides);
+        static Mesh makeSphericalDish(const Primitives::SphericalDish& sDish , const float& maxSideSize, const int& minSides);
+        static void makeSphericalDish(const Primitives::SphericalDish& sDish , const float& maxSideSize, const int& minSides, Mesh& result);
 
 
-        static void tesselateFacetGroup(const std::vector<std::vector<std::vector<Vertex> > >& vertices, Mesh* meshData);
+        /**
+         * @brief Triangulates the polygons of a facet group, @see RVMTriangulator
+         * @param vertices polygons, each made of contours of vertices.
+         * @param meshData receives the vertices, once each, and the triangles. Its previous content is replaced.
+         * @param weldTolerance vertices with the same normal closer than this are merged, @see RVMVertexWelder
+         */
+        static void tesselateFacetGroup(const std::vector<std::vector<std::vector<Vertex> > >& vertices, Mesh* meshData,
+                                        float weldTolerance = 0.f);
+        /**
+         * @brief Triangulates the polygons of a facet group stored flat, without copying it.
+         * @param facetGroup the polygons, each made of contours of vertices.
+         * @param meshData receives the vertices, once each, and the triangles. Its previous content is replaced,
+         * keeping its memory.
+         * @param weldTolerance vertices with the same normal closer than this are merged, @see RVMVertexWelder
+         */
+        static void tesselateFacetGroup(const RVMFacetGroup& facetGroup, Mesh* meshData, float weldTolerance = 0.f);
+        /**
+         * @brief Triangulates the polygons of a facet group with a welder and a triangulator kept by the caller,
+         * so that their buffers are reused from one facet group to the next.
+         * @param facetGroup the polygons, each made of contours of vertices.
+         * @param meshData receives the vertices, once each, and the triangles. Its previous content is replaced,
+         * keeping its memory.
+         * @param weldTolerance vertices with the same normal closer than this are merged.
+         * @param welder cleared, then used to merge the vertices.
+         * @param triangulator used for all the polygons.
+         */
+        static void tesselateFacetGroup(const RVMFacetGroup& facetGroup, Mesh* meshData, float weldTolerance,
+                                        RVMVertexWelder& welder, RVMTriangulator& triangulator);
 
         /**
          * @param cylinder The cylinder primitive data.
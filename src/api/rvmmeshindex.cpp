@@ -0,0 +1,54 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmmeshindex.h"
+
+using namespace std;
+
+void RVMMeshIndex::reset(size_t vertexCount, size_t capacity) {
+    m_narrowIndices.clear();
+    m_wideIndices.clear();
+    m_wide = vertexCount > 0x10000;
+    if (m_wide) {
+        m_wideIndices.reserve(capacity);
+    } else {
+        m_narrowIndices.reserve(capacity);
+    }
+}
+
+void RVMMeshIndex::widen() {
+    m_wideIndices.assign(m_narrowIndices.begin(), m_narrowIndices.end());
+    m_narrowIndices.clear();
+    m_wide = true;
+}
+
+bool operator==(const RVMMeshIndex& a, const RVMMeshIndex& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
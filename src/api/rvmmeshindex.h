@@ -0,0 +1,108 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMMESHINDEX_H
+#define RVMMESHINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Vertex indices of a mesh, stored on 16 bits when the mesh has at most 65536 vertices, on 32 bits otherwise.
+ *
+ * Primitive meshes almost always fit 16 bits: their indices take a quarter of the memory
+ * of unsigned long ones. The width is chosen by reset from the number of vertices,
+ * and an index too large for 16 bits switches the storage to 32 bits, so that no index is ever truncated.
+ */
+class RVMMeshIndex
+{
+    public:
+        RVMMeshIndex() : m_wide(false) {}
+
+        /**
+         * @brief Removes all the indices, keeping the allocated memory, and chooses the width for the next ones.
+         * @param vertexCount number of vertices of the mesh.
+         * @param capacity number of indices to reserve.
+         */
+        void reset(size_t vertexCount, size_t capacity = 0);
+
+        inline void push_back(uint32_t index) {
+            if (m_wide) {
+                m_wideIndices.push_back(index);
+            } else if (index <= 0xFFFF) {
+                m_narrowIndices.push_back(uint16_t(index));
+            } else {
+                widen();
+                m_wideIndices.push_back(index);
+            }
+        }
+
+        /**
+         * @brief Replaces the indices by a range of integers, all lower than vertexCount.
+         */
+        template<typename Iterator>
+        void assign(Iterator first, Iterator last, size_t vertexCount) {
+            reset(vertexCount);
+            if (m_wide) {
+                m_wideIndices.assign(first, last);
+            } else {
+                m_narrowIndices.assign(first, last);
+            }
+        }
+
+        /**
+         * @brief Copies the indices to an array of size() integers.
+         */
+        template<typename T>
+        void copy(T* out) const {
+            if (m_wide) {
+                for (uint32_t index : m_wideIndices) *out++ = T(index);
+            } else {
+                for (uint16_t index : m_narrowIndices) *out++ = T(index);
+            }
+        }
+
+        inline uint32_t operator[](size_t i) const { return m_wide ? m_wideIndices[i] : m_narrowIndices[i]; }
+        inline size_t size() const { return m_wide ? m_wideIndices.size() : m_narrowIndices.size(); }
+        inline bool empty() const { return size() == 0; }
+        inline size_t capacity() const { return m_wide ? m_wideIndices.capacity() : m_narrowIndices.capacity(); }
+
+        /// True if the indices are stored on 32 bits.
+        inline bool wide() const { return m_wide; }
+        /// The indices when stored on 16 bits, empty otherwise.
+        inline const std::vector<uint16_t>& narrowIndices() const { return m_narrowIndices; }
+        /// The indices when stored on 32 bits, empty otherwise.
+        inline const std::vector<uint32_t>& wideIndices() const { return m_wideIndices; }
+
+        friend bool operator==(const RVMMeshIndex& a, const RVMMeshIndex& b);
+        friend bool operator!=(const RVMMeshIndex& a, const RVMMeshIndex& b) { return !(a == b); }
+
+    private:
+        void widen();
+
+        std::vector<uint16_t>   m_narrowIndices;
+        std::vector<uint32_t>   m_wideIndices;
+        bool                    m_wide;
+};
+
+#endif // RVMMESHINDEX_H
@@ -0,0 +1,179 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmmulticastreader.h"
+
+using namespace std;
+
+RVMMulticastReader::RVMMulticastReader() {
+}
+
+RVMMulticastReader::RVMMulticastReader(const vector<RVMReader*>& readers) :
+    m_readers(readers) {
+}
+
+RVMMulticastReader::~RVMMulticastReader() {
+}
+
+void RVMMulticastReader::startDocument() {
+    for (RVMReader* reader : m_readers) {
+        reader->startDocument();
+    }
+}
+
+void RVMMulticastReader::endDocument() {
+    for (RVMReader* reader : m_readers) {
+        reader->endDocument();
+    }
+}
+
+void RVMMulticastReader::startHeader(const string& banner, const string& fileNote, const string& date, const string& user, const string& encoding) {
+    for (RVMReader* reader : m_readers) {
+        reader->startHeader(banner, fileNote, date, user, encoding);
+    }
+}
+
+void RVMMulticastReader::endHeader() {
+    for (RVMReader* reader : m_readers) {
+        reader->endHeader();
+    }
+}
+
+void RVMMulticastReader::startModel(const string& projectName, const string& name) {
+    for (RVMReader* reader : m_readers) {
+        reader->startModel(projectName, name);
+    }
+}
+
+void RVMMulticastReader::endModel() {
+    for (RVMReader* reader : m_readers) {
+        reader->endModel();
+    }
+}
+
+void RVMMulticastReader::startGroup(const string& name, const Vector3F& translation, const int& materialId) {
+    for (RVMReader* reader : m_readers) {
+        reader->startGroup(name, translation, materialId);
+    }
+}
+
+void RVMMulticastReader::endGroup() {
+    for (RVMReader* reader : m_readers) {
+        reader->endGroup();
+    }
+}
+
+void RVMMulticastReader::startMetaData() {
+    for (RVMReader* reader : m_readers) {
+        reader->startMetaData();
+    }
+}
+
+void RVMMulticastReader::endMetaData() {
+    for (RVMReader* reader : m_readers) {
+        reader->endMetaData();
+    }
+}
+
+void RVMMulticastReader::startMetaDataPair(string_view name, string_view value) {
+    for (RVMReader* reader : m_readers) {
+        reader->startMetaDataPair(name, value);
+    }
+}
+
+void RVMMulticastReader::endMetaDataPair() {
+    for (RVMReader* reader : m_readers) {
+        reader->endMetaDataPair();
+    }
+}
+
+void RVMMulticastReader::createPyramid(const array<float, 12>& matrix, const Primitives::Pyramid& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createPyramid(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createBox(const array<float, 12>& matrix, const Primitives::Box& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createBox(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createRectangularTorus(const array<float, 12>& matrix, const Primitives::RectangularTorus& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createRectangularTorus(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createCircularTorus(const array<float, 12>& matrix, const Primitives::CircularTorus& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createCircularTorus(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createEllipticalDish(const array<float, 12>& matrix, const Primitives::EllipticalDish& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createEllipticalDish(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createSphericalDish(const array<float, 12>& matrix, const Primitives::SphericalDish& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createSphericalDish(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createSnout(const array<float, 12>& matrix, const Primitives::Snout& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createSnout(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createCylinder(const array<float, 12>& matrix, const Primitives::Cylinder& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createCylinder(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createSphere(const array<float, 12>& matrix, const Primitives::Sphere& params) {
+    for (RVMReader* reader : m_readers) {
+        reader->createSphere(matrix, params);
+    }
+}
+
+void RVMMulticastReader::createLine(const array<float, 12>& matrix, const float& startx, const float& endx) {
+    for (RVMReader* reader : m_readers) {
+        reader->createLine(matrix, startx, endx);
+    }
+}
+
+void RVMMulticastReader::createFacetGroup(const array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
+    for (RVMReader* reader : m_readers) {
+        reader->createFacetGroup(matrix, facetGroup);
+    }
+}
+
+void RVMMulticastReader::updateColorPalette(uint32_t index, const array<uint8_t, 4>& color) {
+    for (RVMReader* reader : m_readers) {
+        reader->updateColorPalette(index, color);
+    }
+}
@@ -27,11 +27,21 @@
 #include <sstream>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 #include <algorithm>
 #include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <thread>
 #include <stdint.h>
 
 #include "rvmreader.h"
+#include "rvmcursor.h"
+#include "rvmmappedfile.h"
+#include "rvmeventbuffer.h"
+#include "rvmscenemodel.h"
 
 using namespace std;
 
@@ -41,21 +51,6 @@ using namespace std;
 #define PATHSEP '/'
 #endif
 
-/**
- * List of all RVM keywords used inside the RVM format
- */
-static const std::vector<const char*> RVM_KEYWORDS = {
-    "HEAD",
-    "END",
-    "MODL",
-    "CNTB",
-    "PRIM",
-    "CNTE",
-    "COLR"
-};
-
-typedef std::vector<std::vector<std::vector<std::pair<Vector3F, Vector3F>>>>        FacetGroup;
-
 union Primitive
 {
     Primitives::Box                 box;
@@ -69,62 +64,22 @@ union Primitive
     Primitives::Sphere              sphere;
 };
 
-/**
- * Identifier class
- */
-
-struct Identifier
-{
-    inline bool operator==(const char* rhs) const
-    {
-        return chrs[0] == rhs[0] && chrs[1] == rhs[1]
-            && chrs[2] == rhs[2] && chrs[3] == rhs[3];
-    }
-
-    inline bool operator!=(const char* rhs) const
-    {
-        return chrs[0] != rhs[0] || chrs[1] != rhs[1]
-            || chrs[2] != rhs[2] || chrs[3] != rhs[3];
-    }
-
-    inline bool empty() const
-    {
-        return *chrs == 0;
-    }
-
-    bool isValid() const
-    {
-        for(const auto &keyword : RVM_KEYWORDS)
-            if(*this == keyword)
-                return true;
-
-        return false;
-    }
-
-    inline std::string toString() const
-    {
-        return std::string(chrs, chrs + 4);
-    }
-
-    char        chrs[4];
-};
-
 ///////////////////////////////////
 //// Multiple read functions
 ///////////////////////////////////
 
 template<typename T>
-inline T& read_(std::istream& in, T& value)
+inline T& read_(RVMCursor& in, T& value)
 {
-    char *charPtr = reinterpret_cast<char*>(&value);
-    for (size_t i = 0; i < sizeof(T); ++i)
-        charPtr[sizeof(T) - 1 - i] = in.get();
+    static_assert(sizeof(T) == 4, "RVM values are 32 bit words");
+    const uint32_t word = in.readUInt32();
+    memcpy(&value, &word, sizeof(T));
 
     return value;
 }
 
 template<typename T>
-inline T read_(std::istream& in)
+inline T read_(RVMCursor& in)
 {
     T value;
     read_(in, value);
@@ -133,305 +88,88 @@ inline T read_(std::istream& in)
 }
 
 template<>
-inline Identifier& read_<Identifier>(std::istream& in, Identifier& res)
+inline Identifier& read_<Identifier>(RVMCursor& in, Identifier& res)
 {
-    static char buf[12];
-    auto chrs = res.chrs;
-
-    // read the first 12 bytes and extract the first 3 characters
-    in.read(buf, 12);
-    {
-        char* ptr = buf;
-
-        for (int i = 0; i < 3; ++i, ptr += 4)
-        {
-            // the first three bytes of the current double word have to be zero
-            if (ptr[0] != 0 || ptr[1] != 0 || ptr[2] != 0)
-            {
-                *chrs = 0;
-                return res;
-            }
-
-            // extract character
-            chrs[i] = ptr[3];
-        }
-    }
-
-    // check if we have the end identifier
-    if (chrs[0] == 'E' && chrs[1] == 'N' && chrs[2] == 'D')
-        chrs[3] = 0;
-    else
-    {
-        in.read(buf, 4);
-        if (buf[0] != 0 || buf[1] != 0 || buf[2] != 0)
-        {
-            *chrs = 0;
-            return res;
-        }
-
-        chrs[3] = buf[3];
-    }
-
-    return res;
+    return in.readIdentifier(res);
 }
 
 template<>
-string& read_<string>(istream& is, string& str)
+inline string& read_<string>(RVMCursor& in, string& str)
 {
-    const unsigned int size = read_<unsigned int>(is) * 4;
-    if (size == 0)
-    {
-        str.empty();
-        return str;
-    }
-
-#ifndef ICONV_FOUND
-
-    str.resize(size);
-    unsigned int rs = 0;
-    for(unsigned int i = 0; i < size; ++i) {
-        str[i] = is.get();
-        if(str[i] == 0 && !rs) {
-            rs = i;
-        }
-    }
-    if(rs) {
-        str.resize(rs);
-    }
-
-#else
-
-    char buffer[1024];
-    buffer[0] = 0;
-    is.read(buffer, size);
-    buffer[size] = 0;
-
-    // If already in UTF-8, no change
-    if (m_cd == (iconv_t)-1)
-    {
-        str = buffer;
-        return str;
-    }
-
-    // Encoding conversion.
-    char cbuffer[1056];
-    size_t inb = strlen(buffer);
-    size_t outb = 1056;
-    char* bp = cbuffer;
-#ifdef __APPLE__
-    char* sp = buffer;
-#else
-    const char* sp = buffer;
-#endif
-    iconv(m_cd, &sp, &inb, &bp, &outb);
-    str = cbuffer;
-#endif
-    return str;
+    return in.readString(str);
 }
 
 /**
- * Reads until either the end of the stream has been reached or a valid keyword has been found.
+ * Reads until either the end of the data has been reached or a valid keyword has been found.
  *
- * @param in - The input stream
+ * @param in - The input cursor
  * @param outIdentifier - Reference for returning the keyword if one has been found.
  *
- * @return Returns true if a valid identifier has been found and false if the end of the stream has been reached.
+ * @return Returns true if a valid identifier has been found and false if the end of the data has been reached.
  */
-static bool readUntilValidIdentifier(std::istream& in, Identifier& outIdentifier)
+static bool readUntilValidIdentifier(RVMCursor& in, Identifier& outIdentifier)
 {
-    // internal buffer for storing previously read bytes
-    std::array<char, 16> buf;
-    std::size_t numBufBytes = 0;
-
-    // pointer onto the characters of the outgoing identifier
-    auto outChars = outIdentifier.chrs;
-
-    // lambda for removing the first byte of the buffer
-    auto removeFirstByte = [&buf, &numBufBytes]()
-    {
-        assert(!buf.empty());
-
-        std::copy(buf.begin() + 1, buf.end(), buf.begin());
-        -- numBufBytes;
-    };
-
-    // fill buffer up to the given amount of bytes
-    auto readBytesUntil = [&buf, &numBufBytes, &in](const std::size_t numBytes)
-    {
-        assert(numBytes <= 16);
-
-        if(numBytes > numBufBytes)
-        {
-            in.read(buf.data() + numBufBytes, numBytes - numBufBytes);
-            numBufBytes = numBytes;
-        }
-    };
-
-    // read as long as we have not reached the end of the stream
-    for(;in; removeFirstByte())
-    {
-        // ensure, that there are at least twelve bytes in the buffer
-        readBytesUntil(12);
-
-        // interpret the first 3 characters (12 bytes)
-        auto readFirstThreeChars = [&buf, &outChars]() -> bool
-        {
-            auto ptr = buf.begin();
-
-            for (std::size_t i = 0; i < 3; ++i, ptr += 4)
-            {
-                // the first three bytes of the current double word have to be zero
-                if (ptr[0] != 0 || ptr[1] != 0 || ptr[2] != 0)
-                    return false;
-
-                // extract character
-                outChars[i] = ptr[3];
-            }
-
-            return true;
-        };
-
-        if(!readFirstThreeChars())
-            continue;
-
-        // check if we got the end identifier
-        if(std::equal(outChars, outChars + 3, "END"))
-        {
-            outChars[3] = 0;
-            return true;
-        }
-
-        // check/read the next 4 bytes, i.e., the last character
-        auto readLastChar = [&buf, &readBytesUntil, &outChars]() -> bool
-        {
-            auto ptr = buf.begin() + 12;
-
-            // Check that the first 3 bytes are zero.
-            // Here, we are a little bit more carefull to read as few bytes as needed
-            for(std::size_t i=0; i<3; ++i)
-            {
-                // check if buffer is large enough
-                readBytesUntil(13 + i);
-
-                // stop reading if an invalid character is encountered
-                if(ptr[i] != 0)
-                    return false;
-            }
-
-            // finally, read last byte
-            readBytesUntil(16);
-            outChars[3] = ptr[3];
-
-            return true;
-        };
-
-        if(!readLastChar())
-            continue;
-
-        // finally check if identifier is valid
-        if(outIdentifier.isValid())
-            return true;
-    }
+    if (!in.findIdentifier())
+        return false;
 
-    return false;
+    in.readIdentifier(outIdentifier);
+    return true;
 }
 
-static FacetGroup& readFacetGroup_(std::istream& is, FacetGroup& res)
+static RVMFacetGroup readFacetGroup_(RVMCursor& in, RVMFacetGroupArena& res)
 {
+    static_assert(sizeof(PositionNormalTuple) == 6 * sizeof(float), "Vertices are decoded in place");
     res.clear();
-    res.resize(read_<unsigned int>(is));
-
-    for (auto& p : res)
+    // Each polygon, contour and vertex takes at least 4 bytes: do not trust sizes that can not fit in the data.
+    // Polygons and contours left after a wrong size are kept empty.
+    unsigned int nbPolygons = read_<unsigned int>(in);
+    if (nbPolygons > in.remaining() / 4) {
+        in.skip(in.remaining() + 1);
+        res.endFacetGroup();
+        return res.facetGroup(0);
+    }
+    bool failed = false;
+    for (unsigned int p = 0; p < nbPolygons; p++)
     {
-        p.resize(read_<unsigned int>(is));
-        for (auto& g : p)
+        unsigned int nbContours = failed ? 0 : read_<unsigned int>(in);
+        if (nbContours > in.remaining() / 4) {
+            in.skip(in.remaining() + 1);
+            failed = true;
+            nbContours = 0;
+        }
+        for (unsigned int c = 0; c < nbContours; c++)
         {
-            g.resize(read_<unsigned int>(is));
-            for (auto& v : g)
-            {
-                float x = read_<float>(is);
-                float y = read_<float>(is);
-                float z = read_<float>(is);
-                v.first = Vector3F(x, y, z);
-                x = read_<float>(is);
-                y = read_<float>(is);
-                z = read_<float>(is);
-                v.second = Vector3F(x, y, z);
+            unsigned int nbVertices = failed ? 0 : read_<unsigned int>(in);
+            if (nbVertices > in.remaining() / 24) {
+                in.skip(in.remaining() + 1);
+                failed = true;
+                nbVertices = 0;
             }
+            // Vertices and normals of a contour are stored as one run of floats, decoded at once.
+            PositionNormalTuple* vertices = res.addContour(nbVertices);
+            in.readFloats(reinterpret_cast<float*>(vertices), size_t(nbVertices) * 6);
         }
+        res.endPolygon();
     }
-    return res;
+    res.endFacetGroup();
+    return res.facetGroup(0);
 }
 
 
-template<typename T, size_t size>
-void readArray_(std::istream &in, T(&a)[size])
+template<size_t size>
+inline void readArray_(RVMCursor &in, float(&a)[size])
 {
-    for (size_t i = 0; i < size; ++i)
-        read_<T>(in, a[i]);
+    in.readFloats(a, size);
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-/// Implementation of a skip function
-/// Surprisingly, multiple calling get() multiple times seems to be faster than seekg.
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 template<size_t numInts>
-inline void skip_(std::istream& in)
-{
-    in.seekg(sizeof(int) * numInts, in.cur);
-}
-
-template<>
-inline void skip_<1>(std::istream& in)
+inline void skip_(RVMCursor& in)
 {
-    in.get();
-    in.get();
-    in.get();
-    in.get();
-}
-
-template<>
-inline void skip_<2>(std::istream& in)
-{
-    skip_<1>(in);
-    skip_<1>(in);
-}
-
-template<>
-inline void skip_<3>(std::istream& in)
-{
-    skip_<1>(in);
-    skip_<1>(in);
-    skip_<1>(in);
+    in.skip(sizeof(int) * numInts);
 }
 
 namespace {
 
-    static string trim(const string& s)
-    {
-        size_t si = s.find_first_not_of(" \n\r\t");
-        if (si == string::npos) {
-            return "";
-        }
-        size_t ei = s.find_last_not_of(" \n\r\t");
-        return s.substr(si, ei - si + 1);
-    }
-
-    static string latin_to_utf8(const string& latin) {
-        string result;
-        for(uint8_t c: latin) {
-            if(c < 0x80) {
-                result += c;
-            } else {
-                // Found non-ASCII character, assume ISO 8859-1
-                result += (0xc0 | (c & 0xc0) >> 6);
-                result += (0x80 | (c & 0x3f));
-            }
-        }
-        return result;
-    }
-
     static void scaleMatrix(std::array<float, 12>& matrix, float factor) {
         for (int i = 0; i < 4; i++) {
             for (int j = 0; j < 3; j++) {
@@ -440,6 +178,11 @@ namespace {
         }
     }
 
+    /// Name of the group holding an aggregated file.
+    inline string aggregateGroupName(const string& filename) {
+        return filename.substr(filename.rfind(PATHSEP) + 1, filename.find_last_of("."));
+    }
+
 }
 
 RVMParser::RVMParser(RVMReader& reader) :
@@ -447,7 +190,14 @@ RVMParser::RVMParser(RVMReader& reader) :
     m_objectName(""),
     m_objectFound(0),
     m_forcedColor(-1),
+    m_aggregation(false),
     m_scale(1.),
+    m_useIndex(false),
+    m_useCache(false),
+    m_jobs(1),
+    m_resync(false),
+    m_indexLoaded(false),
+    m_indexTime(0),
     m_nbGroups(0),
     m_nbPyramids(0),
     m_nbBoxes(0),
@@ -460,50 +210,157 @@ RVMParser::RVMParser(RVMReader& reader) :
     m_nbSpheres(0),
     m_nbLines(0),
     m_nbFacetGroups(0),
-    m_attributeStream(0),
     m_attributes(0),
-    m_aggregation(false) {
+    m_nbResyncs(0),
+    m_log(&cout) {
 }
 
 bool RVMParser::readFile(const string& filename, bool ignoreAttributes)
 {
     m_lastError = "";
 
-    // Open RVM file
-    ifstream is(filename.data(), ios::binary);
-    if (!is.is_open()) {
+    // Map RVM file
+    RVMMappedFile file;
+    if (!file.open(filename)) {
         m_lastError = "Could not open file";
         return false;
     }
 
+    if (m_useCache) {
+        return readCachedFile(filename, file, ignoreAttributes);
+    }
+
     // Try to find ATT companion file
-    m_attributeStream = 0;
-    filebuf afb;
+    m_attributeFile.close();
     if (!ignoreAttributes) {
         string attfilename = filename.substr(0, filename.find_last_of(".")) + ".att";
-        if (afb.open(attfilename.data(), ios::in)) {
-            cout << "Found attribute companion file: " << attfilename << endl;
-            m_attributeStream = new istream(&afb);
+        if (m_attributeFile.open(attfilename)) {
+            *m_log << "Found attribute companion file: " << attfilename << endl;
         } else {
             attfilename = filename.substr(0, filename.find_last_of(".")) + ".ATT";
-            if (afb.open(attfilename.data(), ios::in)) {
-                cout << "Found attribute companion file: " << attfilename << endl;
-                m_attributeStream = new istream(&afb);
+            if (m_attributeFile.open(attfilename)) {
+                *m_log << "Found attribute companion file: " << attfilename << endl;
             }
         }
-        if (m_attributeStream && !m_attributeStream->eof()) {
-            std::getline(*m_attributeStream, m_currentAttributeLine, '\n');
+    }
+
+    // Load the chunk index sidecar, or remember where to save it once built.
+    m_indexLoaded = false;
+    m_indexFilename.clear();
+    if (m_useIndex && (!m_objectName.empty() || m_jobs > 1)) {
+        const string indexFilename = RVMIndex::indexFilename(filename);
+        m_indexTime = file.modificationTime();
+        m_indexLoaded = m_index.load(indexFilename, file.size(), m_indexTime);
+        if (m_indexLoaded) {
+            *m_log << "Found chunk index file: " << indexFilename << endl;
+        } else {
+            m_indexFilename = indexFilename;
         }
     }
 
+    RVMCursor is(file.data(), file.size());
+    bool success = parse(is);
 
-    bool success = readStream(is);
+    m_indexLoaded = false;
+    m_indexFilename.clear();
 
-    is.close();
+    m_attributeFile.close();
 
     return success;
 }
 
+bool RVMParser::readCachedFile(const string& filename, const RVMMappedFile& file, bool ignoreAttributes)
+{
+    // The cache is only valid for the same RVM and ATT files, read with the same settings.
+    ostringstream key;
+    key << file.size() << " " << file.modificationTime();
+    if (!ignoreAttributes) {
+        const string basename = filename.substr(0, filename.find_last_of("."));
+        RVMMappedFile attributeFile;
+        if (attributeFile.open(basename + ".att") || attributeFile.open(basename + ".ATT")) {
+            key << " " << attributeFile.size() << " " << attributeFile.modificationTime();
+        }
+    }
+    key << "\n" << m_objectName << "\n" << m_forcedColor << " " << m_scale << " " << m_resync << " " << m_aggregation;
+    key << "\n" << m_attributeFilter;
+
+    const string cacheFilename = RVMSceneModel::cacheFilename(filename);
+    RVMSceneModel model;
+    if (model.load(cacheFilename, key.str())) {
+        *m_log << "Found scene cache file: " << cacheFilename << endl;
+        addStatistics(model);
+        model.replay(m_reader);
+        return true;
+    }
+
+    RVMParser parser(model);
+    copySettings(parser);
+    parser.m_aggregation = m_aggregation;
+    parser.m_jobs = m_jobs;
+    parser.m_useCache = false;
+    parser.m_log = m_log;
+    const bool success = parser.readFile(filename, ignoreAttributes);
+    addStatistics(parser);
+    model.replay(m_reader);
+    if (!success) {
+        m_lastError = parser.m_lastError;
+        return false;
+    }
+    if (parser.m_nbResyncs == 0) {
+        model.save(cacheFilename, key.str());
+    }
+    return true;
+}
+
+void RVMParser::copySettings(RVMParser& parser) const
+{
+    parser.m_objectName = m_objectName;
+    parser.m_forcedColor = m_forcedColor;
+    parser.m_scale = m_scale;
+    parser.m_useIndex = m_useIndex;
+    parser.m_useCache = m_useCache;
+    parser.m_resync = m_resync;
+    if (!m_attributeFilter.empty()) {
+        parser.setAttributeFilter(m_attributeFilter);
+    }
+}
+
+bool RVMParser::setAttributeFilter(const string& filter)
+{
+    if (filter.size() > 1 && filter.front() == '/' && filter.back() == '/') {
+        try {
+            m_attributeFile.setFilter(regex(filter.substr(1, filter.size() - 2)));
+        } catch (const regex_error& e) {
+            m_lastError = string("Invalid attribute expression: ") + e.what();
+            return false;
+        }
+        m_attributeFilter = filter;
+        return true;
+    }
+    vector<string> names;
+    size_t begin = 0;
+    while (begin <= filter.size()) {
+        size_t end = filter.find(',', begin);
+        if (end == string::npos) {
+            end = filter.size();
+        }
+        // Spaces around the names are ignored, e.g. "Name, Type".
+        const size_t first = filter.find_first_not_of(" \t", begin);
+        if (first < end) {
+            const size_t last = filter.find_last_not_of(" \t", end - 1);
+            names.push_back(filter.substr(first, last + 1 - first));
+        }
+        begin = end + 1;
+    }
+    if (names.empty()) {
+        m_lastError = "No attribute name in the attribute filter.";
+        return false;
+    }
+    m_attributeFile.setFilter(names);
+    m_attributeFilter = filter;
+    return true;
+}
+
 bool RVMParser::readFiles(const vector<string>& filenames, const string& name, bool ignoreAttributes)
 {
     bool success = true;
@@ -515,16 +372,18 @@ bool RVMParser::readFiles(const vector<string>& filenames, const string& name, b
 
     m_aggregation = true;
 
-    auto zeroTranslation = Vector3F();
-    for (unsigned int i = 0; i < filenames.size(); i++)
-    {
-        string groupname = filenames[i].substr(filenames[i].rfind(PATHSEP) + 1, filenames[i].find_last_of("."));
-        m_reader.startGroup(groupname, zeroTranslation, 0);
-        success = readFile(filenames[i], ignoreAttributes);
-        if (!success) {
-            break;
+    if (m_jobs > 1 && filenames.size() > 1) {
+        success = readFilesParallel(filenames, ignoreAttributes);
+    } else {
+        for (unsigned int i = 0; i < filenames.size(); i++)
+        {
+            m_reader.startGroup(aggregateGroupName(filenames[i]), Vector3F(), 0);
+            success = readFile(filenames[i], ignoreAttributes);
+            if (!success) {
+                break;
+            }
+            m_reader.endGroup();
         }
-        m_reader.endGroup();
     }
 
     m_reader.endModel();
@@ -533,17 +392,38 @@ bool RVMParser::readFiles(const vector<string>& filenames, const string& name, b
     return success;
 }
 
-bool RVMParser::readBuffer(const char* buffer) {
+bool RVMParser::readBuffer(const char* buffer, size_t size) {
     m_lastError = "";
 
-    stringbuf sb(buffer);
-    istream is(&sb);
-    bool success = readStream(is);
+    m_indexLoaded = false;
+    m_indexFilename.clear();
 
-    return success;
+    RVMCursor is(buffer, size);
+    return parse(is);
 }
 
 bool RVMParser::readStream(istream& is)
+{
+    m_lastError = "";
+
+    // The parser works on contiguous data: load the whole stream first.
+    vector<char> buffer;
+    const size_t chunkSize = 1 << 20;
+    while (is) {
+        const size_t size = buffer.size();
+        buffer.resize(size + chunkSize);
+        is.read(buffer.data() + size, chunkSize);
+        buffer.resize(size + size_t(is.gcount()));
+    }
+
+    m_indexLoaded = false;
+    m_indexFilename.clear();
+
+    RVMCursor cursor(buffer.data(), buffer.size());
+    return parse(cursor);
+}
+
+bool RVMParser::parse(RVMCursor& is)
 {
     Identifier id;
     if(!readUntilValidIdentifier(is, id))
@@ -617,23 +497,29 @@ bool RVMParser::readStream(istream& is)
     if (!m_aggregation)
         m_reader.startModel(projectName, name);
 
-    while ((read_(is, id)) != "END")
-    {
-        if (id == "CNTB") {
-            if (!readGroup(is)) {
-                return false;
-            }
-        } else if (id == "PRIM") {
-            if (!readPrimitive(is)) {
-                return false;
-            }
-        } else if (id == "COLR") {
-            if (!readColor(is)) {
+    // The index is built from a copy of the cursor: when it fails, the chunks are read sequentially from here,
+    // which can skip corrupted regions.
+    const bool useIndex = m_useIndex && !m_objectName.empty();
+    const bool indexed = (useIndex || m_jobs > 1) && buildIndex(is);
+    if (useIndex && indexed) {
+        if (!readIndexedObjects(is)) {
+            return false;
+        }
+    } else if (useIndex && !m_resync) {
+        m_lastError = "Incorrect file format while indexing chunks.";
+        return false;
+    } else if (m_jobs > 1 && indexed) {
+        if (!readParallel(is)) {
+            return false;
+        }
+    } else {
+        size_t position = is.position();
+        while ((read_(is, id)) != "END" && !(m_resync && id.empty() && is.atEnd()))
+        {
+            if ((!readChunk(is, id) || overran(is)) && !resync(is, position)) {
                 return false;
             }
-        } else {
-            m_lastError = "'" + id.toString() + "' Unknown or invalid identifier found.";
-            return false;
+            position = is.position();
         }
     }
 
@@ -646,251 +532,606 @@ bool RVMParser::readStream(istream& is)
     return true;
 }
 
-const string RVMParser::lastError()
+bool RVMParser::resync(RVMCursor& is, size_t& position)
 {
-    return m_lastError;
+    if (!m_resync) {
+        return false;
+    }
+    m_nbResyncs++;
+    is.seek(position + 1);
+    is.clear();
+    if (is.findIdentifier()) {
+        *m_log << "Skipped corrupted data from offset " << position << " to " << is.position() << endl;
+    } else {
+        *m_log << "Skipped corrupted data from offset " << position << " to the end of the file" << endl;
+    }
+    position = is.position();
+    return true;
 }
 
-bool RVMParser::readGroup(std::istream& is)
+bool RVMParser::overran(RVMCursor& is)
 {
-    skip_<2>(is); // Garbage ?
-    const unsigned int version = read_<unsigned int>(is);
+    // A chunk that reads past the end of the data is corrupted.
+    return m_resync && is.failed();
+}
 
-    string name;
-    read_(is, name);
+bool RVMParser::readChunk(RVMCursor& is, const Identifier& id)
+{
+    if (id == "CNTB") {
+        return readGroup(is);
+    } else if (id == "PRIM") {
+        return readPrimitive(is);
+    } else if (id == "COLR") {
+        return readColor(is);
+    }
+    m_lastError = "'" + id.toString() + "' Unknown or invalid identifier found.";
+    return false;
+}
 
-    Vector3F translation;
-    readArray_(is, translation.m_values);
-    translation *= 0.001f;
+bool RVMParser::buildIndex(RVMCursor& is)
+{
+    if (m_indexLoaded) {
+        return true;
+    }
+    RVMCursor scan(is);
+    if (!m_index.build(scan)) {
+        return false;
+    }
+    m_indexLoaded = true;
+    if (!m_indexFilename.empty() && m_index.save(m_indexFilename, is.size(), m_indexTime)) {
+        *m_log << "Wrote chunk index file: " << m_indexFilename << endl;
+    }
+    return true;
+}
 
-    const unsigned int materialId = read_<unsigned int>(is);
+bool RVMParser::readIndexedObjects(RVMCursor& is)
+{
+    // Colors apply to the whole model and are read in file order, selected groups are read directly.
+    uint64_t skipUntil = 0;
+    Identifier id;
+    for (const auto& entry : m_index.entries()) {
+        if (entry.offset < skipUntil) {
+            continue;
+        }
+        const bool isColor = entry.id == "COLR";
+        if (!isColor && (entry.id != "CNTB" || entry.name != m_objectName)) {
+            continue;
+        }
 
-    if (m_objectName.empty() || m_objectFound || name == m_objectName) {
-        m_objectFound++;
+        is.seek(size_t(entry.offset));
+        if (read_(is, id) != entry.id.chrs) {
+            m_lastError = "Chunk index does not match the file.";
+            return false;
+        }
+        if (isColor) {
+            if (!readColor(is)) {
+                return false;
+            }
+        } else {
+            if (!readGroup(is)) {
+                return false;
+            }
+            skipUntil = entry.offset + entry.size;
+        }
     }
-    if (m_objectFound)
+    return true;
+}
+
+namespace {
+
+    /// An aggregated file, parsed by a worker thread.
+    struct ParsedFile
     {
-        m_nbGroups++;
-        m_reader.startGroup(name, translation, m_forcedColor != -1 ? m_forcedColor : materialId);
-        // Attributes
-        if (m_attributeStream && !m_attributeStream->eof()) {
-            string p;
-            while (((p = trim(m_currentAttributeLine)) != "NEW " + name) && (!m_attributeStream->eof())) {
-                std::getline(*m_attributeStream, m_currentAttributeLine, '\n');
+        ParsedFile() : success(false), done(false) {}
+
+        RVMEventBuffer              events;
+        std::unique_ptr<RVMParser>  parser;
+        std::ostringstream          log;
+        bool                        success;
+        bool                        done;
+    };
+
+    /// A part of the model, decoded by a worker thread for Chunks or by the main thread for groups that are split.
+    struct ParseSegment
+    {
+        enum Kind { Chunks, OpenGroup, CloseGroup };
+
+        ParseSegment(Kind kind, size_t begin, int objectFound) :
+            kind(kind), begin(begin), end(begin), objectFound(objectFound), success(false), done(false) {
+        }
+
+        Kind                        kind;
+        /// Chunks: byte range of consecutive sibling chunks. OpenGroup: position of the CNTB chunk.
+        size_t                      begin;
+        size_t                      end;
+        /// Object selection counter before the segment, @see RVMParser::setObjectName
+        int                         objectFound;
+
+        RVMEventBuffer              events;
+        std::unique_ptr<RVMParser>  parser;
+        bool                        success;
+        bool                        done;
+    };
+
+}
+
+bool RVMParser::readParallel(RVMCursor& is)
+{
+    const vector<RVMIndex::Entry>& entries = m_index.entries();
+
+    // Split the model into segments in document order. Groups too big for one segment are opened and closed
+    // by the main thread, their children are distributed in segments of consecutive chunks.
+    uint64_t modelSize = 0;
+    for (const auto& entry : entries) {
+        if (entry.depth == 0) {
+            modelSize += entry.size;
+        }
+    }
+    const uint64_t segmentSize = std::max<uint64_t>(modelSize / (uint64_t(m_jobs) * 16), 1);
+
+    vector<unique_ptr<ParseSegment>> segments;
+    vector<pair<uint64_t, bool>> openGroups; // end of the group and if it was counted in objectFound
+    ParseSegment* chunks = 0;
+    int objectFound = m_objectFound;
+    uint64_t chunksEnd = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const RVMIndex::Entry& entry = entries[i];
+        if (entry.offset < chunksEnd) {
+            continue;
+        }
+        while (!openGroups.empty() && entry.offset >= openGroups.back().first) {
+            segments.emplace_back(new ParseSegment(ParseSegment::CloseGroup, size_t(openGroups.back().first), objectFound));
+            chunks = 0;
+            if (openGroups.back().second) {
+                objectFound--;
             }
-            if (p == "NEW " + name ) {
-                m_reader.startMetaData();
-                size_t i;
-                std::getline(*m_attributeStream, m_currentAttributeLine, '\n');
-                p = trim(latin_to_utf8(m_currentAttributeLine));
-                while ((!m_attributeStream->eof()) && ((i = p.find(":=")) != string::npos)) {
-                     string an = p.substr(0, i);
-                     string av = p.substr(i+4, string::npos);
-
-                     m_reader.startMetaDataPair(an, av);
-                     m_reader.endMetaDataPair();
-                     m_attributes++;
-
-                     std::getline(*m_attributeStream, m_currentAttributeLine, '\n');
-                     p = trim(latin_to_utf8(m_currentAttributeLine));
-                }
-                m_reader.endMetaData();
+            openGroups.pop_back();
+        }
+        const bool hasChildren = i + 1 < entries.size() && entries[i + 1].depth > entry.depth;
+        if (entry.id == "CNTB" && entry.size > segmentSize && hasChildren) {
+            segments.emplace_back(new ParseSegment(ParseSegment::OpenGroup, size_t(entry.offset), objectFound));
+            chunks = 0;
+            const bool counted = m_objectName.empty() || objectFound || entry.name == m_objectName;
+            if (counted) {
+                objectFound++;
             }
+            openGroups.push_back(make_pair(entry.offset + entry.size, counted));
+            continue;
+        }
+        if (!chunks || chunks->end != entry.offset || chunks->end - chunks->begin >= segmentSize) {
+            segments.emplace_back(new ParseSegment(ParseSegment::Chunks, size_t(entry.offset), objectFound));
+            chunks = segments.back().get();
+        }
+        chunks->end = size_t(entry.offset + entry.size);
+        chunksEnd = chunks->end;
+    }
+    while (!openGroups.empty()) {
+        segments.emplace_back(new ParseSegment(ParseSegment::CloseGroup, size_t(openGroups.back().first), objectFound));
+        if (openGroups.back().second) {
+            objectFound--;
         }
+        openGroups.pop_back();
     }
 
-    // Children
-    Identifier id;
-    while ((read_(is, id)) != "CNTE") {
-        if (id == "CNTB") {
-            if (!readGroup(is)) {
-                return false;
+    // Workers decode chunk segments into event buffers, at most a few segments ahead of the replay.
+    mutex lock;
+    condition_variable changed;
+    size_t next = 0;
+    size_t replayed = 0;
+    const size_t window = size_t(m_jobs) * 4;
+
+    auto worker = [&]() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            changed.wait(guard, [&]() { return next >= segments.size() || next < replayed + window; });
+            if (next >= segments.size()) {
+                return;
             }
-        } else if (id == "PRIM") {
-            if (!readPrimitive(is)) {
-                return false;
+            const size_t index = next++;
+            // Segments decoded by the main thread may already be replayed and released
+            if (index < replayed || segments[index]->kind != ParseSegment::Chunks) {
+                continue;
             }
-        } else {
-            m_lastError = "Unknown or invalid identifier found.";
-            return false;
+            ParseSegment& segment = *segments[index];
+            guard.unlock();
+
+            segment.parser.reset(new RVMParser(segment.events));
+            RVMParser& parser = *segment.parser;
+            parser.m_objectName = m_objectName;
+            parser.m_objectFound = segment.objectFound;
+            parser.m_forcedColor = m_forcedColor;
+            parser.m_scale = m_scale;
+            parser.m_resync = m_resync;
+            parser.m_log = m_log;
+            RVMCursor cursor(is.begin(), is.size());
+            cursor.seek(segment.begin);
+            segment.success = parser.readChunks(cursor, segment.end);
+
+            guard.lock();
+            segment.done = true;
+            changed.notify_all();
         }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < m_jobs; i++) {
+        threads.emplace_back(worker);
     }
 
-    skip_<3>(is); // Garbage ?
+    // Replay in document order. Attributes are read here, as the attribute file is read sequentially.
+    bool success = true;
+    Identifier id;
+    for (size_t i = 0; i < segments.size() && success; i++) {
+        ParseSegment& segment = *segments[i];
+        switch (segment.kind) {
+            case ParseSegment::Chunks: {
+                {
+                    unique_lock<mutex> guard(lock);
+                    changed.wait(guard, [&]() { return segment.done; });
+                }
+                segment.events.replay(m_reader, [this](const string& name) { readAttributes(name); });
+                addStatistics(*segment.parser);
+                if (!segment.success) {
+                    m_lastError = segment.parser->m_lastError;
+                    success = false;
+                }
+            } break;
+
+            case ParseSegment::OpenGroup:
+                is.seek(segment.begin);
+                read_(is, id);
+                readGroupHeader(is);
+            break;
 
-    if (m_objectFound) {
-        m_reader.endGroup();
-        m_objectFound--;
+            case ParseSegment::CloseGroup:
+                closeGroup();
+            break;
+        }
+        unique_lock<mutex> guard(lock);
+        segments[i].reset();
+        replayed = i + 1;
+        if (!success) {
+            next = segments.size();
+        }
+        changed.notify_all();
     }
 
-    return true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    return success;
 }
 
-bool RVMParser::readPrimitive(std::istream& is)
+bool RVMParser::readFilesParallel(const vector<string>& filenames, bool ignoreAttributes)
 {
-    skip_<2>(is); // Garbage ?
-    const unsigned int version = read_<unsigned int>(is);
-    const unsigned int primitiveKind = read_<unsigned int>(is);
-
-    std::array<float, 12> matrix;
-    readMatrix(is, matrix);
-    scaleMatrix(matrix, m_scale);
+    const size_t workers = min(size_t(m_jobs), filenames.size());
+    vector<unique_ptr<ParsedFile> > files;
+    for (size_t i = 0; i < filenames.size(); i++) {
+        files.emplace_back(new ParsedFile());
+    }
 
-    // skip bounding box
-    skip_<6>(is);
+    // Workers parse whole files into event buffers, at most a few files ahead of the replay.
+    mutex lock;
+    condition_variable changed;
+    size_t next = 0;
+    size_t replayed = 0;
+    const size_t window = workers * 2;
+
+    auto worker = [&]() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            changed.wait(guard, [&]() { return next >= files.size() || next < replayed + window; });
+            if (next >= files.size()) {
+                return;
+            }
+            const size_t index = next++;
+            ParsedFile& file = *files[index];
+            guard.unlock();
+
+            file.parser.reset(new RVMParser(file.events));
+            RVMParser& parser = *file.parser;
+            copySettings(parser);
+            parser.m_aggregation = true;
+            parser.m_jobs = max(1, m_jobs / int(workers));
+            parser.m_log = &file.log;
+            file.success = parser.readFile(filenames[index], ignoreAttributes);
+
+            guard.lock();
+            file.done = true;
+            changed.notify_all();
+        }
+    };
+    vector<thread> threads;
+    for (size_t i = 0; i < workers; i++) {
+        threads.emplace_back(worker);
+    }
 
-    Primitive   primitive;
-    FacetGroup  fc;
-    if (m_objectFound)
-    {
-        switch (primitiveKind)
+    // Replay in the order of the file names, as if they were read one after the other.
+    bool success = true;
+    for (size_t i = 0; i < files.size() && success; i++) {
+        ParsedFile& file = *files[i];
         {
-            case 1:
-                m_nbPyramids++;
-                readArray_(is, primitive.pyramid.data);
-                m_reader.createPyramid(matrix, primitive.pyramid);
-            break;
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&]() { return file.done; });
+        }
+        m_reader.startGroup(aggregateGroupName(filenames[i]), Vector3F(), 0);
+        *m_log << file.log.str();
+        file.events.replay(m_reader);
+        addStatistics(*file.parser);
+        if (file.success) {
+            m_reader.endGroup();
+        } else {
+            m_lastError = file.parser->m_lastError;
+            success = false;
+        }
 
-            case 2:
-                m_nbBoxes++;
-                readArray_(is, primitive.box.len);
-                m_reader.createBox(matrix, primitive.box);
-             break;
+        unique_lock<mutex> guard(lock);
+        files[i].reset();
+        replayed = i + 1;
+        if (!success) {
+            next = files.size();
+        }
+        changed.notify_all();
+    }
 
-            case 3:
-                m_nbRectangularToruses++;
-                readArray_(is, primitive.rTorus.data);
-                m_reader.createRectangularTorus(matrix, primitive.rTorus);
-            break;
+    for (auto& t : threads) {
+        t.join();
+    }
+    return success;
+}
 
-            case 4:
-                m_nbCircularToruses++;
-                readArray_(is, primitive.cTorus.data);
-                m_reader.createCircularTorus(matrix, primitive.cTorus);
-            break;
+bool RVMParser::readChunks(RVMCursor& is, size_t end)
+{
+    Identifier id;
+    while (is.position() < end) {
+        if (!readChunk(is, read_(is, id))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-            case 5:
-                m_nbEllipticalDishes++;
-                readArray_(is, primitive.eDish.data);
-                m_reader.createEllipticalDish(matrix, primitive.eDish);
-            break;
+void RVMParser::addStatistics(const RVMParser& parser)
+{
+    m_nbGroups += parser.m_nbGroups;
+    m_nbPyramids += parser.m_nbPyramids;
+    m_nbBoxes += parser.m_nbBoxes;
+    m_nbRectangularToruses += parser.m_nbRectangularToruses;
+    m_nbCircularToruses += parser.m_nbCircularToruses;
+    m_nbEllipticalDishes += parser.m_nbEllipticalDishes;
+    m_nbSphericalDishes += parser.m_nbSphericalDishes;
+    m_nbSnouts += parser.m_nbSnouts;
+    m_nbCylinders += parser.m_nbCylinders;
+    m_nbSpheres += parser.m_nbSpheres;
+    m_nbLines += parser.m_nbLines;
+    m_nbFacetGroups += parser.m_nbFacetGroups;
+    m_attributes += parser.m_attributes;
+    m_nbResyncs += parser.m_nbResyncs;
+}
 
-            case 6:
-                m_nbSphericalDishes++;
-                readArray_(is, primitive.sDish.data);
-                m_reader.createSphericalDish(matrix, primitive.sDish);
-            break;
+void RVMParser::addStatistics(const RVMSceneModel& model)
+{
+    m_nbGroups += int(model.groupCount());
+    m_nbPyramids += int(model.primitives(RVMSceneModel::Pyramid).size());
+    m_nbBoxes += int(model.primitives(RVMSceneModel::Box).size());
+    m_nbRectangularToruses += int(model.primitives(RVMSceneModel::RectangularTorus).size());
+    m_nbCircularToruses += int(model.primitives(RVMSceneModel::CircularTorus).size());
+    m_nbEllipticalDishes += int(model.primitives(RVMSceneModel::EllipticalDish).size());
+    m_nbSphericalDishes += int(model.primitives(RVMSceneModel::SphericalDish).size());
+    m_nbSnouts += int(model.primitives(RVMSceneModel::Snout).size());
+    m_nbCylinders += int(model.primitives(RVMSceneModel::Cylinder).size());
+    m_nbSpheres += int(model.primitives(RVMSceneModel::Sphere).size());
+    m_nbLines += int(model.primitives(RVMSceneModel::Line).size());
+    m_nbFacetGroups += int(model.primitives(RVMSceneModel::FacetGroup).size());
+    m_attributes += long(model.attributeCount());
+}
 
-            case 7:
-                m_nbSnouts++;
-                readArray_(is, primitive.snout.data);
+const string RVMParser::lastError()
+{
+    return m_lastError;
+}
 
-                m_reader.createSnout(matrix, primitive.snout);
-            break;
+bool RVMParser::readGroup(RVMCursor& is)
+{
+    readGroupHeader(is);
 
-            case 8:
-                m_nbCylinders++;
-                readArray_(is, primitive.cylinder.data);
-                m_reader.createCylinder(matrix, primitive.cylinder);
+    // Children
+    Identifier id;
+    size_t position = is.position();
+    while ((read_(is, id)) != "CNTE") {
+        if (id == "CNTB") {
+            if ((!readGroup(is) || overran(is)) && !resync(is, position)) {
+                return false;
+            }
+        } else if (id == "PRIM") {
+            if ((!readPrimitive(is) || overran(is)) && !resync(is, position)) {
+                return false;
+            }
+        } else if (m_resync && (id == "END" || (id.empty() && is.atEnd()))) {
+            // The model ends inside the group: close it and let the parent groups see the end too.
+            is.seek(position);
+            is.clear();
             break;
+        } else {
+            m_lastError = "Unknown or invalid identifier found.";
+            if (!resync(is, position)) {
+                return false;
+            }
+        }
+        position = is.position();
+    }
 
-            case 9:
-                m_nbSpheres++;
-                read_(is, primitive.sphere);
-                m_reader.createSphere(matrix, primitive.sphere);
-            break;
+    if (id == "CNTE") {
+        skip_<3>(is); // Garbage ?
+    }
 
-            case 10: {
-                m_nbLines++;
-                float startx = read_<float>(is);
-                float endx = read_<float>(is);
-                m_reader.createLine(matrix, startx, endx);
-            } break;
+    closeGroup();
 
-            case 11: {
-                m_nbFacetGroups++;
-                readFacetGroup_(is, fc);
-                m_reader.createFacetGroup(matrix, fc);
-            } break;
+    return true;
+}
 
-            default: {
-                m_lastError = "Unknown primitive.";
-                return false;
-            }
-        }
-    } else {
-        switch (primitiveKind) {
-            case 1:
-                skip_<7>(is);
-            break;
+void RVMParser::readGroupHeader(RVMCursor& is)
+{
+    skip_<2>(is); // Garbage ?
+    const unsigned int version = read_<unsigned int>(is);
 
-            case 2:
-                skip_<3>(is);
-            break;
+    string name;
+    read_(is, name);
 
-            case 3:
-                skip_<4>(is);
-            break;
+    Vector3F translation;
+    readArray_(is, translation.m_values);
+    translation *= 0.001f;
 
-            case 4:
-                skip_<3>(is);
-            break;
+    const unsigned int materialId = read_<unsigned int>(is);
 
-            case 5:
-                skip_<2>(is);
-            break;
+    if (m_objectName.empty() || m_objectFound || name == m_objectName) {
+        m_objectFound++;
+    }
+    if (m_objectFound)
+    {
+        m_nbGroups++;
+        m_reader.startGroup(name, translation, m_forcedColor != -1 ? m_forcedColor : materialId);
+        readAttributes(name);
+    }
+}
 
-            case 6:
-                skip_<2>(is);
-            break;
+void RVMParser::readAttributes(const string& name)
+{
+    if (m_attributeFile.isOpen() && m_attributeFile.read(name, m_attributeValues)
+            && (!m_attributeValues.empty() || !m_attributeFile.hasFilter())) {
+        m_reader.startMetaData();
+        for (const auto& attribute : m_attributeValues) {
+            m_reader.startMetaDataPair(attribute.first, attribute.second);
+            m_reader.endMetaDataPair();
+            m_attributes++;
+        }
+        m_reader.endMetaData();
+    }
+}
 
-            case 7:
-                skip_<9>(is);
-            break;
+void RVMParser::closeGroup()
+{
+    if (m_objectFound) {
+        m_reader.endGroup();
+        m_objectFound--;
+    }
+}
 
-            case 8:
-                skip_<2>(is);
-            break;
+bool RVMParser::readPrimitive(RVMCursor& is)
+{
+    if (!m_objectFound) {
+        // Not selected: step over the data without decoding it.
+        if (!RVMIndex::skipPrimitive(is) && !is.failed()) {
+            m_lastError = "Unknown primitive.";
+            return false;
+        }
+        return true;
+    }
 
-            case 9:
-                skip_<1>(is);
-            break;
+    skip_<2>(is); // Garbage ?
+    const unsigned int version = read_<unsigned int>(is);
+    const unsigned int primitiveKind = read_<unsigned int>(is);
 
-            case 10:
-                skip_<2>(is);
-            break;
+    std::array<float, 12> matrix;
+    readMatrix(is, matrix);
+    scaleMatrix(matrix, m_scale);
 
-            case 11:
-                readFacetGroup_(is, fc);
-            break;
+    // skip bounding box
+    skip_<6>(is);
 
-            default:
-                m_lastError = "Unknown primitive.";
-                return false;
+    Primitive   primitive;
+    switch (primitiveKind)
+    {
+        case 1:
+            m_nbPyramids++;
+            readArray_(is, primitive.pyramid.data);
+            m_reader.createPyramid(matrix, primitive.pyramid);
+        break;
+
+        case 2:
+            m_nbBoxes++;
+            readArray_(is, primitive.box.len);
+            m_reader.createBox(matrix, primitive.box);
+         break;
+
+        case 3:
+            m_nbRectangularToruses++;
+            readArray_(is, primitive.rTorus.data);
+            m_reader.createRectangularTorus(matrix, primitive.rTorus);
+        break;
+
+        case 4:
+            m_nbCircularToruses++;
+            readArray_(is, primitive.cTorus.data);
+            m_reader.createCircularTorus(matrix, primitive.cTorus);
+        break;
+
+        case 5:
+            m_nbEllipticalDishes++;
+            readArray_(is, primitive.eDish.data);
+            m_reader.createEllipticalDish(matrix, primitive.eDish);
+        break;
+
+        case 6:
+            m_nbSphericalDishes++;
+            readArray_(is, primitive.sDish.data);
+            m_reader.createSphericalDish(matrix, primitive.sDish);
+        break;
+
+        case 7:
+            m_nbSnouts++;
+            readArray_(is, primitive.snout.data);
+
+            m_reader.createSnout(matrix, primitive.snout);
+        break;
+
+        case 8:
+            m_nbCylinders++;
+            readArray_(is, primitive.cylinder.data);
+            m_reader.createCylinder(matrix, primitive.cylinder);
+        break;
+
+        case 9:
+            m_nbSpheres++;
+            read_(is, primitive.sphere);
+            m_reader.createSphere(matrix, primitive.sphere);
+        break;
+
+        case 10: {
+            m_nbLines++;
+            float startx = read_<float>(is);
+            float endx = read_<float>(is);
+            m_reader.createLine(matrix, startx, endx);
+        } break;
+
+        case 11: {
+            m_nbFacetGroups++;
+            m_reader.createFacetGroup(matrix, readFacetGroup_(is, m_facetGroup));
+        } break;
+
+        default: {
+            m_lastError = "Unknown primitive.";
+            return false;
         }
     }
     return true;
 }
 
 
-bool RVMParser::readColor(std::istream& is)
+bool RVMParser::readColor(RVMCursor& is)
 {
-    const auto pos = int(is.tellg());
-
     skip_<2>(is); // Garbage ?
     const unsigned int version = read_<unsigned int>(is);
     const unsigned int index = read_<unsigned int>(is);
 
     std::array<std::uint8_t, 4> color;
-    is.read(reinterpret_cast<char*>(color.data()), 4);
+    is.readBytes(reinterpret_cast<char*>(color.data()), 4);
 
     m_reader.updateColorPalette(index, color);
 
     return true;
 }
 
-void RVMParser::readMatrix(istream& is, std::array<float, 12>& matrix)
+void RVMParser::readMatrix(RVMCursor& is, std::array<float, 12>& matrix)
 {
-    for (auto &value : matrix)
-        value = read_<float>(is);
+    is.readFloats(matrix.data(), matrix.size());
 }
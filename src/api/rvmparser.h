@@ -23,13 +23,19 @@
 #define RVMPARSER_H
 
 #include <istream>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <array>
 
 #include "vector3f.h"
+#include "rvmindex.h"
+#include "rvmattributefile.h"
+#include "rvmfacetgroup.h"
 
 class RVMReader;
+class RVMMappedFile;
+class RVMSceneModel;
 
 /**
  * @brief The RVMParser class
@@ -39,6 +45,7 @@ class RVMReader;
  *   - or a standard input stream.
  *
  * In the case of a file, a .att companion file will be searched int he same directory to include metadata.
+ * Files are memory mapped and decoded in place. Streams are loaded in memory before parsing.
  *
  * Two methods are provided to allow tweeking the output:
  * @see setObjectName @see setForcedColor
@@ -61,6 +68,9 @@ class RVMParser
         bool readFile(const std::string& filename, bool ignoreAttributes);
         /**
          * @brief Reads from a series of files.
+         *
+         * With several jobs (@see setJobs), the files are parsed concurrently and sent to the reader
+         * in the order of filenames.
          * @param filenames a vector of filenames
          *
          * @return true if the parsing was a success.
@@ -69,9 +79,10 @@ class RVMParser
         /**
          * @brief Reads from a character buffer.
          * @param buffer the character buffer containing RVM data.
+         * @param size the size of the buffer in bytes.
          * @return true if the parsing was a success.
          */
-        bool readBuffer(const char* buffer);
+        bool readBuffer(const char* buffer, size_t size);
         /**
          * @brief Reads RVM data from an input stream
          * @param is the input stream of RVM data.
@@ -90,6 +101,50 @@ class RVMParser
          */
         void setForcedColor(const int index) { m_forcedColor = index; }
         void setScale(const float scale) { m_scale = scale; }
+        /**
+         * @brief Use a chunk index to read the object selected by setObjectName without decoding the rest of the file.
+         *
+         * When reading a file, the index is loaded from a sidecar file (@see RVMIndex::indexFilename),
+         * or built and saved there if it is missing or outdated.
+         * @param useIndex true to enable the index.
+         */
+        void setUseIndex(bool useIndex) { m_useIndex = useIndex; }
+        /**
+         * @brief Keep a binary cache of the parsed model next to each file read (@see RVMSceneModel::cacheFilename).
+         *
+         * When the RVM and attribute files did not change since the cache was written, and the settings are the same,
+         * the cached model is replayed to the reader instead of parsing the files. Otherwise the files are parsed and the cache
+         * is written again. Files that needed recovery (@see setResync) are not cached.
+         * @param useCache true to enable the cache.
+         */
+        void setUseCache(bool useCache) { m_useCache = useCache; }
+        /**
+         * @brief Decode the model with several threads.
+         *
+         * Subtrees are decoded concurrently and sent to the reader in document order:
+         * the reader receives the same events as with a single thread.
+         * @param jobs number of decoding threads, 1 to parse on the calling thread only.
+         */
+        void setJobs(int jobs) { m_jobs = jobs > 0 ? jobs : 1; }
+        /**
+         * @brief Recover from corrupted data instead of failing.
+         *
+         * When an invalid chunk is found, the parser skips forward to the next valid identifier and goes on.
+         * If the end of the data is reached, open groups are closed and the model ends there.
+         * @param resync true to enable recovery.
+         */
+        void setResync(bool resync) { m_resync = resync; }
+        /**
+         * @brief Keep only some attributes. Other attributes are dropped when the attribute file is parsed,
+         * and groups left without attributes get no metadata.
+         * @param filter comma separated attribute names, or a regular expression between slashes (/Name|Type/).
+         * @return false if the regular expression is not valid or if there is no name.
+         */
+        bool setAttributeFilter(const std::string& filter);
+        /**
+         * @brief Sets the stream receiving the messages of the parser. Default is std::cout.
+         */
+        void setLog(std::ostream& log) { m_log = &log; }
 
         /**
          * @brief In case of error, returns the last error that occured.
@@ -162,25 +217,57 @@ class RVMParser
          * @return the number of attributes found in the source.
          */
         const long& nbAttributes() { return m_attributes; }
+        /**
+         * @brief Statistics of the parsing: number of corrupted regions skipped
+         * @return the number of times the parser had to look for the next valid identifier. @see setResync
+         */
+        const int& nbResyncs() { return m_nbResyncs; }
 
     private:
-        bool readGroup(std::istream& is);
-        bool readPrimitive(std::istream& is);
-        bool readColor(std::istream& is);
+        bool parse(RVMCursor& is);
+        bool buildIndex(RVMCursor& is);
+        bool readIndexedObjects(RVMCursor& is);
+        bool readParallel(RVMCursor& is);
+        bool readFilesParallel(const std::vector<std::string>& filenames, bool ignoreAttributes);
+        bool readCachedFile(const std::string& filename, const RVMMappedFile& file, bool ignoreAttributes);
+        void copySettings(RVMParser& parser) const;
+        bool readChunks(RVMCursor& is, size_t end);
+        bool readChunk(RVMCursor& is, const Identifier& id);
+        bool resync(RVMCursor& is, size_t& position);
+        bool overran(RVMCursor& is);
+        bool readGroup(RVMCursor& is);
+        void readGroupHeader(RVMCursor& is);
+        void readAttributes(const std::string& name);
+        void closeGroup();
+        bool readPrimitive(RVMCursor& is);
+        bool readColor(RVMCursor& is);
 
-        void readMatrix(std::istream& is, std::array<float, 12>& matrix);
+        void readMatrix(RVMCursor& is, std::array<float, 12>& matrix);
+        void addStatistics(const RVMParser& parser);
+        void addStatistics(const RVMSceneModel& model);
 
         RVMReader       &m_reader;
         std::string     m_encoding;
         std::string     m_lastError;
 
-        std::string     m_currentAttributeLine;
         std::string     m_objectName;
         int             m_objectFound;
         int             m_forcedColor;
         bool            m_aggregation;
         float           m_scale;
-        std::istream*   m_attributeStream;
+        RVMAttributeFile m_attributeFile;
+        std::string     m_attributeFilter;
+        RVMAttributeFile::Attributes m_attributeValues;
+        bool            m_useIndex;
+        bool            m_useCache;
+        int             m_jobs;
+        bool            m_resync;
+        bool            m_indexLoaded;
+        std::string     m_indexFilename;
+        int64_t         m_indexTime;
+        RVMIndex        m_index;
+        /// Storage of the facet group being read, reused for each of them.
+        RVMFacetGroupArena m_facetGroup;
 
         int             m_nbGroups;
         int             m_nbPyramids;
@@ -195,6 +282,8 @@ class RVMParser
         int             m_nbLines;
         int             m_nbFacetGroups;
         long            m_attributes;
+        int             m_nbResyncs;
+        std::ostream*   m_log;
 };
 
 #endif // RVMPARSER_H
@@ -0,0 +1,206 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+#include "rvmpipelinereader.h"
+
+using namespace std;
+
+namespace {
+    /// Number of events recorded before a batch is sent to the readers
+    const size_t BATCH_SIZE = 4096;
+}
+
+RVMPipelineReader::RVMPipelineReader(const vector<RVMReader*>& readers, size_t queueSize) :
+    m_batch(make_shared<RVMEventBuffer>()),
+    m_finished(false) {
+    for (RVMReader* reader : readers) {
+        m_consumers.emplace_back(new Consumer(reader, queueSize));
+        m_consumers.back()->thread = thread(&RVMPipelineReader::consume, m_consumers.back().get());
+    }
+}
+
+RVMPipelineReader::~RVMPipelineReader() {
+    finish();
+}
+
+void RVMPipelineReader::finish() {
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    flush();
+    // An empty batch stops the threads
+    for (auto& consumer : m_consumers) {
+        consumer->queue.push(Batch());
+    }
+    for (auto& consumer : m_consumers) {
+        consumer->thread.join();
+    }
+}
+
+void RVMPipelineReader::recorded() {
+    if (m_batch->size() >= BATCH_SIZE) {
+        flush();
+    }
+}
+
+void RVMPipelineReader::flush() {
+    if (m_batch->empty()) {
+        return;
+    }
+    const Batch batch = m_batch;
+    for (auto& consumer : m_consumers) {
+        consumer->queue.push(batch);
+    }
+    m_batch = make_shared<RVMEventBuffer>();
+}
+
+void RVMPipelineReader::consume(Consumer* consumer) {
+    Batch batch;
+    while (true) {
+        consumer->queue.pop(batch);
+        if (!batch) {
+            return;
+        }
+        batch->replay(*consumer->reader);
+        batch.reset();
+    }
+}
+
+void RVMPipelineReader::startDocument() {
+    m_batch->startDocument();
+    recorded();
+}
+
+void RVMPipelineReader::endDocument() {
+    m_batch->endDocument();
+    finish();
+}
+
+void RVMPipelineReader::startHeader(const string& banner, const string& fileNote, const string& date, const string& user, const string& encoding) {
+    m_batch->startHeader(banner, fileNote, date, user, encoding);
+    recorded();
+}
+
+void RVMPipelineReader::endHeader() {
+    m_batch->endHeader();
+    recorded();
+}
+
+void RVMPipelineReader::startModel(const string& projectName, const string& name) {
+    m_batch->startModel(projectName, name);
+    recorded();
+}
+
+void RVMPipelineReader::endModel() {
+    m_batch->endModel();
+    recorded();
+}
+
+void RVMPipelineReader::startGroup(const string& name, const Vector3F& translation, const int& materialId) {
+    m_batch->startGroup(name, translation, materialId);
+    recorded();
+}
+
+void RVMPipelineReader::endGroup() {
+    m_batch->endGroup();
+    recorded();
+}
+
+void RVMPipelineReader::startMetaData() {
+    m_batch->startMetaData();
+    recorded();
+}
+
+void RVMPipelineReader::endMetaData() {
+    m_batch->endMetaData();
+    recorded();
+}
+
+void RVMPipelineReader::startMetaDataPair(string_view name, string_view value) {
+    m_batch->startMetaDataPair(name, value);
+    recorded();
+}
+
+void RVMPipelineReader::endMetaDataPair() {
+    m_batch->endMetaDataPair();
+    recorded();
+}
+
+void RVMPipelineReader::createPyramid(const array<float, 12>& matrix, const Primitives::Pyramid& params) {
+    m_batch->createPyramid(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createBox(const array<float, 12>& matrix, const Primitives::Box& params) {
+    m_batch->createBox(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createRectangularTorus(const array<float, 12>& matrix, const Primitives::RectangularTorus& params) {
+    m_batch->createRectangularTorus(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createCircularTorus(const array<float, 12>& matrix, const Primitives::CircularTorus& params) {
+    m_batch->createCircularTorus(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createEllipticalDish(const array<float, 12>& matrix, const Primitives::EllipticalDish& params) {
+    m_batch->createEllipticalDish(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createSphericalDish(const array<float, 12>& matrix, const Primitives::SphericalDish& params) {
+    m_batch->createSphericalDish(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createSnout(const array<float, 12>& matrix, const Primitives::Snout& params) {
+    m_batch->createSnout(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createCylinder(const array<float, 12>& matrix, const Primitives::Cylinder& params) {
+    m_batch->createCylinder(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createSphere(const array<float, 12>& matrix, const Primitives::Sphere& params) {
+    m_batch->createSphere(matrix, params);
+    recorded();
+}
+
+void RVMPipelineReader::createLine(const array<float, 12>& matrix, const float& startx, const float& endx) {
+    m_batch->createLine(matrix, startx, endx);
+    recorded();
+}
+
+void RVMPipelineReader::createFacetGroup(const array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
+    m_batch->createFacetGroup(matrix, facetGroup);
+    recorded();
+}
+
+void RVMPipelineReader::updateColorPalette(uint32_t index, const array<uint8_t, 4>& color) {
+    m_batch->updateColorPalette(index, color);
+    recorded();
+}
@@ -0,0 +1,128 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMPIPELINEREADER_H
+#define RVMPIPELINEREADER_H
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "rvmeventbuffer.h"
+#include "rvmreader.h"
+#include "rvmspscqueue.h"
+
+/**
+ * @brief RVM reader that sends the events to several readers, each running on its own thread.
+ *
+ * Events are recorded in batches (@see RVMEventBuffer). Each full batch is shared by all readers
+ * and queued to each of their threads, which replay it. Every reader receives exactly the events
+ * sent to the pipeline, in the same order. At most queueSize batches are pending per reader:
+ * the parsing thread only waits when the slowest reader is that far behind.
+ *
+ * The readers are not owned, but must not be used by another thread until finish() returns.
+ */
+class RVMPipelineReader : public RVMReader
+{
+    public:
+        /**
+         * @param readers the destination readers.
+         * @param queueSize the maximum number of pending batches per reader.
+         */
+        explicit RVMPipelineReader(const std::vector<RVMReader*>& readers, size_t queueSize = 16);
+        /**
+         * @brief Waits for the readers, @see finish.
+         */
+        virtual ~RVMPipelineReader();
+
+        /**
+         * @brief Sends the pending events and waits until all readers have processed them.
+         * Called by endDocument, the pipeline can not be used afterwards.
+         */
+        void finish();
+
+        virtual void startDocument();
+        virtual void endDocument();
+
+        virtual void startHeader(const std::string& banner, const std::string& fileNote, const std::string& date, const std::string& user, const std::string& encoding);
+        virtual void endHeader();
+
+        virtual void startModel(const std::string& projectName, const std::string& name);
+        virtual void endModel();
+
+        virtual void startGroup(const std::string& name, const Vector3F& translation, const int& materialId);
+        virtual void endGroup();
+
+        virtual void startMetaData();
+        virtual void endMetaData();
+
+        virtual void startMetaDataPair(std::string_view name, std::string_view value);
+        virtual void endMetaDataPair();
+
+        virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
+
+        virtual void createBox(const std::array<float, 12>& matrix, const Primitives::Box& params);
+
+        virtual void createRectangularTorus(const std::array<float, 12>& matrix, const Primitives::RectangularTorus& params);
+
+        virtual void createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& params);
+
+        virtual void createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& params);
+
+        virtual void createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& params);
+
+        virtual void createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& params);
+
+        virtual void createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& params);
+
+        virtual void createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& params);
+
+        virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
+
+        using RVMReader::createFacetGroup;
+        virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
+
+        virtual void updateColorPalette(std::uint32_t index, const std::array<std::uint8_t, 4>& color);
+
+    private:
+        typedef std::shared_ptr<const RVMEventBuffer> Batch;
+
+        /// A destination reader, with its queue and thread.
+        struct Consumer
+        {
+            Consumer(RVMReader* reader, size_t queueSize) : reader(reader), queue(queueSize) {}
+
+            RVMReader*                  reader;
+            RVMSpscQueue<Batch>         queue;
+            std::thread                 thread;
+        };
+
+        void recorded();
+        void flush();
+        static void consume(Consumer* consumer);
+
+        std::vector<std::unique_ptr<Consumer> > m_consumers;
+        std::shared_ptr<RVMEventBuffer>         m_batch;
+        bool                                    m_finished;
+};
+
+#endif // RVMPIPELINEREADER_H
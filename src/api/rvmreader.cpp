@@ -20,14 +20,27 @@
  */
 
 #include "rvmreader.h"
+#include "rvmmeshcache.h"
+
+#include <iostream>
 
 RVMReader::RVMReader() :
-    m_primitives(false),
-    m_split(false),
     m_minSides(16),
-    m_maxSideSize(10) {
+    m_maxSideSize(10),
+    m_split(false),
+    m_primitives(false),
+    m_unitMeshes(false),
+    m_weldTolerance(0),
+    m_log(&std::cout),
+    m_meshCache(std::make_shared<RVMMeshCache>()) {
 }
 
 RVMReader::~RVMReader() {
 }
 
+
+void RVMReader::createFacetGroup(const std::array<float, 12>& matrix, const FGroup& vertexes) {
+    RVMFacetGroupArena arena;
+    arena.append(vertexes);
+    createFacetGroup(matrix, arena.facetGroup(0));
+}
@@ -23,14 +23,17 @@
 #define RVMREADER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
+#include <memory>
+#include <ostream>
 
 #include "vector3f.h"
+#include "rvmfacetgroup.h"
 #include "rvmprimitive.h"
 
-typedef std::pair<Vector3F, Vector3F> PositionNormalTuple;
-typedef std::vector<std::vector<std::vector<PositionNormalTuple> > > FGroup;
+class RVMMeshCache;
 
 /**
  * @brief RVM reader base class
@@ -110,10 +113,12 @@ class RVMReader
 
         /**
          * @brief Called for each key/value attribute pair
+         *
+         * The views are only valid during the call: readers keeping the attribute have to copy it.
          * @param name the name of the attribute.
          * @param value its value.
          */
-        virtual void startMetaDataPair(const std::string& name, const std::string& value) = 0;
+        virtual void startMetaDataPair(std::string_view name, std::string_view value) = 0;
         /**
          * @brief Called at the end of an attribute.
          */
@@ -205,11 +210,22 @@ class RVMReader
          * Separated in patch/group/vertexes.
          * If more than one group is found in a patch, each group should be closed.
          *
+         * The facet group is flattened and given to the flat createFacetGroup.
          * @param matrix
          * @param vertexes
          */
+        void createFacetGroup(const std::array<float, 12>& matrix,
+                              const FGroup& vertexes);
+
+        /**
+         * @brief Describes a facet group, stored flat.
+         *
+         * This is the method called by the parser. The spans are only valid during the call.
+         * @param matrix
+         * @param facetGroup
+         */
         virtual void createFacetGroup(const std::array<float, 12>& matrix,
-                                     const FGroup& vertexes) = 0;
+                                      const RVMFacetGroup& facetGroup) = 0;
 
         /**
          * Setting/Replacing an existing entry in the color map.
@@ -219,6 +235,31 @@ class RVMReader
          */
         virtual void updateColorPalette(std::uint32_t index, const std::array<std::uint8_t, 4> &color) {}
 
+        /**
+         * @brief Tells if the reader writes repeated groups as instances.
+         *
+         * Instances are only sent by RVMSceneModel::replay, once RVMSceneModel::findInstances found them.
+         * Other readers receive every group in full.
+         */
+        virtual bool supportsInstances() const { return false; }
+        /**
+         * @brief Called right after startGroup for a group whose content is repeated later in the document.
+         * @param prototype identifies the group in startGroupInstance.
+         */
+        virtual void definePrototype(std::uint32_t prototype) {}
+        /**
+         * @brief Called instead of startGroup for a group repeating the content of a prototype group.
+         *
+         * The content of the group is not sent: only its attributes follow, then endGroup.
+         * @param name the name of the group
+         * @param translation the translation of the group, relative to the model origin.
+         * @param materialId the material of the group
+         * @param prototype the repeated group, @see definePrototype
+         * @param matrix 3x4 transformation matrix from the prototype content to the content of this group.
+         */
+        virtual void startGroupInstance(const std::string& name, const Vector3F& translation, const int& materialId,
+                                        std::uint32_t prototype, const std::array<float, 12>& matrix) {}
+
         /**
          * @brief Sets the maximum size for a side of a primitive when tesselating.
          * @param size
@@ -239,12 +280,41 @@ class RVMReader
          * @param primitives
          */
         void setUsePrimitives(bool primitives) { m_primitives = primitives; }
+        /**
+         * @brief Sets if the reader should tesselate primitives at unit size and scale them in their transform.
+         *
+         * Primitives that only differ by their size then share a mesh. Ignored with native primitives.
+         * @see RVMMeshCache::unitPrimitive
+         * @param unitMeshes
+         */
+        void setUseUnitMeshes(bool unitMeshes) { m_unitMeshes = unitMeshes; }
+        /**
+         * @brief Sets the distance under which the vertices of a facet group are merged. Default 0 (identical only).
+         * @see RVMVertexWelder
+         * @param tolerance
+         */
+        void setWeldTolerance(float tolerance) { m_weldTolerance = tolerance; }
+        /**
+         * @brief Sets the stream receiving the messages of the reader. Default is std::cout.
+         * @param log
+         */
+        void setLog(std::ostream& log) { m_log = &log; }
+        /**
+         * @brief Sets the cache of tesselated primitives. Readers sharing a cache tesselate each primitive once.
+         * By default, each reader has its own cache.
+         * @param cache
+         */
+        void setMeshCache(const std::shared_ptr<RVMMeshCache>& cache) { m_meshCache = cache; }
 
     protected:
         int m_minSides;
         float m_maxSideSize;
         bool m_split;
         bool m_primitives;
+        bool m_unitMeshes;
+        float m_weldTolerance;
+        std::ostream* m_log;
+        std::shared_ptr<RVMMeshCache> m_meshCache;
 };
 
 #endif // RVMREADER_H
@@ -0,0 +1,789 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmscenemodel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "rvmfilehelper.h"
+#include "rvmmappedfile.h"
+
+using namespace std;
+
+namespace {
+
+    const char CACHE_MAGIC[8] = { 'P', 'M', 'U', 'C', 'S', 'C', 'N', 0 };
+    const uint32_t CACHE_VERSION = 2;
+
+    // Facet group vertices are mapped as they are stored.
+    static_assert(sizeof(PositionNormalTuple) == 6 * sizeof(float), "PositionNormalTuple has to be 6 packed floats");
+
+    inline size_t align8_(size_t size) {
+        return (size + 7) & ~size_t(7);
+    }
+
+    inline void pad_(ostream& out, size_t size) {
+        static const char zeros[8] = { 0 };
+        out.write(zeros, align8_(size) - size);
+    }
+
+    /// Writes a vector or an RVMMappedArray.
+    template<typename Array>
+    inline void writeArray_(ostream& out, const Array& values) {
+        const uint64_t count = values.size();
+        const size_t size = values.size() * sizeof(*values.data());
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(values.data()), size);
+        pad_(out, size);
+    }
+
+    /// Bounds checked reads from a mapped cache file.
+    struct CacheInput
+    {
+        const char*     data;
+        size_t          size;
+        size_t          position;
+
+        /// Elements of the next table, in place. Tables are aligned on 8 bytes in the mapping.
+        template<typename T>
+        bool view(const T*& values, size_t& count) {
+            uint64_t count64;
+            if (size - position < sizeof(count64)) {
+                return false;
+            }
+            memcpy(&count64, data + position, sizeof(count64));
+            position += sizeof(count64);
+            if (count64 > (size - position) / sizeof(T)) {
+                return false;
+            }
+            values = reinterpret_cast<const T*>(data + position);
+            count = size_t(count64);
+            position = min(size, position + align8_(count * sizeof(T)));
+            return true;
+        }
+
+        template<typename T>
+        bool readArray(vector<T>& values) {
+            const T* begin;
+            size_t count;
+            if (!view(begin, count)) {
+                return false;
+            }
+            values.assign(begin, begin + count);
+            return true;
+        }
+
+        template<typename T>
+        bool mapArray(RVMMappedArray<T>& values) {
+            const T* begin;
+            size_t count;
+            if (!view(begin, count)) {
+                return false;
+            }
+            values.map(begin, count);
+            return true;
+        }
+    };
+
+    template<typename T>
+    inline T primitive_(const float* values) {
+        T params;
+        memcpy(&params, values, sizeof(T));
+        return params;
+    }
+
+    inline array<float, 12> matrix_(const float* values) {
+        array<float, 12> matrix;
+        memcpy(matrix.data(), values, sizeof(float) * 12);
+        return matrix;
+    }
+
+    const size_t PARAMETER_COUNTS[] = {
+        sizeof(Primitives::Pyramid) / sizeof(float),
+        sizeof(Primitives::Box) / sizeof(float),
+        sizeof(Primitives::RectangularTorus) / sizeof(float),
+        sizeof(Primitives::CircularTorus) / sizeof(float),
+        sizeof(Primitives::EllipticalDish) / sizeof(float),
+        sizeof(Primitives::SphericalDish) / sizeof(float),
+        sizeof(Primitives::Snout) / sizeof(float),
+        sizeof(Primitives::Cylinder) / sizeof(float),
+        sizeof(Primitives::Sphere) / sizeof(float),
+        2, // Line: start and end
+        0  // FacetGroup
+    };
+
+    /// Product of two 3x4 column-major matrices, as affine transformations.
+    inline void multiplyAffine_(const double* a, const double* b, double* out) {
+        for (int j = 0; j < 4; j++) {
+            for (int i = 0; i < 3; i++) {
+                double value = j == 3 ? a[9 + i] : 0.;
+                for (int k = 0; k < 3; k++) {
+                    value += a[i + k * 3] * b[k + j * 3];
+                }
+                out[i + j * 3] = value;
+            }
+        }
+    }
+
+    /// Inverse of a 3x4 column-major affine matrix. Returns false if it is singular.
+    inline bool invertAffine_(const double* m, double* out) {
+        const double det = m[0] * (m[4] * m[8] - m[5] * m[7])
+            - m[3] * (m[1] * m[8] - m[2] * m[7])
+            + m[6] * (m[1] * m[5] - m[2] * m[4]);
+        if (!(abs(det) > 1e-30)) {
+            return false;
+        }
+        out[0] = (m[4] * m[8] - m[5] * m[7]) / det;
+        out[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+        out[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+        out[3] = (m[5] * m[6] - m[3] * m[8]) / det;
+        out[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+        out[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+        out[6] = (m[3] * m[7] - m[4] * m[6]) / det;
+        out[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+        out[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+        for (int i = 0; i < 3; i++) {
+            out[9 + i] = -(out[i] * m[9] + out[i + 3] * m[10] + out[i + 6] * m[11]);
+        }
+        return true;
+    }
+
+    /// Rotation with a uniform scale: orthogonal axes of the same length, without mirroring.
+    inline bool isSimilarity_(const double* m) {
+        const double scale = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+        const double epsilon = scale * 1e-4;
+        for (int i = 0; i < 3; i++) {
+            for (int j = i; j < 3; j++) {
+                const double dot = m[i * 3] * m[j * 3] + m[i * 3 + 1] * m[j * 3 + 1] + m[i * 3 + 2] * m[j * 3 + 2];
+                if (abs(dot - (i == j ? scale : 0.)) > epsilon) {
+                    return false;
+                }
+            }
+        }
+        const double det = m[0] * (m[4] * m[8] - m[5] * m[7])
+            - m[3] * (m[1] * m[8] - m[2] * m[7])
+            + m[6] * (m[1] * m[5] - m[2] * m[4]);
+        return scale > 0 && det > 0;
+    }
+
+    /// Exact comparison of floats, where -0 equals 0.
+    inline int64_t bits_(float value) {
+        uint32_t bits;
+        value = value == 0.f ? 0.f : value;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+}
+
+RVMSceneModel::RVMSceneModel() :
+    m_stringIds(0, StringIdHash{ this }, StringIdEqual{ this }),
+    m_indexedStrings(0) {
+    clear();
+}
+
+RVMSceneModel::~RVMSceneModel() {
+}
+
+size_t RVMSceneModel::parameterCount(PrimitiveType type) {
+    return PARAMETER_COUNTS[type];
+}
+
+void RVMSceneModel::clear() {
+    m_itemTypes.clear();
+    m_itemIndices.clear();
+    m_stringData.clear();
+    m_stringOffsets.assign(1, 0);
+    m_stringIds.clear();
+    m_indexedStrings = 0;
+    const uint32_t empty = intern("");
+    for (uint32_t& id : m_header) {
+        id = empty;
+    }
+    m_groupParents.clear();
+    m_groupNames.clear();
+    m_groupTranslations.clear();
+    m_groupMaterials.clear();
+    m_groupAttributes.clear();
+    m_groupAttributeCounts.clear();
+    m_openGroups.clear();
+    m_attributeNames.clear();
+    m_attributeValues.clear();
+    for (PrimitiveTable& table : m_primitives) {
+        table.groups.clear();
+        table.matrices.clear();
+        table.parameters.clear();
+    }
+    m_facetGroups.clear();
+    m_paletteIndices.clear();
+    m_paletteColors.clear();
+    m_groupPrototypes.clear();
+    m_groupInstanceMatrices.clear();
+    m_prototypeGroups.clear();
+    m_groupEnds.clear();
+    m_file.close();
+}
+
+uint32_t RVMSceneModel::intern(string_view str) {
+    // Loaded models only get their lookup table when more strings are added.
+    const size_t count = m_stringOffsets.size() - 1;
+    for (; m_indexedStrings < count; m_indexedStrings++) {
+        m_stringIds.insert(uint32_t(m_indexedStrings));
+    }
+    // The string looked up is found through its text, as the id NONE.
+    m_lookup = str;
+    auto it = m_stringIds.find(NONE);
+    if (it != m_stringIds.end()) {
+        return *it;
+    }
+    const uint32_t id = uint32_t(count);
+    m_stringData.append(str.begin(), str.end());
+    m_stringOffsets.push_back(uint32_t(m_stringData.size()));
+    m_stringIds.insert(id);
+    m_indexedStrings++;
+    return id;
+}
+
+void RVMSceneModel::addItem(ItemType type, uint32_t index) {
+    m_itemTypes.push_back(type);
+    m_itemIndices.push_back(index);
+}
+
+void RVMSceneModel::addPrimitive(PrimitiveType type, const array<float, 12>& matrix, const float* parameters) {
+    PrimitiveTable& table = m_primitives[type];
+    addItem(ItemType(type), uint32_t(table.size()));
+    table.groups.push_back(m_openGroups.empty() ? NONE : m_openGroups.back());
+    table.matrices.append(matrix.begin(), matrix.end());
+    table.parameters.append(parameters, parameters + PARAMETER_COUNTS[type]);
+}
+
+void RVMSceneModel::startDocument() {
+    addItem(DocumentStart);
+}
+
+void RVMSceneModel::endDocument() {
+    addItem(DocumentEnd);
+}
+
+void RVMSceneModel::startHeader(const string& banner, const string& fileNote, const string& date, const string& user, const string& encoding) {
+    addItem(HeaderStart);
+    m_header[0] = intern(banner);
+    m_header[1] = intern(fileNote);
+    m_header[2] = intern(date);
+    m_header[3] = intern(user);
+    m_header[4] = intern(encoding);
+}
+
+void RVMSceneModel::endHeader() {
+    addItem(HeaderEnd);
+}
+
+void RVMSceneModel::startModel(const string& projectName, const string& name) {
+    addItem(ModelStart);
+    m_header[5] = intern(projectName);
+    m_header[6] = intern(name);
+}
+
+void RVMSceneModel::endModel() {
+    addItem(ModelEnd);
+}
+
+void RVMSceneModel::startGroup(const string& name, const Vector3F& translation, const int& materialId) {
+    const uint32_t group = uint32_t(m_groupParents.size());
+    addItem(GroupStart, group);
+    m_groupParents.push_back(m_openGroups.empty() ? NONE : m_openGroups.back());
+    m_groupNames.push_back(intern(name));
+    m_groupTranslations.push_back(translation[0]);
+    m_groupTranslations.push_back(translation[1]);
+    m_groupTranslations.push_back(translation[2]);
+    m_groupMaterials.push_back(materialId);
+    m_groupAttributes.push_back(NONE);
+    m_groupAttributeCounts.push_back(0);
+    m_openGroups.push_back(group);
+}
+
+void RVMSceneModel::endGroup() {
+    addItem(GroupEnd);
+    if (!m_openGroups.empty()) {
+        m_openGroups.pop_back();
+    }
+}
+
+void RVMSceneModel::startMetaData() {
+    if (!m_openGroups.empty()) {
+        m_groupAttributes.set(m_openGroups.back(), uint32_t(m_attributeNames.size()));
+        m_groupAttributeCounts.set(m_openGroups.back(), 0);
+    }
+}
+
+void RVMSceneModel::endMetaData() {
+}
+
+void RVMSceneModel::startMetaDataPair(string_view name, string_view value) {
+    if (!m_openGroups.empty()) {
+        m_attributeNames.push_back(intern(name));
+        m_attributeValues.push_back(intern(value));
+        m_groupAttributeCounts.set(m_openGroups.back(), m_groupAttributeCounts[m_openGroups.back()] + 1);
+    }
+}
+
+void RVMSceneModel::endMetaDataPair() {
+}
+
+void RVMSceneModel::createPyramid(const array<float, 12>& matrix, const Primitives::Pyramid& params) {
+    addPrimitive(Pyramid, matrix, params.data);
+}
+
+void RVMSceneModel::createBox(const array<float, 12>& matrix, const Primitives::Box& params) {
+    addPrimitive(Box, matrix, params.len);
+}
+
+void RVMSceneModel::createRectangularTorus(const array<float, 12>& matrix, const Primitives::RectangularTorus& params) {
+    addPrimitive(RectangularTorus, matrix, params.data);
+}
+
+void RVMSceneModel::createCircularTorus(const array<float, 12>& matrix, const Primitives::CircularTorus& params) {
+    addPrimitive(CircularTorus, matrix, params.data);
+}
+
+void RVMSceneModel::createEllipticalDish(const array<float, 12>& matrix, const Primitives::EllipticalDish& params) {
+    addPrimitive(EllipticalDish, matrix, params.data);
+}
+
+void RVMSceneModel::createSphericalDish(const array<float, 12>& matrix, const Primitives::SphericalDish& params) {
+    addPrimitive(SphericalDish, matrix, params.data);
+}
+
+void RVMSceneModel::createSnout(const array<float, 12>& matrix, const Primitives::Snout& params) {
+    addPrimitive(Snout, matrix, params.data);
+}
+
+void RVMSceneModel::createCylinder(const array<float, 12>& matrix, const Primitives::Cylinder& params) {
+    addPrimitive(Cylinder, matrix, params.data);
+}
+
+void RVMSceneModel::createSphere(const array<float, 12>& matrix, const Primitives::Sphere& params) {
+    addPrimitive(Sphere, matrix, &params.diameter);
+}
+
+void RVMSceneModel::createLine(const array<float, 12>& matrix, const float& startx, const float& endx) {
+    const float params[] = { startx, endx };
+    addPrimitive(Line, matrix, params);
+}
+
+void RVMSceneModel::createFacetGroup(const array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
+    addPrimitive(FacetGroup, matrix, 0);
+    m_facetGroups.append(facetGroup);
+}
+
+void RVMSceneModel::updateColorPalette(uint32_t index, const array<uint8_t, 4>& color) {
+    addItem(ColorPalette, uint32_t(m_paletteIndices.size()));
+    m_paletteIndices.push_back(index);
+    m_paletteColors.push_back(color);
+}
+
+void RVMSceneModel::replayAttributes(RVMReader& reader, uint32_t group) const {
+    if (m_groupAttributes[group] != NONE) {
+        reader.startMetaData();
+        const uint32_t end = m_groupAttributes[group] + m_groupAttributeCounts[group];
+        for (uint32_t a = m_groupAttributes[group]; a < end; a++) {
+            reader.startMetaDataPair(attributeName(a), attributeValue(a));
+            reader.endMetaDataPair();
+        }
+        reader.endMetaData();
+    }
+}
+
+void RVMSceneModel::replay(RVMReader& reader) const {
+    string h[7];
+    for (int i = 0; i < 7; i++) {
+        h[i] = string(stringAt(m_header[i]));
+    }
+    const bool instances = !m_groupPrototypes.empty() && reader.supportsInstances();
+    for (size_t item = 0; item < m_itemTypes.size(); item++) {
+        const uint8_t type = m_itemTypes[item];
+        const uint32_t i = m_itemIndices[item];
+        const float* m = 0;
+        const float* p = 0;
+        if (type < PrimitiveTypeCount) {
+            const PrimitiveTable& table = m_primitives[type];
+            m = table.matrices.data() + size_t(i) * 12;
+            p = table.parameters.data() + size_t(i) * PARAMETER_COUNTS[type];
+        }
+        switch (type) {
+            case DocumentStart: reader.startDocument(); break;
+            case DocumentEnd: reader.endDocument(); break;
+            case HeaderStart: reader.startHeader(h[0], h[1], h[2], h[3], h[4]); break;
+            case HeaderEnd: reader.endHeader(); break;
+            case ModelStart: reader.startModel(h[5], h[6]); break;
+            case ModelEnd: reader.endModel(); break;
+            case GroupStart: {
+                if (instances && m_groupPrototypes[i] != NONE) {
+                    // The content of the group is skipped, up to its end.
+                    reader.startGroupInstance(string(groupName(i)), groupTranslation(i), m_groupMaterials[i],
+                                              m_groupPrototypes[i], matrix_(&m_groupInstanceMatrices[size_t(i) * 12]));
+                    replayAttributes(reader, i);
+                    reader.endGroup();
+                    item = m_groupEnds[i];
+                    break;
+                }
+                reader.startGroup(string(groupName(i)), groupTranslation(i), m_groupMaterials[i]);
+                if (instances && m_prototypeGroups[i]) {
+                    reader.definePrototype(i);
+                }
+                replayAttributes(reader, i);
+            } break;
+            case GroupEnd: reader.endGroup(); break;
+            case ColorPalette: reader.updateColorPalette(m_paletteIndices[i], m_paletteColors[i]); break;
+            case Pyramid: reader.createPyramid(matrix_(m), primitive_<Primitives::Pyramid>(p)); break;
+            case Box: reader.createBox(matrix_(m), primitive_<Primitives::Box>(p)); break;
+            case RectangularTorus: reader.createRectangularTorus(matrix_(m), primitive_<Primitives::RectangularTorus>(p)); break;
+            case CircularTorus: reader.createCircularTorus(matrix_(m), primitive_<Primitives::CircularTorus>(p)); break;
+            case EllipticalDish: reader.createEllipticalDish(matrix_(m), primitive_<Primitives::EllipticalDish>(p)); break;
+            case SphericalDish: reader.createSphericalDish(matrix_(m), primitive_<Primitives::SphericalDish>(p)); break;
+            case Snout: reader.createSnout(matrix_(m), primitive_<Primitives::Snout>(p)); break;
+            case Cylinder: reader.createCylinder(matrix_(m), primitive_<Primitives::Cylinder>(p)); break;
+            case Sphere: reader.createSphere(matrix_(m), primitive_<Primitives::Sphere>(p)); break;
+            case Line: reader.createLine(matrix_(m), p[0], p[1]); break;
+            case FacetGroup: reader.createFacetGroup(matrix_(m), m_facetGroups.facetGroup(i)); break;
+            default: break;
+        }
+    }
+}
+
+void RVMSceneModel::addSignature(vector<int64_t>& words, size_t item, bool inner, const double* inverse, float tolerance) const {
+    const uint8_t type = m_itemTypes[item];
+    const uint32_t i = m_itemIndices[item];
+    words.push_back(type);
+    if (type == GroupStart) {
+        words.push_back(m_groupMaterials[i]);
+        // Inner groups are replayed from the prototype: their names and attributes must be the same.
+        // Strings are interned, so equal strings have equal ids.
+        if (inner) {
+            words.push_back(m_groupNames[i]);
+            words.push_back(m_groupAttributeCounts[i]);
+            for (uint32_t a = 0; a < m_groupAttributeCounts[i]; a++) {
+                words.push_back(m_attributeNames[m_groupAttributes[i] + a]);
+                words.push_back(m_attributeValues[m_groupAttributes[i] + a]);
+            }
+        }
+    } else if (type == ColorPalette) {
+        const array<uint8_t, 4>& color = m_paletteColors[i];
+        words.push_back(m_paletteIndices[i]);
+        words.push_back(int64_t(color[0]) | int64_t(color[1]) << 8 | int64_t(color[2]) << 16 | int64_t(color[3]) << 24);
+    } else if (type < PrimitiveTypeCount) {
+        const PrimitiveTable& table = m_primitives[type];
+        const float* parameters = table.parameters.data() + size_t(i) * PARAMETER_COUNTS[type];
+        for (size_t p = 0; p < PARAMETER_COUNTS[type]; p++) {
+            words.push_back(bits_(parameters[p]));
+        }
+        double matrix[12], relative[12];
+        copy(table.matrices.data() + size_t(i) * 12, table.matrices.data() + size_t(i) * 12 + 12, matrix);
+        multiplyAffine_(inverse, matrix, relative);
+        for (double value : relative) {
+            words.push_back(llround(value / tolerance));
+        }
+        if (type == FacetGroup) {
+            const RVMFacetGroup group = m_facetGroups.facetGroup(i);
+            for (size_t p = 0; p < group.polygonCount(); p++) {
+                words.push_back(int64_t(group.contourEnd(p) - group.contourBegin(p)));
+                for (size_t k = group.contourBegin(p); k < group.contourEnd(p); k++) {
+                    const RVMSpan<PositionNormalTuple> contour = group.contour(k);
+                    words.push_back(int64_t(contour.size()));
+                    for (const auto& vertex : contour) {
+                        for (int c = 0; c < 3; c++) {
+                            words.push_back(bits_(vertex.first[c]));
+                            words.push_back(bits_(vertex.second[c]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+size_t RVMSceneModel::findInstances(float tolerance) {
+    const size_t groups = groupCount();
+    m_groupPrototypes.assign(groups, NONE);
+    m_groupInstanceMatrices.assign(groups * 12, 0.f);
+    m_prototypeGroups.assign(groups, 0);
+
+    // Item range of each group. Groups are numbered in the order of their start.
+    vector<size_t> starts(groups, 0);
+    m_groupEnds.assign(groups, m_itemTypes.size());
+    vector<uint32_t> open;
+    for (size_t item = 0; item < m_itemTypes.size(); item++) {
+        if (m_itemTypes[item] == GroupStart) {
+            starts[m_itemIndices[item]] = item;
+            open.push_back(m_itemIndices[item]);
+        } else if (m_itemTypes[item] == GroupEnd && !open.empty()) {
+            m_groupEnds[open.back()] = item;
+            open.pop_back();
+        }
+    }
+
+    // Palette changes of each color index, in the order of the items.
+    unordered_map<uint32_t, vector<pair<size_t, uint32_t> > > paletteChanges;
+    for (size_t item = 0; item < m_itemTypes.size(); item++) {
+        if (m_itemTypes[item] == ColorPalette) {
+            const uint32_t change = m_itemIndices[item];
+            paletteChanges[m_paletteIndices[change]].push_back(make_pair(item, change));
+        }
+    }
+    // Color of a material at an item, -1 if the palette did not change it.
+    auto paletteColor = [&](int material, size_t item) -> int64_t {
+        const auto changes = paletteChanges.find(uint32_t(material));
+        if (changes == paletteChanges.end()) {
+            return -1;
+        }
+        const auto next = lower_bound(changes->second.begin(), changes->second.end(), make_pair(item, uint32_t(0)));
+        if (next == changes->second.begin()) {
+            return -1;
+        }
+        const array<uint8_t, 4>& color = m_paletteColors[prev(next)->second];
+        return int64_t(color[0]) | int64_t(color[1]) << 8 | int64_t(color[2]) << 16 | int64_t(color[3]) << 24;
+    };
+
+    // Groups already written, by hash of their signature, with the inverse of their reference matrix.
+    struct Prototype
+    {
+        uint32_t            group;
+        vector<int64_t>     words;
+        double              inverse[12];
+    };
+    unordered_map<uint64_t, vector<Prototype> > prototypes;
+    vector<uint8_t> hidden(groups, 0);
+    vector<int64_t> words;
+    size_t count = 0;
+    for (uint32_t g = 0; g < groups; g++) {
+        // The content of instances is not written.
+        const uint32_t parent = m_groupParents[g];
+        if (parent != NONE && (hidden[parent] || m_groupPrototypes[parent] != NONE)) {
+            hidden[g] = 1;
+            continue;
+        }
+
+        // The subtree is placed by its first primitive, and can not be instanced without one.
+        const size_t end = min(m_groupEnds[g], m_itemTypes.size() - 1);
+        size_t first = starts[g];
+        while (first <= end && m_itemTypes[first] >= PrimitiveTypeCount) {
+            first++;
+        }
+        if (first > end) {
+            continue;
+        }
+        double reference[12], inverse[12];
+        const float* m = m_primitives[m_itemTypes[first]].matrices.data() + size_t(m_itemIndices[first]) * 12;
+        copy(m, m + 12, reference);
+        if (!invertAffine_(reference, inverse)) {
+            continue;
+        }
+
+        words.clear();
+        for (size_t item = starts[g]; item <= end; item++) {
+            addSignature(words, item, item != starts[g], inverse, tolerance);
+            // Materials are colored by the palette as it is at the start of the subtree, which differs between copies.
+            if (m_itemTypes[item] == GroupStart) {
+                words.push_back(paletteColor(m_groupMaterials[m_itemIndices[item]], starts[g]));
+            }
+        }
+        uint64_t hash = 14695981039346656037ULL;
+        for (int64_t word : words) {
+            hash = (hash ^ uint64_t(word)) * 1099511628211ULL;
+        }
+
+        vector<Prototype>& candidates = prototypes[hash];
+        bool instanced = false;
+        for (const Prototype& candidate : candidates) {
+            if (candidate.words != words) {
+                continue;
+            }
+            // Content of this group = transformation * content of the prototype.
+            double transformation[12];
+            multiplyAffine_(reference, candidate.inverse, transformation);
+            if (!isSimilarity_(transformation)) {
+                continue;
+            }
+            m_groupPrototypes[g] = candidate.group;
+            copy(transformation, transformation + 12, &m_groupInstanceMatrices[size_t(g) * 12]);
+            m_prototypeGroups[candidate.group] = 1;
+            instanced = true;
+            count++;
+            break;
+        }
+        if (!instanced) {
+            Prototype prototype = { g, words, {} };
+            copy(inverse, inverse + 12, prototype.inverse);
+            candidates.push_back(move(prototype));
+        }
+    }
+    return count;
+}
+
+string RVMSceneModel::cacheFilename(const string& rvmFilename) {
+    return rvmFilename + ".cache";
+}
+
+bool RVMSceneModel::save(const string& filename, const string& key) const {
+    // Another run may have the cache mapped: it is replaced, never written in place.
+    const string tmpFilename = RVMFileHelper::temporaryFilename(filename);
+    ofstream out(tmpFilename.data(), ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+    pad_(out, sizeof(CACHE_MAGIC) + sizeof(CACHE_VERSION));
+    writeArray_(out, vector<char>(key.begin(), key.end()));
+
+    writeArray_(out, m_stringOffsets);
+    writeArray_(out, m_stringData);
+    writeArray_(out, vector<uint32_t>(m_header, m_header + 7));
+
+    writeArray_(out, m_itemTypes);
+    writeArray_(out, m_itemIndices);
+
+    writeArray_(out, m_groupParents);
+    writeArray_(out, m_groupNames);
+    writeArray_(out, m_groupTranslations);
+    writeArray_(out, m_groupMaterials);
+    writeArray_(out, m_groupAttributes);
+    writeArray_(out, m_groupAttributeCounts);
+    writeArray_(out, m_attributeNames);
+    writeArray_(out, m_attributeValues);
+
+    for (const PrimitiveTable& table : m_primitives) {
+        writeArray_(out, table.groups);
+        writeArray_(out, table.matrices);
+        writeArray_(out, table.parameters);
+    }
+
+    // Facet groups are stored as their arena: offsets of the groups, polygons and contours, then the vertices.
+    writeArray_(out, m_facetGroups.groups());
+    writeArray_(out, m_facetGroups.polygons());
+    writeArray_(out, m_facetGroups.contours());
+    writeArray_(out, m_facetGroups.vertices());
+
+    writeArray_(out, m_paletteIndices);
+    writeArray_(out, m_paletteColors);
+    out.close();
+    return RVMFileHelper::replace(tmpFilename, filename, !out.fail());
+}
+
+bool RVMSceneModel::load(const string& filename, const string& key) {
+    clear();
+
+    const size_t headerSize = align8_(sizeof(CACHE_MAGIC) + sizeof(CACHE_VERSION));
+    if (!m_file.open(filename) || m_file.size() < headerSize) {
+        clear();
+        return false;
+    }
+    uint32_t version;
+    memcpy(&version, m_file.data() + sizeof(CACHE_MAGIC), sizeof(version));
+    if (memcmp(m_file.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || version != CACHE_VERSION) {
+        clear();
+        return false;
+    }
+
+    CacheInput in = { m_file.data(), m_file.size(), headerSize };
+    const char* cacheKey;
+    size_t cacheKeySize;
+    if (!in.view(cacheKey, cacheKeySize) || string_view(cacheKey, cacheKeySize) != key) {
+        clear();
+        return false;
+    }
+
+    // The tables are used in place.
+    vector<uint32_t> header;
+    const uint32_t* facetGroups[3];
+    size_t facetGroupSizes[3];
+    const PositionNormalTuple* vertices;
+    size_t vertexCount;
+    bool ok = in.mapArray(m_stringOffsets) && in.mapArray(m_stringData) && in.readArray(header)
+        && in.mapArray(m_itemTypes) && in.mapArray(m_itemIndices)
+        && in.mapArray(m_groupParents) && in.mapArray(m_groupNames) && in.mapArray(m_groupTranslations)
+        && in.mapArray(m_groupMaterials) && in.mapArray(m_groupAttributes) && in.mapArray(m_groupAttributeCounts)
+        && in.mapArray(m_attributeNames) && in.mapArray(m_attributeValues);
+    for (PrimitiveTable& table : m_primitives) {
+        ok = ok && in.mapArray(table.groups) && in.mapArray(table.matrices) && in.mapArray(table.parameters);
+    }
+    for (int i = 0; i < 3; i++) {
+        ok = ok && in.view(facetGroups[i], facetGroupSizes[i]);
+    }
+    ok = ok && in.view(vertices, vertexCount) && in.mapArray(m_paletteIndices) && in.mapArray(m_paletteColors)
+        && m_facetGroups.map(vertices, vertexCount, facetGroups[2], facetGroupSizes[2], facetGroups[1], facetGroupSizes[1],
+                             facetGroups[0], facetGroupSizes[0]);
+
+    // Check that every index points into its table, so that a damaged file can not be replayed.
+    ok = ok && !m_stringOffsets.empty() && m_stringOffsets.front() == 0 && m_stringOffsets.back() == m_stringData.size() && header.size() == 7
+        && m_itemIndices.size() == m_itemTypes.size()
+        && m_groupNames.size() == m_groupParents.size() && m_groupTranslations.size() == m_groupParents.size() * 3
+        && m_groupMaterials.size() == m_groupParents.size() && m_groupAttributes.size() == m_groupParents.size()
+        && m_groupAttributeCounts.size() == m_groupParents.size() && m_attributeValues.size() == m_attributeNames.size()
+        && m_paletteColors.size() == m_paletteIndices.size() && m_facetGroups.size() == m_primitives[FacetGroup].size();
+    for (size_t i = 1; ok && i < m_stringOffsets.size(); i++) {
+        ok = m_stringOffsets[i - 1] <= m_stringOffsets[i];
+    }
+    const size_t stringCount = ok ? m_stringOffsets.size() - 1 : 0;
+    for (size_t i = 0; ok && i < 7; i++) {
+        ok = header[i] < stringCount;
+    }
+    for (size_t i = 0; ok && i < m_groupNames.size(); i++) {
+        ok = m_groupNames[i] < stringCount && (m_groupAttributes[i] == NONE
+            || (m_groupAttributes[i] <= m_attributeNames.size() && m_groupAttributeCounts[i] <= m_attributeNames.size() - m_groupAttributes[i]));
+    }
+    for (size_t i = 0; ok && i < m_attributeNames.size(); i++) {
+        ok = m_attributeNames[i] < stringCount && m_attributeValues[i] < stringCount;
+    }
+    for (size_t type = 0; ok && type < PrimitiveTypeCount; type++) {
+        const PrimitiveTable& table = m_primitives[type];
+        ok = table.matrices.size() == table.size() * 12 && table.parameters.size() == table.size() * PARAMETER_COUNTS[type];
+    }
+    for (size_t i = 0; ok && i < m_itemTypes.size(); i++) {
+        const uint8_t type = m_itemTypes[i];
+        const uint32_t index = m_itemIndices[i];
+        if (type < PrimitiveTypeCount) {
+            ok = index < m_primitives[type].size();
+        } else if (type == GroupStart) {
+            ok = index < m_groupParents.size();
+        } else if (type == ColorPalette) {
+            ok = index < m_paletteIndices.size();
+        } else {
+            ok = type <= ModelEnd;
+        }
+    }
+
+    if (!ok) {
+        clear();
+        return false;
+    }
+
+    copy(header.begin(), header.end(), m_header);
+    m_stringIds.clear();
+    m_indexedStrings = 0;
+    return true;
+}
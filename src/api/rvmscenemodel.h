@@ -0,0 +1,270 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMSCENEMODEL_H
+#define RVMSCENEMODEL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "rvmmappedarray.h"
+#include "rvmmappedfile.h"
+#include "rvmreader.h"
+
+/**
+ * @brief In-memory model of a whole RVM document, built by parsing it once.
+ *
+ * The model is an RVMReader: give it to RVMParser to fill it, then replay it to any number of readers.
+ * Data is stored in flat arrays rather than objects:
+ * - groups as parallel arrays of parent, name, translation, material and attribute range,
+ * - primitives in one table per type, with their group, 3x4 matrices and parameters,
+ * - strings (names, attribute keys and values) interned once, concatenated in one array.
+ * A compact sequence of items keeps the document order, so that a replay sends exactly the events received.
+ *
+ * Attributes are attached to the innermost open group and replayed right after its start,
+ * which is where RVMParser sends them.
+ *
+ * A model loaded from a cache file replays its tables directly from the mapped file.
+ */
+class RVMSceneModel : public RVMReader
+{
+    public:
+        enum PrimitiveType : uint8_t {
+            Pyramid, Box, RectangularTorus, CircularTorus, EllipticalDish, SphericalDish,
+            Snout, Cylinder, Sphere, Line, FacetGroup, PrimitiveTypeCount
+        };
+
+        /// Primitives of one type. Facet group vertices are kept separately, @see facetGroup.
+        struct PrimitiveTable
+        {
+            /// Group of each primitive
+            RVMMappedArray<uint32_t>    groups;
+            /// 12 floats per primitive
+            RVMMappedArray<float>       matrices;
+            /// parameterCount(type) floats per primitive
+            RVMMappedArray<float>       parameters;
+
+            size_t size() const { return groups.size(); }
+        };
+
+        /// Value of a group without parent, or without attributes.
+        static constexpr uint32_t NONE = 0xffffffff;
+
+        RVMSceneModel();
+        virtual ~RVMSceneModel();
+
+        virtual void startDocument();
+        virtual void endDocument();
+
+        virtual void startHeader(const std::string& banner, const std::string& fileNote, const std::string& date, const std::string& user, const std::string& encoding);
+        virtual void endHeader();
+
+        virtual void startModel(const std::string& projectName, const std::string& name);
+        virtual void endModel();
+
+        virtual void startGroup(const std::string& name, const Vector3F& translation, const int& materialId);
+        virtual void endGroup();
+
+        virtual void startMetaData();
+        virtual void endMetaData();
+
+        virtual void startMetaDataPair(std::string_view name, std::string_view value);
+        virtual void endMetaDataPair();
+
+        virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
+
+        virtual void createBox(const std::array<float, 12>& matrix, const Primitives::Box& params);
+
+        virtual void createRectangularTorus(const std::array<float, 12>& matrix, const Primitives::RectangularTorus& params);
+
+        virtual void createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& params);
+
+        virtual void createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& params);
+
+        virtual void createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& params);
+
+        virtual void createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& params);
+
+        virtual void createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& params);
+
+        virtual void createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& params);
+
+        virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
+
+        using RVMReader::createFacetGroup;
+        virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
+
+        virtual void updateColorPalette(std::uint32_t index, const std::array<std::uint8_t, 4>& color);
+
+        /**
+         * @brief Sends the model to a reader, with the same events as the ones used to build it.
+         */
+        void replay(RVMReader& reader) const;
+
+        /**
+         * @brief Detects the groups whose subtree repeats an earlier group at another placement.
+         *
+         * Subtrees are compared structurally: hierarchy and materials of the groups, colors of these materials in the palette
+         * at the start of the subtree, names and attributes of the inner groups, types and parameters of the primitives,
+         * facet group vertices, palette changes, and primitive matrices relative to the first primitive of the subtree.
+         * The name, attributes and translation of the repeated group itself, which an instance keeps, and the translations
+         * of the inner groups are not compared.
+         * A replay to a reader supporting instances then sends the content of each repeated subtree once.
+         * @param tolerance precision of the comparison of relative matrices.
+         * @return the number of instanced groups.
+         */
+        size_t findInstances(float tolerance = 1e-4f);
+
+        /**
+         * @brief Releases the whole model.
+         */
+        void clear();
+
+        /**
+         * @brief Writes the model to a binary cache file.
+         *
+         * The file starts with a magic number, a format version and a key, followed by the tables of the model.
+         * Tables are stored in the byte order of the host, each one aligned on 8 bytes,
+         * so that a loaded model can use them in place.
+         * The file is replaced as a whole, so that a run mapping the previous one is not affected.
+         * @param filename the cache file name.
+         * @param key identifies the source data and settings the model was built from.
+         * @return true on success.
+         */
+        bool save(const std::string& filename, const std::string& key) const;
+        /**
+         * @brief Memory maps a cache file written by save and uses its tables in place.
+         *
+         * The tables are only checked, not copied: the file stays mapped until the model is cleared or loaded again.
+         * A table is copied the first time it is changed.
+         * @param key has to match the key given to save, otherwise the cache is considered outdated.
+         * @return true if a valid cache was loaded. Otherwise the model is left empty.
+         */
+        bool load(const std::string& filename, const std::string& key);
+
+        /**
+         * @brief Name of the scene cache file of an RVM file.
+         */
+        static std::string cacheFilename(const std::string& rvmFilename);
+
+        /// Number of floats describing a primitive of a given type.
+        static size_t parameterCount(PrimitiveType type);
+
+        size_t groupCount() const { return m_groupParents.size(); }
+        uint32_t groupParent(size_t group) const { return m_groupParents[group]; }
+        std::string_view groupName(size_t group) const { return stringAt(m_groupNames[group]); }
+        Vector3F groupTranslation(size_t group) const {
+            return Vector3F(m_groupTranslations[group * 3], m_groupTranslations[group * 3 + 1], m_groupTranslations[group * 3 + 2]);
+        }
+        int groupMaterial(size_t group) const { return m_groupMaterials[group]; }
+        /// First attribute of a group, NONE if it has no attributes, and number of attributes.
+        uint32_t groupAttributes(size_t group) const { return m_groupAttributes[group]; }
+        uint32_t groupAttributeCount(size_t group) const { return m_groupAttributeCounts[group]; }
+        size_t attributeCount() const { return m_attributeNames.size(); }
+        std::string_view attributeName(size_t attribute) const { return stringAt(m_attributeNames[attribute]); }
+        std::string_view attributeValue(size_t attribute) const { return stringAt(m_attributeValues[attribute]); }
+
+        /// Group whose content is repeated by a group, NONE if it is not an instance. @see findInstances
+        uint32_t groupPrototype(size_t group) const { return m_groupPrototypes.empty() ? NONE : m_groupPrototypes[group]; }
+
+        const PrimitiveTable& primitives(PrimitiveType type) const { return m_primitives[type]; }
+        RVMFacetGroup facetGroup(size_t index) const { return m_facetGroups.facetGroup(index); }
+
+    private:
+        enum ItemType : uint8_t {
+            // Primitive types come first
+            GroupStart = PrimitiveTypeCount, GroupEnd, ColorPalette,
+            DocumentStart, DocumentEnd, HeaderStart, HeaderEnd, ModelStart, ModelEnd
+        };
+
+        /// Hash and equality of interned strings given by their id. NONE stands for the string looked up by intern.
+        struct StringIdHash
+        {
+            size_t operator()(uint32_t id) const { return std::hash<std::string_view>()(model->stringAt(id)); }
+            const RVMSceneModel* model;
+        };
+        struct StringIdEqual
+        {
+            bool operator()(uint32_t a, uint32_t b) const { return model->stringAt(a) == model->stringAt(b); }
+            const RVMSceneModel* model;
+        };
+
+        RVMSceneModel(const RVMSceneModel&) = delete;
+        RVMSceneModel& operator=(const RVMSceneModel&) = delete;
+
+        std::string_view stringAt(uint32_t id) const {
+            return id == NONE ? m_lookup : std::string_view(m_stringData.data() + m_stringOffsets[id], m_stringOffsets[id + 1] - m_stringOffsets[id]);
+        }
+        uint32_t intern(std::string_view str);
+        void addItem(ItemType type, uint32_t index = 0);
+        void addPrimitive(PrimitiveType type, const std::array<float, 12>& matrix, const float* parameters);
+        void replayAttributes(RVMReader& reader, uint32_t group) const;
+        void addSignature(std::vector<int64_t>& words, size_t item, bool inner, const double* inverse, float tolerance) const;
+
+        /// Events of the document: PrimitiveType or ItemType, and index in the matching table.
+        RVMMappedArray<uint8_t>                     m_itemTypes;
+        RVMMappedArray<uint32_t>                    m_itemIndices;
+
+        /// Interned strings, concatenated, with the offset of each one and the end of the last one.
+        RVMMappedArray<char>                        m_stringData;
+        RVMMappedArray<uint32_t>                    m_stringOffsets;
+        /// Ids of the interned strings, looked up by their text without copying it.
+        std::unordered_set<uint32_t, StringIdHash, StringIdEqual> m_stringIds;
+        /// Number of strings in m_stringIds, which loaded models only fill when more strings are added.
+        size_t                                      m_indexedStrings;
+        std::string_view                            m_lookup;
+
+        /// banner, file note, date, user, encoding, project name, name
+        uint32_t                                    m_header[7];
+
+        RVMMappedArray<uint32_t>                    m_groupParents;
+        RVMMappedArray<uint32_t>                    m_groupNames;
+        RVMMappedArray<float>                       m_groupTranslations;
+        RVMMappedArray<int>                         m_groupMaterials;
+        RVMMappedArray<uint32_t>                    m_groupAttributes;
+        RVMMappedArray<uint32_t>                    m_groupAttributeCounts;
+        std::vector<uint32_t>                       m_openGroups;
+
+        RVMMappedArray<uint32_t>                    m_attributeNames;
+        RVMMappedArray<uint32_t>                    m_attributeValues;
+
+        PrimitiveTable                              m_primitives[PrimitiveTypeCount];
+        RVMFacetGroupArena                          m_facetGroups;
+
+        /// Instances found by findInstances: prototype group, transformation from the prototype and end item of each group.
+        std::vector<uint32_t>                       m_groupPrototypes;
+        std::vector<float>                          m_groupInstanceMatrices;
+        std::vector<uint8_t>                        m_prototypeGroups;
+        std::vector<size_t>                         m_groupEnds;
+
+        RVMMappedArray<uint32_t>                    m_paletteIndices;
+        RVMMappedArray<std::array<uint8_t, 4> >     m_paletteColors;
+
+        /// Cache file the tables of a loaded model are mapped from.
+        RVMMappedFile                               m_file;
+};
+
+#endif // RVMSCENEMODEL_H
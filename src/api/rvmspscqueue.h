@@ -0,0 +1,111 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMSPSCQUEUE_H
+#define RVMSPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue between one producer thread and one consumer thread.
+ *
+ * Values are stored in a ring whose size is rounded up to a power of two.
+ * push and pop wait, spinning then sleeping, when the queue is full or empty.
+ */
+template<typename T>
+class RVMSpscQueue
+{
+    public:
+        explicit RVMSpscQueue(size_t capacity) :
+            m_head(0),
+            m_tail(0) {
+            size_t size = 1;
+            while (size < capacity) {
+                size *= 2;
+            }
+            m_slots.resize(size);
+            m_mask = size - 1;
+        }
+
+        /**
+         * @brief Adds a value if there is room for it. Producer thread only.
+         * @return false if the queue is full, value is then left untouched.
+         */
+        bool tryPush(T& value) {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+                return false;
+            }
+            m_slots[tail & m_mask] = std::move(value);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest value if any. Consumer thread only.
+         * @return false if the queue is empty.
+         */
+        bool tryPop(T& value) {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = std::move(m_slots[head & m_mask]);
+            m_slots[head & m_mask] = T();
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        void push(T value) {
+            for (unsigned int attempt = 0; !tryPush(value); ++attempt) {
+                backOff(attempt);
+            }
+        }
+
+        void pop(T& value) {
+            for (unsigned int attempt = 0; !tryPop(value); ++attempt) {
+                backOff(attempt);
+            }
+        }
+
+    private:
+        static void backOff(unsigned int attempt) {
+            if (attempt < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        std::vector<T>                  m_slots;
+        size_t                          m_mask;
+        // Written by the consumer and the producer respectively, kept on separate cache lines.
+        alignas(64) std::atomic<size_t> m_head;
+        alignas(64) std::atomic<size_t> m_tail;
+};
+
+#endif // RVMSPSCQUEUE_H
@@ -0,0 +1,400 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmtriangulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+RVMTriangulator::RVMTriangulator() {
+}
+
+bool RVMTriangulator::triangulate(const vector<Vector3F>& positions,
+                                  const unsigned long* indices,
+                                  const size_t* contourSizes,
+                                  size_t contourCount,
+                                  vector<unsigned long>& triangles) {
+    m_points.clear();
+    m_contours.clear();
+
+    // Contours without repeated vertices, and the normal of the polygon (Newell's method).
+    double normal[3] = { 0., 0., 0. };
+    for (size_t c = 0; c < contourCount; c++) {
+        const unsigned long* contour = indices;
+        indices += contourSizes[c];
+
+        Contour result;
+        result.begin = m_points.size();
+        for (size_t i = 0; i < contourSizes[c]; i++) {
+            if (m_points.size() == result.begin || m_points.back().index != contour[i]) {
+                Point point = { 0., 0., contour[i] };
+                m_points.push_back(point);
+            }
+        }
+        while (m_points.size() - result.begin > 1 && m_points.back().index == m_points[result.begin].index) {
+            m_points.pop_back();
+        }
+        if (m_points.size() - result.begin < 3) {
+            m_points.resize(result.begin);
+            continue;
+        }
+        result.end = m_points.size();
+        for (size_t i = result.begin; i < result.end; i++) {
+            const Vector3F& p = positions[m_points[i].index];
+            const Vector3F& q = positions[m_points[i + 1 == result.end ? result.begin : i + 1].index];
+            normal[0] += (double(p[1]) - q[1]) * (double(p[2]) + q[2]);
+            normal[1] += (double(p[2]) - q[2]) * (double(p[0]) + q[0]);
+            normal[2] += (double(p[0]) - q[0]) * (double(p[1]) + q[1]);
+        }
+        m_contours.push_back(result);
+    }
+
+    // Self-intersecting polygons can have no area, as a symmetric bow tie: their plane is then the one of the
+    // largest triangle fanned from the first vertex of a contour. Polygons flat in all directions are dropped.
+    if (normal[0] == 0. && normal[1] == 0. && normal[2] == 0.) {
+        double largest = 0.;
+        for (const Contour& contour : m_contours) {
+            const Vector3F& p = positions[m_points[contour.begin].index];
+            for (size_t i = contour.begin + 1; i + 1 < contour.end; i++) {
+                const Vector3F& q = positions[m_points[i].index];
+                const Vector3F& r = positions[m_points[i + 1].index];
+                const double cross[3] = {
+                    (double(q[1]) - p[1]) * (double(r[2]) - p[2]) - (double(q[2]) - p[2]) * (double(r[1]) - p[1]),
+                    (double(q[2]) - p[2]) * (double(r[0]) - p[0]) - (double(q[0]) - p[0]) * (double(r[2]) - p[2]),
+                    (double(q[0]) - p[0]) * (double(r[1]) - p[1]) - (double(q[1]) - p[1]) * (double(r[0]) - p[0])
+                };
+                for (int j = 0; j < 3; j++) {
+                    if (abs(cross[j]) > largest) {
+                        largest = abs(cross[j]);
+                        copy(cross, cross + 3, normal);
+                    }
+                }
+            }
+        }
+    }
+
+    // Projection on the main plane of the polygon, so that it is counter clockwise around its normal.
+    int axis = 0;
+    for (int i = 1; i < 3; i++) {
+        if (abs(normal[i]) > abs(normal[axis])) {
+            axis = i;
+        }
+    }
+    if (normal[axis] == 0.) {
+        return false;
+    }
+    const int u = normal[axis] > 0 ? (axis + 1) % 3 : (axis + 2) % 3;
+    const int v = normal[axis] > 0 ? (axis + 2) % 3 : (axis + 1) % 3;
+    for (Point& point : m_points) {
+        point.x = positions[point.index][u];
+        point.y = positions[point.index][v];
+    }
+    for (Contour& contour : m_contours) {
+        contour.area = 0.;
+        for (size_t i = contour.begin, j = contour.end - 1; i < contour.end; j = i++) {
+            contour.area += m_points[j].x * m_points[i].y - m_points[i].x * m_points[j].y;
+        }
+        contour.area *= 0.5;
+    }
+
+    if (m_contours.size() == 1) {
+        const Contour& contour = m_contours.front();
+        const size_t size = contour.end - contour.begin;
+        // Convex polygons (triangles, quads...) are fanned from their first vertex.
+        bool convex = contour.area != 0.;
+        for (size_t i = 0; i < size && convex; i++) {
+            const Point& a = m_points[contour.begin + i];
+            const Point& b = m_points[contour.begin + (i + 1) % size];
+            const Point& c = m_points[contour.begin + (i + 2) % size];
+            convex = ((b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x)) * contour.area >= 0.;
+        }
+        if (convex) {
+            for (size_t i = 1; i + 1 < size; i++) {
+                triangles.push_back(m_points[contour.begin].index);
+                triangles.push_back(m_points[contour.begin + i].index);
+                triangles.push_back(m_points[contour.begin + i + 1].index);
+            }
+            return true;
+        }
+    }
+
+    // Odd winding rule: contours inside an odd number of others are holes of the closest one.
+    for (size_t c = 0; c < m_contours.size(); c++) {
+        Contour& contour = m_contours[c];
+        const Point& point = m_points[contour.begin];
+        contour.depth = 0;
+        contour.parent = -1;
+        for (size_t d = 0; d < m_contours.size(); d++) {
+            if (d != c && contains(m_contours[d], point.x, point.y)) {
+                contour.depth++;
+            }
+        }
+    }
+    for (size_t c = 0; c < m_contours.size(); c++) {
+        Contour& contour = m_contours[c];
+        if (contour.depth % 2 == 0) {
+            continue;
+        }
+        const Point& point = m_points[contour.begin];
+        for (size_t d = 0; d < m_contours.size(); d++) {
+            const Contour& other = m_contours[d];
+            if (d != c && other.depth == contour.depth - 1 && contains(other, point.x, point.y)
+                    && (contour.parent < 0 || abs(other.area) < abs(m_contours[contour.parent].area))) {
+                contour.parent = int(d);
+            }
+        }
+    }
+
+    bool filled = false;
+    for (size_t c = 0; c < m_contours.size(); c++) {
+        if (m_contours[c].depth % 2 != 0 || (m_contours[c].area == 0. && isFlat(m_contours[c]))) {
+            continue;
+        }
+        m_nodes.clear();
+        const int outer = linkContour(m_contours[c], true);
+
+        // Holes are bridged to the outer contour from left to right.
+        m_holes.clear();
+        for (const Contour& hole : m_contours) {
+            if (hole.parent == int(c)) {
+                m_holes.push_back(leftmost(linkContour(hole, false)));
+            }
+        }
+        sort(m_holes.begin(), m_holes.end(), [this](int a, int b) {
+            return m_nodes[a].x < m_nodes[b].x || (m_nodes[a].x == m_nodes[b].x && m_nodes[a].y < m_nodes[b].y);
+        });
+        for (int hole : m_holes) {
+            const int bridge = findHoleBridge(hole, outer);
+            if (bridge >= 0) {
+                split(bridge, hole);
+            }
+        }
+
+        clipEars(outer, triangles);
+        filled = true;
+    }
+    return filled;
+}
+
+double RVMTriangulator::area(const Node& p, const Node& q, const Node& r) {
+    // Negative for a counter clockwise turn.
+    return (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+}
+
+bool RVMTriangulator::pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py) {
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py)
+        && (ax - px) * (by - py) >= (bx - px) * (ay - py)
+        && (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+bool RVMTriangulator::contains(const Contour& contour, double x, double y) const {
+    bool inside = false;
+    for (size_t i = contour.begin, j = contour.end - 1; i < contour.end; j = i++) {
+        const Point& a = m_points[i];
+        const Point& b = m_points[j];
+        if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+bool RVMTriangulator::isFlat(const Contour& contour) const {
+    const Point& a = m_points[contour.begin];
+    for (size_t i = contour.begin + 1; i + 1 < contour.end; i++) {
+        const Point& b = m_points[i];
+        const Point& c = m_points[i + 1];
+        if ((b.x - a.x) * (c.y - a.y) != (b.y - a.y) * (c.x - a.x)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int RVMTriangulator::linkContour(const Contour& contour, bool counterClockwise) {
+    const size_t first = m_nodes.size();
+    const size_t size = contour.end - contour.begin;
+    const bool reverse = (contour.area > 0.) != counterClockwise;
+    for (size_t i = 0; i < size; i++) {
+        const Point& point = m_points[reverse ? contour.end - 1 - i : contour.begin + i];
+        Node node = { point.x, point.y, point.index, int(first + (i + size - 1) % size), int(first + (i + 1) % size) };
+        m_nodes.push_back(node);
+    }
+    return int(first);
+}
+
+int RVMTriangulator::leftmost(int start) const {
+    int result = start;
+    int p = start;
+    do {
+        if (m_nodes[p].x < m_nodes[result].x || (m_nodes[p].x == m_nodes[result].x && m_nodes[p].y < m_nodes[result].y)) {
+            result = p;
+        }
+        p = m_nodes[p].next;
+    } while (p != start);
+    return result;
+}
+
+int RVMTriangulator::split(int a, int b) {
+    // Links a to b with two edges, going through copies of a and b on the way back.
+    const int a2 = int(m_nodes.size());
+    const int b2 = a2 + 1;
+    m_nodes.push_back(m_nodes[a]);
+    m_nodes.push_back(m_nodes[b]);
+    const int an = m_nodes[a].next;
+    const int bp = m_nodes[b].prev;
+
+    m_nodes[a].next = b;
+    m_nodes[b].prev = a;
+    m_nodes[a2].next = an;
+    m_nodes[an].prev = a2;
+    m_nodes[b2].next = a2;
+    m_nodes[a2].prev = b2;
+    m_nodes[bp].next = b2;
+    m_nodes[b2].prev = bp;
+    return b2;
+}
+
+int RVMTriangulator::findHoleBridge(int hole, int outer) const {
+    // Segment of the outer contour left of the hole, on a horizontal ray from its leftmost point.
+    const double hx = m_nodes[hole].x;
+    const double hy = m_nodes[hole].y;
+    double qx = -numeric_limits<double>::infinity();
+    int m = -1;
+    int p = outer;
+    do {
+        const Node& a = m_nodes[p];
+        const Node& b = m_nodes[a.next];
+        if (hy <= a.y && hy >= b.y && b.y != a.y) {
+            const double x = a.x + (hy - a.y) * (b.x - a.x) / (b.y - a.y);
+            if (x <= hx && x > qx) {
+                qx = x;
+                if (x == hx) {
+                    if (hy == a.y) {
+                        return p;
+                    }
+                    if (hy == b.y) {
+                        return a.next;
+                    }
+                }
+                m = a.x < b.x ? p : a.next;
+            }
+        }
+        p = a.next;
+    } while (p != outer);
+
+    if (m < 0) {
+        return -1;
+    }
+    if (hx == qx) {
+        return m;
+    }
+
+    // The end of the segment may be hidden by other vertices: take the one with the smallest angle to the ray.
+    const int stop = m;
+    const double mx = m_nodes[m].x;
+    const double my = m_nodes[m].y;
+    double tanMin = numeric_limits<double>::infinity();
+    p = m;
+    do {
+        const Node& node = m_nodes[p];
+        if (hx >= node.x && node.x >= mx && hx != node.x
+                && pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, node.x, node.y)) {
+            const double tan = abs(hy - node.y) / (hx - node.x);
+            const Node& best = m_nodes[m];
+            const bool sectorContainsSector = area(m_nodes[best.prev], best, m_nodes[node.prev]) < 0
+                                           && area(m_nodes[node.next], best, m_nodes[best.next]) < 0;
+            if (locallyInside(p, hole)
+                    && (tan < tanMin || (tan == tanMin && (node.x > best.x || (node.x == best.x && sectorContainsSector))))) {
+                m = p;
+                tanMin = tan;
+            }
+        }
+        p = node.next;
+    } while (p != stop);
+    return m;
+}
+
+bool RVMTriangulator::locallyInside(int a, int b) const {
+    const Node& na = m_nodes[a];
+    const Node& nb = m_nodes[b];
+    const Node& prev = m_nodes[na.prev];
+    const Node& next = m_nodes[na.next];
+    return area(prev, na, next) < 0
+        ? area(na, nb, next) >= 0 && area(na, prev, nb) >= 0
+        : area(na, nb, prev) < 0 || area(na, next, nb) < 0;
+}
+
+bool RVMTriangulator::isEar(int ear) const {
+    const Node& a = m_nodes[m_nodes[ear].prev];
+    const Node& b = m_nodes[ear];
+    const Node& c = m_nodes[b.next];
+    if (area(a, b, c) >= 0) {
+        // Reflex or flat
+        return false;
+    }
+    // No reflex vertex of the contour can be inside the ear.
+    for (int p = c.next; p != b.prev; p = m_nodes[p].next) {
+        const Node& node = m_nodes[p];
+        if ((node.x == a.x && node.y == a.y) || (node.x == b.x && node.y == b.y) || (node.x == c.x && node.y == c.y)) {
+            continue;
+        }
+        if (pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, node.x, node.y)
+                && area(m_nodes[node.prev], node, m_nodes[node.next]) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RVMTriangulator::clipEars(int ear, vector<unsigned long>& triangles) {
+    // When no ear is left (self-intersections, flat parts), convex or flat vertices are clipped anyway, then any vertex.
+    int stop = ear;
+    int pass = 0;
+    while (m_nodes[ear].prev != m_nodes[ear].next) {
+        const int prev = m_nodes[ear].prev;
+        const int next = m_nodes[ear].next;
+        const bool clip = pass == 0 ? isEar(ear)
+                        : pass == 1 ? area(m_nodes[prev], m_nodes[ear], m_nodes[next]) <= 0
+                        : true;
+        if (clip) {
+            triangles.push_back(m_nodes[prev].index);
+            triangles.push_back(m_nodes[ear].index);
+            triangles.push_back(m_nodes[next].index);
+
+            m_nodes[prev].next = next;
+            m_nodes[next].prev = prev;
+            // Skipping the next vertex gives less thin triangles.
+            ear = m_nodes[next].next;
+            stop = ear;
+            pass = 0;
+            continue;
+        }
+        ear = next;
+        if (ear == stop) {
+            pass++;
+        }
+    }
+}
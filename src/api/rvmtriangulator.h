@@ -0,0 +1,111 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMTRIANGULATOR_H
+#define RVMTRIANGULATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "vector3f.h"
+
+/**
+ * @brief Triangulates the planar polygons of facet groups.
+ *
+ * A polygon is made of one or more contours, filled with the odd winding rule: contours inside
+ * another one are holes, contours inside a hole are filled again, as with the GLU tesselator.
+ * Triangles, quads and other convex polygons are fanned directly. Other polygons have their holes
+ * bridged to the enclosing contour and are ear clipped. Self-intersecting or degenerated polygons
+ * still give a triangle for each vertex in excess of two, so that no surface gets lost.
+ *
+ * Triangles keep the orientation of the outer contours. No vertex is ever added.
+ *
+ * The triangulator has no global state: each thread can use its own. Keeping one instance for
+ * several polygons reuses its buffers.
+ */
+class RVMTriangulator
+{
+    public:
+        RVMTriangulator();
+
+        /**
+         * @brief Triangulates a polygon.
+         * @param positions the vertices of the polygon, and any other vertex.
+         * @param indices the indices of the vertices of each contour, in positions, one contour after the other.
+         * @param contourSizes the number of vertices of each contour.
+         * @param contourCount the number of contours.
+         * @param triangles receives three indices in positions for each triangle.
+         * @return false if the polygon is degenerated (all its vertices on a line): no triangle is added then.
+         */
+        bool triangulate(const std::vector<Vector3F>& positions,
+                         const unsigned long* indices,
+                         const size_t* contourSizes,
+                         size_t contourCount,
+                         std::vector<unsigned long>& triangles);
+
+    private:
+        struct Node
+        {
+            double          x;
+            double          y;
+            unsigned long   index;
+            int             prev;
+            int             next;
+        };
+
+        struct Contour
+        {
+            /// In m_points.
+            size_t          begin;
+            size_t          end;
+            double          area;
+            int             depth;
+            int             parent;
+        };
+
+        struct Point
+        {
+            double          x;
+            double          y;
+            unsigned long   index;
+        };
+
+        static double area(const Node& p, const Node& q, const Node& r);
+        static bool pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py);
+        bool contains(const Contour& contour, double x, double y) const;
+        bool isFlat(const Contour& contour) const;
+
+        int linkContour(const Contour& contour, bool counterClockwise);
+        int leftmost(int start) const;
+        int split(int a, int b);
+        int findHoleBridge(int hole, int outer) const;
+        bool locallyInside(int a, int b) const;
+        bool isEar(int ear) const;
+        void clipEars(int ear, std::vector<unsigned long>& triangles);
+
+        std::vector<Point>      m_points;
+        std::vector<Contour>    m_contours;
+        std::vector<Node>       m_nodes;
+        std::vector<int>        m_holes;
+};
+
+#endif // RVMTRIANGULATOR_H
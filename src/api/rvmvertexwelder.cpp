@@ -0,0 +1,111 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#include "rvmvertexwelder.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+    /// Same precision as Vector3F::operator==.
+    const float DEFAULT_SQUARED_TOLERANCE = 1.0E-10f;
+    const float DEFAULT_TOLERANCE = 1.0E-5f;
+}
+
+RVMVertexWelder::RVMVertexWelder(float tolerance) :
+    m_tolerance(tolerance > 0.f ? tolerance : DEFAULT_TOLERANCE),
+    m_squaredTolerance(tolerance > 0.f ? tolerance * tolerance : DEFAULT_SQUARED_TOLERANCE),
+    m_cellSize(tolerance > 0.f ? tolerance : DEFAULT_TOLERANCE) {
+}
+
+void RVMVertexWelder::setTolerance(float tolerance) {
+    m_tolerance = tolerance > 0.f ? tolerance : DEFAULT_TOLERANCE;
+    m_squaredTolerance = tolerance > 0.f ? tolerance * tolerance : DEFAULT_SQUARED_TOLERANCE;
+    m_cellSize = m_tolerance;
+}
+
+void RVMVertexWelder::clear(size_t expectedVertices) {
+    m_positions.clear();
+    m_normals.clear();
+    m_next.clear();
+    m_cells.clear();
+    m_positions.reserve(expectedVertices);
+    m_normals.reserve(expectedVertices);
+    m_next.reserve(expectedVertices);
+    m_cells.reserve(expectedVertices);
+}
+
+int64_t RVMVertexWelder::cell(double value) const {
+    const double c = floor(value / m_cellSize);
+    // Out of range and NaN coordinates all go to the same cell.
+    return c > -9.0e18 && c < 9.0e18 ? int64_t(c) : 0;
+}
+
+uint64_t RVMVertexWelder::cellKey(int64_t x, int64_t y, int64_t z) {
+    uint64_t key = uint64_t(x) * 0x9E3779B97F4A7C15ull;
+    key ^= uint64_t(y) * 0xC2B2AE3D27D4EB4Full + (key << 6) + (key >> 2);
+    key ^= uint64_t(z) * 0x165667B19E3779F9ull + (key << 6) + (key >> 2);
+    return key;
+}
+
+pair<unsigned long, bool> RVMVertexWelder::insert(const Vector3F& position, const Vector3F& normal) {
+    // Cells within the tolerance of the position: one or two along each axis.
+    // The margin covers the rounding of the distance in single precision.
+    const double reach = 1.001 * m_tolerance;
+    int64_t low[3], high[3];
+    for (int i = 0; i < 3; i++) {
+        low[i] = cell(position[i] - reach);
+        high[i] = cell(position[i] + reach);
+    }
+
+    int64_t match = -1;
+    for (int64_t x = low[0]; x <= high[0]; x++) {
+        for (int64_t y = low[1]; y <= high[1]; y++) {
+            for (int64_t z = low[2]; z <= high[2]; z++) {
+                auto found = m_cells.find(cellKey(x, y, z));
+                if (found == m_cells.end()) {
+                    continue;
+                }
+                for (int64_t i = found->second; i >= 0; i = m_next[size_t(i)]) {
+                    if ((match < 0 || i < match)
+                            && (m_positions[size_t(i)] - position).squaredNorm() < m_squaredTolerance
+                            && m_normals[size_t(i)] == normal) {
+                        match = i;
+                    }
+                }
+            }
+        }
+    }
+    if (match >= 0) {
+        return make_pair((unsigned long)match, false);
+    }
+
+    const int64_t index = int64_t(m_positions.size());
+    m_positions.push_back(position);
+    m_normals.push_back(normal);
+    auto inserted = m_cells.insert(make_pair(cellKey(cell(position[0]), cell(position[1]), cell(position[2])), index));
+    m_next.push_back(inserted.second ? -1 : inserted.first->second);
+    inserted.first->second = index;
+    return make_pair((unsigned long)index, true);
+}
@@ -0,0 +1,90 @@
+/*
+ * Plant Mock-Up Converter
+ *
+ * Copyright (c) 2019, EDF. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301  USA
+ */
+
+
+#ifndef RVMVERTEXWELDER_H
+#define RVMVERTEXWELDER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vector3f.h"
+
+/**
+ * @brief Gives the same index to the vertices of a facet group that are at the same place with the same normal.
+ *
+ * Vertices are hashed on a grid whose cells are as large as the tolerance, so that only the vertices
+ * of the neighbouring cells are compared, instead of all the previous vertices.
+ * When several previous vertices match, the first one wins.
+ *
+ * Without tolerance, vertices are welded as by Vector3F::operator==, for both the position and the normal.
+ * With a tolerance, positions closer than it are welded as well, as long as normals are equal.
+ *
+ * A welder can be cleared and reused for the next facet group without reallocating.
+ */
+class RVMVertexWelder
+{
+    public:
+        /**
+         * @param tolerance maximum distance between welded positions, 0 for the precision of Vector3F::operator==.
+         */
+        explicit RVMVertexWelder(float tolerance = 0.f);
+
+        /**
+         * @brief Changes the tolerance. The welder must be cleared before inserting more vertices.
+         * @param tolerance maximum distance between welded positions, 0 for the precision of Vector3F::operator==.
+         */
+        void setTolerance(float tolerance);
+
+        /**
+         * @brief Forgets all the vertices, and prepares for the given number of them.
+         */
+        void clear(size_t expectedVertices = 0);
+
+        /**
+         * @brief Finds a previous vertex matching a vertex, or adds the vertex.
+         * @return the index of the matching vertex, or of the added vertex, and true if it was added.
+         */
+        std::pair<unsigned long, bool> insert(const Vector3F& position, const Vector3F& normal);
+
+        /// The distinct vertices, in the order they were added.
+        const std::vector<Vector3F>& positions() const { return m_positions; }
+        const std::vector<Vector3F>& normals() const { return m_normals; }
+
+    private:
+        int64_t cell(double value) const;
+        static uint64_t cellKey(int64_t x, int64_t y, int64_t z);
+
+        float                           m_tolerance;
+        float                           m_squaredTolerance;
+        float                           m_cellSize;
+
+        std::vector<Vector3F>           m_positions;
+        std::vector<Vector3F>           m_normals;
+        /// Next vertex in the same cell, or -1.
+        std::vector<int64_t>            m_next;
+        /// First vertex of each cell.
+        std::unordered_map<uint64_t, int64_t> m_cells;
+};
+
+#endif // RVMVERTEXWELDER_H
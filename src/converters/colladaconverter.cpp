@@ -34,6 +34,7 @@
 #include <string>
 
 #include "../api/rvmcolorhelper.h"
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 #include "../common/stringutils.h"
 
@@ -98,6 +99,7 @@ enum keys {
   h,
   polygons,
   unit,
+  instance_node,
 };
 };
 
@@ -156,7 +158,8 @@ static String colladaKey[] = {"node",
                               "ph",
                               "h",
                               "polygons",
-                              "unit"};
+                              "unit",
+                              "instance_node"};
 
 class CCGroup {
  public:
@@ -171,6 +174,10 @@ class CCGroup {
     return m_groups.back();
   }
   void addMetaData(const string& key, const string& value) { m_metaData.push_back(pair<string, string>(key, value)); }
+  void addInstance(const string& node, const std::array<float, 12>& matrix) {
+    m_instances.push_back(pair<string, std::array<float, 12>>(node, matrix));
+  }
+  void setId(const string& id) { m_id = id; }
 
   std::string getNCName(std::string& name) {
     name.erase(remove_if(name.begin(), name.end(), [](char x) { return !isalnum(x) && !isspace(x); }), name.end());
@@ -182,6 +189,9 @@ class CCGroup {
     Node node(writer);
     node.setType(Node::NODE);
     node.setNodeName(getNCName(m_name));
+    if (!m_id.empty()) {
+      node.setNodeId(m_id);
+    }
     node.start();
 
     if (!m_metaData.empty()) {
@@ -198,16 +208,7 @@ class CCGroup {
 
     for (unsigned int i = 0; i < m_geometries.size(); i++) {
       writer->openElement(colladaKey[colladaKeys::node]);
-      writer->openElement(colladaKey[colladaKeys::matrix]);
-      vector<float> m(16, 0.f);
-      for (unsigned int j = 0; j < 4; j++) {
-        for (unsigned int k = 0; k < 3; k++) {
-          m[j + k * 4] = m_geometries[i].second[j * 3 + k];
-        }
-      }
-      m[15] = 1.f;
-      writer->appendValues(m);
-      writer->closeElement();  // matrix
+      writeMatrix(writer, m_geometries[i].second);
       writer->openElement(colladaKey[colladaKeys::instance_geometry]);
       writer->appendAttribute(colladaKey[colladaKeys::url], "#" + m_geometries[i].first);
       writer->openElement(colladaKey[colladaKeys::bind_material]);
@@ -226,6 +227,14 @@ class CCGroup {
       writer->closeElement();  // instance_geometry
       writer->closeElement();  // node
     }
+    for (unsigned int i = 0; i < m_instances.size(); i++) {
+      writer->openElement(colladaKey[colladaKeys::node]);
+      writeMatrix(writer, m_instances[i].second);
+      writer->openElement(colladaKey[colladaKeys::instance_node]);
+      writer->appendAttribute(colladaKey[colladaKeys::url], "#" + m_instances[i].first);
+      writer->closeElement();  // instance_node
+      writer->closeElement();  // node
+    }
     for (unsigned int i = 0; i < m_groups.size(); i++) {
       m_groups[i].writeGroup(writer);
     }
@@ -233,10 +242,25 @@ class CCGroup {
   }
 
  private:
+  static void writeMatrix(COLLADASW::StreamWriter* writer, const std::array<float, 12>& matrix) {
+    writer->openElement(colladaKey[colladaKeys::matrix]);
+    vector<float> m(16, 0.f);
+    for (unsigned int j = 0; j < 4; j++) {
+      for (unsigned int k = 0; k < 3; k++) {
+        m[j + k * 4] = matrix[j * 3 + k];
+      }
+    }
+    m[15] = 1.f;
+    writer->appendValues(m);
+    writer->closeElement();  // matrix
+  }
+
   string m_name;
+  string m_id;
   Vector3F m_translation;
   int m_material;
   vector<pair<string, std::array<float, 12>>> m_geometries;
+  vector<pair<string, std::array<float, 12>>> m_instances;
   vector<CCGroup> m_groups;
   vector<pair<string, string>> m_metaData;
 };
@@ -379,189 +403,179 @@ void COLLADAConverter::endGroup() {
   m_translations.pop_back();
 }
 
+bool COLLADAConverter::supportsInstances() const {
+  return true;
+}
+
+void COLLADAConverter::definePrototype(uint32_t prototype) {
+  m_model->groupStack().back()->setId("P" + toString((long long)prototype));
+  // The prototype node is placed relative to its parent group.
+  m_prototypeOrigins[prototype] = m_translations[m_translations.size() - 2];
+}
+
+void COLLADAConverter::startGroupInstance(const std::string& name,
+                                          const Vector3F& translation,
+                                          const int& materialId,
+                                          uint32_t prototype,
+                                          const std::array<float, 12>& matrix) {
+  startGroup(name, translation, materialId);
+  // From the group origin to the origin of the parent of the prototype, then to the instance.
+  const Vector3F& origin = m_prototypeOrigins[prototype];
+  std::array<float, 12> m = matrix;
+  for (int i = 0; i < 3; i++) {
+    m[9 + i] += m[i] * origin[0] + m[i + 3] * origin[1] + m[i + 6] * origin[2] - translation[i];
+  }
+  m_model->groupStack().back()->addInstance("P" + toString((long long)prototype), m);
+}
+
 void COLLADAConverter::startMetaData() {}
 
 void COLLADAConverter::endMetaData() {}
 
-void COLLADAConverter::startMetaDataPair(const string& name, const string& value) {
-  m_model->groupStack().back()->addMetaData(name, value);
+void COLLADAConverter::startMetaDataPair(string_view name, string_view value) {
+  m_model->groupStack().back()->addMetaData(string(name), string(value));
 }
 
 void COLLADAConverter::endMetaDataPair() {}
 
 void COLLADAConverter::createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& pyramid) {
-  std::vector<float> params;
-  params.push_back(Pyramid);
-  params.push_back(pyramid.xbottom());
-  params.push_back(pyramid.ybottom());
-  params.push_back(pyramid.xtop());
-  params.push_back(pyramid.ytop());
-  params.push_back(pyramid.height());
-  params.push_back(pyramid.xoffset());
-  params.push_back(pyramid.yoffset());
-
-  string gid = getInstanceName(params);
+  if (addUnitGeometry(Pyramid, pyramid.data, matrix, "RVMPyramid")) {
+    return;
+  }
+  const RVMMeshCache::Key key = m_meshCache->key(Pyramid, pyramid, m_maxSideSize, m_minSides);
+
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid, RVMMeshHelper2::makePyramid(pyramid, m_maxSideSize, m_minSides), "RVMPyramid");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makePyramid(pyramid, m_maxSideSize, m_minSides), "RVMPyramid");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createBox(const std::array<float, 12>& matrix, const Primitives::Box& box) {
-  std::vector<float> params;
-  params.push_back(Box);
-  params.push_back(box.len[0]);
-  params.push_back(box.len[1]);
-  params.push_back(box.len[2]);
+  if (addUnitGeometry(Box, box.len, matrix, "RVMBox")) {
+    return;
+  }
+  const RVMMeshCache::Key key = m_meshCache->key(Box, box, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid, RVMMeshHelper2::makeBox(box, m_maxSideSize, m_minSides), "RVMBox");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeBox(box, m_maxSideSize, m_minSides), "RVMBox");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createRectangularTorus(const std::array<float, 12>& matrix,
                                               const Primitives::RectangularTorus& torus) {
-  std::vector<float> params;
-  params.push_back(RectangularTorus);
-  params.push_back(torus.rinside());
-  params.push_back(torus.routside());
-  params.push_back(torus.height());
-  params.push_back(torus.angle());
-
-  string gid = getInstanceName(params);
+  const RVMMeshCache::Key key = m_meshCache->key(RectangularTorus, torus, m_maxSideSize, m_minSides);
+
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid, RVMMeshHelper2::makeRectangularTorus(torus, m_maxSideSize, m_minSides), "RVMRectangularTorus");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeRectangularTorus(torus, m_maxSideSize, m_minSides), "RVMRectangularTorus");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createCircularTorus(const std::array<float, 12>& matrix,
                                            const Primitives::CircularTorus& torus) {
-  std::vector<float> params;
-  params.push_back(CircularTorus);
-  params.push_back(torus.offset());
-  params.push_back(torus.radius());
-  params.push_back(torus.angle());
+  const RVMMeshCache::Key key = m_meshCache->key(CircularTorus, torus, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    auto sides = RVMMeshHelper2::infoCircularTorusNumSides(torus, m_maxSideSize, m_minSides);
-    writeMesh(gid, RVMMeshHelper2::makeCircularTorus(torus, sides.first, sides.second), "RVMCircularTorus");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeCircularTorus(torus, m_maxSideSize, m_minSides), "RVMCircularTorus");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createEllipticalDish(const std::array<float, 12>& matrix,
                                             const Primitives::EllipticalDish& dish) {
-  std::vector<float> params;
-  params.push_back(EllipticalDish);
-  params.push_back(dish.diameter());
-  params.push_back(dish.radius());
+  const RVMMeshCache::Key key = m_meshCache->key(EllipticalDish, dish, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    auto sideInfo = RVMMeshHelper2::infoEllipticalDishNumSides(dish, m_maxSideSize, m_minSides);
-    writeMesh(gid, RVMMeshHelper2::makeEllipticalDish(dish, sideInfo.first, sideInfo.second), "RVMEllipticalDish");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeEllipticalDish(dish, m_maxSideSize, m_minSides), "RVMEllipticalDish");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& dish) {
-  std::vector<float> params;
-  params.push_back(SphericalDish);
-  params.push_back(dish.diameter());
-  params.push_back(dish.height());
+  const RVMMeshCache::Key key = m_meshCache->key(SphericalDish, dish, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid, RVMMeshHelper2::makeSphericalDish(dish, m_maxSideSize, m_minSides), "RVMSphericalDish");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeSphericalDish(dish, m_maxSideSize, m_minSides), "RVMSphericalDish");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& snout) {
-  std::vector<float> params;
-  params.push_back(Snout);
-  params.push_back(snout.dtop());
-  params.push_back(snout.dbottom());
-  params.push_back(snout.height());
-  params.push_back(snout.xoffset());
-  params.push_back(snout.yoffset());
-  params.push_back(snout.xbshear());
-  params.push_back(snout.ybshear());
-  params.push_back(snout.xtshear());
-  params.push_back(snout.ytshear());
-
-  string gid = getInstanceName(params);
+  if (addUnitGeometry(Snout, snout.data, matrix, "RVMSnout")) {
+    return;
+  }
+  const RVMMeshCache::Key key = m_meshCache->key(Snout, snout, m_maxSideSize, m_minSides);
+
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid,
-              RVMMeshHelper2::makeSnout(snout, RVMMeshHelper2::infoSnoutNumSides(snout, m_maxSideSize, m_minSides)),
-              "RVMSnout");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeSnout(snout, m_maxSideSize, m_minSides), "RVMSnout");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& cylinder) {
-  std::vector<float> params;
-  params.push_back(Cylinder);
-  params.push_back(cylinder.radius());
-  params.push_back(cylinder.height());
+  if (addUnitGeometry(Cylinder, cylinder.data, matrix, "RVMCylinder")) {
+    return;
+  }
+  const RVMMeshCache::Key key = m_meshCache->key(Cylinder, cylinder, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid,
-              RVMMeshHelper2::makeCylinder(cylinder,
-                                           RVMMeshHelper2::infoCylinderNumSides(cylinder, m_maxSideSize, m_minSides)),
-              "RVMCylinder");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeCylinder(cylinder, m_maxSideSize, m_minSides), "RVMCylinder");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& sphere) {
-  std::vector<float> params;
-  params.push_back(Sphere);
-  params.push_back(sphere.diameter);
+  if (addUnitGeometry(Sphere, &sphere.diameter, matrix, "RVMSphere")) {
+    return;
+  }
+  const RVMMeshCache::Key key = m_meshCache->key(Sphere, sphere, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (gid.empty()) {
     gid = createGeometryId();
-    writeMesh(gid, RVMMeshHelper2::makeSphere(sphere, m_maxSideSize, m_minSides), "RVMSphere");
-    m_instanceMap.insert(std::make_pair(params, gid));
+    writeMesh(gid, *m_meshCache->makeSphere(sphere, m_maxSideSize, m_minSides), "RVMSphere");
+    m_instanceMap.insert(std::make_pair(key, gid));
   }
   addGeometry(gid, matrix);
 }
 
 void COLLADAConverter::createLine(const std::array<float, 12>& matrix, const float& thickness, const float& length) {
-  std::vector<float> params;
-  params.push_back(Line);
-  params.push_back(length);  // thickness not taken into account yet
+  // thickness not taken into account yet
+  const RVMMeshCache::Key key = m_meshCache->key(Line, &length, 1, m_maxSideSize, m_minSides);
 
-  string gid = getInstanceName(params);
+  string gid = getInstanceName(key);
   if (!gid.empty()) {
     m_model->groupStack().back()->addGeometry(gid, matrix);
     return;
   }
   m_writer->appendTextBlock("<!-- RVMLine -->");
   gid = createGeometryId();
-  m_instanceMap.insert(std::make_pair(params, gid));
+  m_instanceMap.insert(std::make_pair(key, gid));
 
   m_writer->openElement(colladaKey[colladaKeys::geometry]);
   m_writer->appendAttribute(colladaKey[colladaKeys::id], gid);
@@ -608,14 +622,12 @@ void COLLADAConverter::createLine(const std::array<float, 12>& matrix, const flo
   m_model->groupStack().back()->addGeometry(gid, matrix);
 }
 
-void COLLADAConverter::createFacetGroup(const std::array<float, 12>& matrix,
-                                        const vector<vector<vector<Vertex>>>& vertexes) {
-  Mesh meshData;
+void COLLADAConverter::createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
   string gid = createGeometryId();
 
-  RVMMeshHelper2::tesselateFacetGroup(vertexes, &meshData);
+  RVMMeshHelper2::tesselateFacetGroup(facetGroup, &m_facetGroupMesh, m_weldTolerance, m_welder, m_triangulator);
 
-  writeMesh(gid, meshData, "RVMFacetGroup");
+  writeMesh(gid, m_facetGroupMesh, "RVMFacetGroup");
   addGeometry(gid, matrix);
 }
 
@@ -623,8 +635,8 @@ std::string COLLADAConverter::createGeometryId() {
   return "G" + toString((long long)m_model->geometryId()++);
 }
 
-std::string COLLADAConverter::getInstanceName(const std::vector<float>& params) {
-  InstanceMap::iterator I = m_instanceMap.find(params);
+std::string COLLADAConverter::getInstanceName(const RVMMeshCache::Key& key) {
+  InstanceMap::iterator I = m_instanceMap.find(key);
   if (I != m_instanceMap.end()) {
     // cout << "Found instance: " << params << " " <<  gid <<endl;
     return (*I).second;
@@ -640,6 +652,23 @@ void COLLADAConverter::addGeometry(const std::string& name, const std::array<flo
   m_model->groupStack().back()->addGeometry(name, m);
 }
 
+bool COLLADAConverter::addUnitGeometry(int type, const float* params, const std::array<float, 12>& matrix,
+                                       const std::string& comment) {
+  RVMMeshCache::UnitPrimitive unit;
+  if (!m_unitMeshes || !m_meshCache->unitPrimitive(type, params, m_maxSideSize, m_minSides, unit)) {
+    return false;
+  }
+  // One geometry per shape and number of sides, the size of the primitive goes to the node matrix.
+  string gid = getInstanceName(unit.key);
+  if (gid.empty()) {
+    gid = createGeometryId();
+    writeMesh(gid, *m_meshCache->makeUnit(unit), comment);
+    m_instanceMap.insert(std::make_pair(unit.key, gid));
+  }
+  addGeometry(gid, unit.transform(matrix));
+  return true;
+}
+
 void COLLADAConverter::writeMesh(const std::string& gid, const Mesh& mesh, const std::string comment) {
   bool hasNormals = mesh.normals.size() > 0;
   bool hasNormalIndex = mesh.normalIndex.size() > 0;
@@ -655,26 +684,26 @@ void COLLADAConverter::writeMesh(const std::string& gid, const Mesh& mesh, const
   FloatSourceF positionSource(m_writer);
   positionSource.setId(gid + "C");
   positionSource.setArrayId(gid + "CA");
-  positionSource.setAccessorCount(static_cast<unsigned long>(mesh.positions.size()));
+  positionSource.setAccessorCount(static_cast<unsigned long>(mesh.positionCount()));
   positionSource.setAccessorStride(3);
   positionSource.getParameterNameList().push_back("X");
   positionSource.getParameterNameList().push_back("Y");
   positionSource.getParameterNameList().push_back("Z");
   positionSource.prepareToAppendValues();
-  m_writer->appendValues(&mesh.positions.front()[0], mesh.positions.size() * 3);
+  m_writer->appendValues(mesh.positions.data(), mesh.positions.size());
   positionSource.finish();
 
   if (hasNormals) {
     FloatSourceF normalSource(m_writer);
     normalSource.setId(gid + "N");
     normalSource.setArrayId(gid + "NA");
-    normalSource.setAccessorCount(static_cast<unsigned long>(mesh.normals.size()));
+    normalSource.setAccessorCount(static_cast<unsigned long>(mesh.normalCount()));
     normalSource.setAccessorStride(3);
     normalSource.getParameterNameList().push_back("X");
     normalSource.getParameterNameList().push_back("Y");
     normalSource.getParameterNameList().push_back("Z");
     normalSource.prepareToAppendValues();
-    m_writer->appendValues(&mesh.normals.front()[0], mesh.normals.size() * 3);
+    m_writer->appendValues(mesh.normals.data(), mesh.normals.size());
     normalSource.finish();
   }
 
@@ -693,18 +722,19 @@ void COLLADAConverter::writeMesh(const std::string& gid, const Mesh& mesh, const
   t.prepareToAppendValues();
   if (hasNormalIndex) {
     for (size_t i = 0; i < mesh.positionIndex.size(); i++) {
-      t.appendValues(mesh.positionIndex.at(i));
-      t.appendValues(mesh.normalIndex.at(i));
+      t.appendValues(static_cast<unsigned long>(mesh.positionIndex[i]));
+      t.appendValues(static_cast<unsigned long>(mesh.normalIndex[i]));
     }
   } else {
     // We could use a single index, but some viewers (e.g. MeshLab) don't support it
     if (hasNormals) {
-      for (auto index : mesh.positionIndex) {
+      for (size_t i = 0; i < mesh.positionIndex.size(); i++) {
+        const unsigned long index = mesh.positionIndex[i];
         t.appendValues(index, index);
       }
     } else {
-      for (auto index : mesh.positionIndex) {
-        t.appendValues(index);
+      for (size_t i = 0; i < mesh.positionIndex.size(); i++) {
+        t.appendValues(static_cast<unsigned long>(mesh.positionIndex[i]));
       }
     }
   }
@@ -25,11 +25,14 @@
 #include <COLLADASWStreamWriter.h>
 
 #include "../api/rvmreader.h"
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 
+#include <unordered_map>
+
 class CCModel;
 
-typedef std::map<std::vector<float>, std::string> InstanceMap;
+typedef std::unordered_map<RVMMeshCache::Key, std::string, RVMMeshCache::KeyHash> InstanceMap;
 
 class COLLADAConverter : public RVMReader
 {
@@ -52,7 +55,7 @@ class COLLADAConverter : public RVMReader
         virtual void startMetaData();
         virtual void endMetaData();
 
-        virtual void startMetaDataPair(const std::string& name, const std::string& value);
+        virtual void startMetaDataPair(std::string_view name, std::string_view value);
         virtual void endMetaDataPair();
 
         virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
@@ -75,20 +78,31 @@ class COLLADAConverter : public RVMReader
 
         virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
 
-        virtual void createFacetGroup(const std::array<float, 12>& matrix,
-                                     const std::vector<std::vector<std::vector<std::pair<Vector3F, Vector3F> > > >& vertexes);
+        using RVMReader::createFacetGroup;
+        virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
+
+        virtual bool supportsInstances() const;
+        virtual void definePrototype(std::uint32_t prototype);
+        virtual void startGroupInstance(const std::string& name, const Vector3F& translation, const int& materialId,
+                                        std::uint32_t prototype, const std::array<float, 12>& matrix);
 
     private:
 
         void writeMesh(const std::string &gid, const Mesh& mesh, const std::string comment = "");
         void addGeometry(const std::string &gid, const std::array<float, 12> &matrix);
-        std::string getInstanceName(const std::vector<float> &params);
+        bool addUnitGeometry(int type, const float* params, const std::array<float, 12> &matrix, const std::string& comment);
+        std::string getInstanceName(const RVMMeshCache::Key &key);
         std::string createGeometryId();
 
         COLLADASW::StreamWriter* m_writer;
         std::vector<Vector3F> m_translations;
         InstanceMap m_instanceMap;
+        std::unordered_map<std::uint32_t, Vector3F> m_prototypeOrigins;
         CCModel* m_model;
+        // Reused by all the facet groups.
+        Mesh m_facetGroupMesh;
+        RVMVertexWelder m_welder;
+        RVMTriangulator m_triangulator;
 };
 
 #endif // COLLADACONVERTER_H
@@ -115,7 +115,7 @@ void DSLConverter::endMetaData()
 {
 }
 
-void DSLConverter::startMetaDataPair(const string &name, const string &value)
+void DSLConverter::startMetaDataPair(string_view name, string_view value)
 {
 }
 
@@ -193,7 +193,7 @@ void DSLConverter::createLine(const std::array<float, 12> &matrix, const float &
     writeShapeTransforms(shapeid, matrix);
 }
 
-void DSLConverter::createFacetGroup(const std::array<float, 12> &matrix, const vector<vector<vector<pair<Vector3F, Vector3F>>>> &vertexes)
+void DSLConverter::createFacetGroup(const std::array<float, 12> &matrix, const RVMFacetGroup &facetGroup)
 {
     // Not supported.
 }
@@ -33,35 +33,35 @@ DummyReader::~DummyReader() {
 }
 
 void DummyReader::startDocument() {
-    cout << "startDocument" << endl;
+    *m_log << "startDocument" << endl;
 }
 
 void DummyReader::endDocument() {
-    cout << "endDocument" << endl;
+    *m_log << "endDocument" << endl;
 }
 
 void DummyReader::startHeader(const string& banner, const string& fileNote, const string& date, const string& user, const string& encoding) {
-    cout << "startHeader\n  " << banner << "\n  " << fileNote << "\n  " << date << "\n  " << user << "\n  " << encoding << endl;
+    *m_log << "startHeader\n  " << banner << "\n  " << fileNote << "\n  " << date << "\n  " << user << "\n  " << encoding << endl;
 }
 
 void DummyReader::endHeader() {
-    cout << "endHeader" << endl;
+    *m_log << "endHeader" << endl;
 }
 
 void DummyReader::startModel(const string& projectName, const string& name) {
-    cout << "startModel" << endl;
+    *m_log << "startModel" << endl;
 }
 
 void DummyReader::endModel() {
-    cout << "endModel" << endl;
+    *m_log << "endModel" << endl;
 }
 
 void DummyReader::startGroup(const std::string& name, const Vector3F& translation, const int& materialId) {
-    cout << "startGroup\n  " << name << endl;
+    *m_log << "startGroup\n  " << name << endl;
 }
 
 void DummyReader::endGroup() {
-    cout << "endGroup" << endl;
+    *m_log << "endGroup" << endl;
 }
 
 void DummyReader::startMetaData() {
@@ -70,62 +70,62 @@ void DummyReader::startMetaData() {
 void DummyReader::endMetaData() {
 }
 
-void DummyReader::startMetaDataPair(const string &name, const string &value) {
+void DummyReader::startMetaDataPair(string_view name, string_view value) {
 }
 
 void DummyReader::endMetaDataPair() {
 }
 
 void DummyReader::createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params) {
-    cout << "createPyramid" << endl;
+    *m_log << "createPyramid" << endl;
 }
 
 
 void DummyReader::createBox(const std::array<float, 12>& matrix, const Primitives::Box& params) {
-    cout << "createBox" << endl;
+    *m_log << "createBox" << endl;
 }
 
 
 void DummyReader::createRectangularTorus(const std::array<float, 12>& matrix, const Primitives::RectangularTorus& params) {
-    cout << "createRectangularTorus" << endl;
+    *m_log << "createRectangularTorus" << endl;
 }
 
 
 void DummyReader::createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& params) {
-    cout << "createCircularTorus" << endl;
+    *m_log << "createCircularTorus" << endl;
 }
 
 
 void DummyReader::createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& params) {
-    cout << "startEllipticalDish" << endl;
+    *m_log << "startEllipticalDish" << endl;
 }
 
 
 void DummyReader::createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& params) {
-    cout << "createSphericalDish" << endl;
+    *m_log << "createSphericalDish" << endl;
 }
 
 
 void DummyReader::createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& params) {
-    cout << "createSnout" << endl;
+    *m_log << "createSnout" << endl;
 }
 
 
 void DummyReader::createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& params) {
-    cout << "createCylinder" << endl;
+    *m_log << "createCylinder" << endl;
 }
 
 
 void DummyReader::createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& params) {
-    cout << "createSphere" << endl;
+    *m_log << "createSphere" << endl;
 }
 
 
 void DummyReader::createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx) {
-    cout << "createLine" << endl;
+    *m_log << "createLine" << endl;
 }
 
 
-void DummyReader::createFacetGroup(const std::array<float, 12>& matrix,  const vector<vector<vector<pair<Vector3F, Vector3F> > > >& vertexes) {
-    cout << "createFacetGroup" << endl;
+void DummyReader::createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
+    *m_log << "createFacetGroup" << endl;
 }
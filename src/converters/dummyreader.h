@@ -45,7 +45,7 @@ class DummyReader : public RVMReader
         virtual void startMetaData();
         virtual void endMetaData();
 
-        virtual void startMetaDataPair(const std::string& name, const std::string& value);
+        virtual void startMetaDataPair(std::string_view name, std::string_view value);
         virtual void endMetaDataPair();
 
         virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
@@ -68,7 +68,8 @@ class DummyReader : public RVMReader
 
         virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
 
-        virtual void createFacetGroup(const std::array<float, 12>& matrix, const std::vector<std::vector<std::vector<std::pair<Vector3F, Vector3F> > > >& vertexes);
+        using RVMReader::createFacetGroup;
+        virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
 };
 
 #endif // DUMMYREADER_H
@@ -38,6 +38,7 @@
 #include <Eigen/SVD>
 
 #include "../api/rvmcolorhelper.h"
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 
 #include <cassert>
@@ -208,6 +209,72 @@ void IFCConverter::startGroup(const std::string& name, const Vector3F& translati
   m_productChildStack.push(IfcReferenceList{});
   m_productRepresentationStack.push(IfcReferenceList{});
   m_productMetaDataStack.push(IfcReferenceList{});
+  m_instanceStack.push(false);
+}
+
+bool IFCConverter::supportsInstances() const {
+  return true;
+}
+
+void IFCConverter::definePrototype(uint32_t prototype) {
+  // The representations of the groups of the prototype are collected in representation maps.
+  m_openPrototypes.push_back(std::make_pair(prototype, m_productStack.size()));
+  m_prototypeMaps[prototype].clear();
+}
+
+void IFCConverter::startGroupInstance(const std::string& name,
+                                      const Vector3F& translation,
+                                      const int& materialId,
+                                      uint32_t prototype,
+                                      const std::array<float, 12>& matrix) {
+  startGroup(name, translation, materialId);
+  m_instanceStack.top() = true;
+  for (IfcReference map : m_prototypeMaps[prototype]) {
+    m_productRepresentationStack.top().push_back(createMappedItem(map, matrix));
+  }
+}
+
+IfcReference IFCConverter::createMappedItem(IfcReference map, const std::array<float, 12>& matrix) {
+  // https://standards.buildingsmart.org/IFC/RELEASE/IFC2x3/FINAL/HTML/ifcgeometryresource/lexical/ifccartesiantransformationoperator3d.htm
+  // Instances are only found for rotations with a uniform scale, unit meshes are scaled along each axis.
+  float scale[3];
+  for (int i = 0; i < 3; i++) {
+    scale[i] = std::sqrt(matrix[i * 3] * matrix[i * 3] + matrix[i * 3 + 1] * matrix[i * 3 + 1] +
+                         matrix[i * 3 + 2] * matrix[i * 3 + 2]);
+  }
+  const bool uniform = std::abs(scale[1] - scale[0]) <= 1e-4f * scale[0] && std::abs(scale[2] - scale[0]) <= 1e-4f * scale[0];
+  if (uniform) {
+    scale[1] = scale[2] = scale[0];
+  }
+  IfcEntity transformation(uniform ? "IFCCARTESIANTRANSFORMATIONOPERATOR3D"
+                                   : "IFCCARTESIANTRANSFORMATIONOPERATOR3DNONUNIFORM");
+  transformation.attributes = {
+      addCartesianPoint(matrix[0] / scale[0], matrix[1] / scale[0], matrix[2] / scale[0], "IFCDIRECTION"),  // Axis1
+      addCartesianPoint(matrix[3] / scale[1], matrix[4] / scale[1], matrix[5] / scale[1], "IFCDIRECTION"),  // Axis2
+      addCartesianPoint(matrix[9], matrix[10], matrix[11]),                                                 // LocalOrigin
+      scale[0],                                                                                             // Scale
+      addCartesianPoint(matrix[6] / scale[2], matrix[7] / scale[2], matrix[8] / scale[2], "IFCDIRECTION")   // Axis3
+  };
+  if (!uniform) {
+    // https://standards.buildingsmart.org/IFC/RELEASE/IFC2x3/FINAL/HTML/ifcgeometryresource/lexical/ifccartesiantransformationoperator3dnonuniform.htm
+    transformation.attributes.push_back(scale[1]);  // Scale2
+    transformation.attributes.push_back(scale[2]);  // Scale3
+  }
+  auto transformationRef = m_writer->addEntity(transformation);
+
+  // https://standards.buildingsmart.org/IFC/RELEASE/IFC2x3/FINAL/HTML/ifcgeometryresource/lexical/ifcmappeditem.htm
+  IfcEntity item("IFCMAPPEDITEM");
+  item.attributes = {map, transformationRef};
+  return m_writer->addEntity(item);
+}
+
+IfcReference IFCConverter::mappingOrigin() {
+  if (m_mappingOrigin.value == 0) {
+    IfcEntity origin("IFCAXIS2PLACEMENT3D");
+    origin.attributes = {addCartesianPoint(0.0f, 0.0f, 0.0f), IFC_STRING_UNSET, IFC_STRING_UNSET};
+    m_mappingOrigin = m_writer->addEntity(origin);
+  }
+  return m_mappingOrigin;
 }
 
 IfcReference IFCConverter::createPlacement(IfcValue parentPlacement, bool fullDefiniton) {
@@ -302,8 +369,13 @@ void IFCConverter::endGroup() {
   m_productChildStack.pop();
   m_productRepresentationStack.pop();
   m_placementStack.pop();
+  m_instanceStack.pop();
   m_productChildStack.top().push_back(buildingElementRef);
   delete buildingElement;
+
+  if (!m_openPrototypes.empty() && m_openPrototypes.back().second > m_productStack.size()) {
+    m_openPrototypes.pop_back();
+  }
 }
 
 IfcReference IFCConverter::createRepresentation() {
@@ -311,9 +383,28 @@ IfcReference IFCConverter::createRepresentation() {
     return IFC_REFERENCE_UNSET;
   }
   IfcEntity shapeRepresentation("IFCSHAPEREPRESENTATION");
-  shapeRepresentation.attributes = {m_contextRef, "Body", "SurfaceModel", m_productRepresentationStack.top()};
+  shapeRepresentation.attributes = {m_contextRef, "Body", m_instanceStack.top() ? "MappedRepresentation" : "SurfaceModel",
+                                    m_productRepresentationStack.top()};
   auto shapeRepresentationRef = m_writer->addEntity(shapeRepresentation);
 
+  if (!m_openPrototypes.empty()) {
+    // Inside a prototype, the representation is shared with the instances through a map,
+    // and the group itself uses the map without transformation.
+    // https://standards.buildingsmart.org/IFC/RELEASE/IFC2x3/FINAL/HTML/ifcgeometryresource/lexical/ifcrepresentationmap.htm
+    IfcEntity map("IFCREPRESENTATIONMAP");
+    map.attributes = {mappingOrigin(), shapeRepresentationRef};
+    auto mapRef = m_writer->addEntity(map);
+    for (const auto& prototype : m_openPrototypes) {
+      m_prototypeMaps[prototype.first].push_back(mapRef);
+    }
+
+    const std::array<float, 12> identity = {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0};
+    IfcEntity mappedRepresentation("IFCSHAPEREPRESENTATION");
+    mappedRepresentation.attributes = {m_contextRef, "Body", "MappedRepresentation",
+                                       IfcReferenceList{createMappedItem(mapRef, identity)}};
+    shapeRepresentationRef = m_writer->addEntity(mappedRepresentation);
+  }
+
   IfcEntity shape("IFCPRODUCTDEFINITIONSHAPE");
   shape.attributes = {IFC_REFERENCE_UNSET, IFC_REFERENCE_UNSET, IfcReferenceList{shapeRepresentationRef}};
   auto shapeRef = m_writer->addEntity(shape);
@@ -325,11 +416,11 @@ void IFCConverter::startMetaData() {}
 
 void IFCConverter::endMetaData() {}
 
-void IFCConverter::startMetaDataPair(const std::string& name, const std::string& value) {
+void IFCConverter::startMetaDataPair(std::string_view name, std::string_view value) {
   if (!m_productMetaDataStack.empty()) {
     // https://standards.buildingsmart.org/IFC/RELEASE/IFC2x3/FINAL/HTML/ifcpropertyresource/lexical/ifcpropertysinglevalue.htm
     IfcEntity prop("IFCPROPERTYSINGLEVALUE");
-    prop.attributes = {name, IFC_STRING_UNSET, IfcSimpleValue(value), IFC_STRING_UNSET};
+    prop.attributes = {std::string(name), IFC_STRING_UNSET, IfcSimpleValue(std::string(value)), IFC_STRING_UNSET};
     m_productMetaDataStack.top().push_back(m_writer->addEntity(prop));
   }
 }
@@ -337,7 +428,10 @@ void IFCConverter::startMetaDataPair(const std::string& name, const std::string&
 void IFCConverter::endMetaDataPair() {}
 
 void IFCConverter::createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params) {
-  writeMesh(RVMMeshHelper2::makePyramid(params, m_maxSideSize, m_minSides), matrix);
+  if (writeUnitMesh(Pyramid, params.data, matrix)) {
+    return;
+  }
+  writeMesh(*m_meshCache->makePyramid(params, m_maxSideSize, m_minSides), matrix);
 }
 
 void IFCConverter::createBox(const std::array<float, 12>& matrix, const Primitives::Box& params) {
@@ -367,8 +461,8 @@ void IFCConverter::createBox(const std::array<float, 12>& matrix, const Primitiv
     m_productRepresentationStack.top().push_back(boxRef);
     // "SweptSolid"
     addStyleToItem(boxRef);
-  } else {
-    writeMesh(RVMMeshHelper2::makeBox(params, m_maxSideSize, m_minSides), matrix);
+  } else if (!writeUnitMesh(Box, params.len, matrix)) {
+    writeMesh(*m_meshCache->makeBox(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -396,7 +490,7 @@ void IFCConverter::createRectangularTorus(const std::array<float, 12>& matrix,
                                 transform.rotate(Eigen::AngleAxisf(float(0.5 * M_PI), Eigen::Vector3f::UnitY()))
                                     .rotate(Eigen::AngleAxisf(float(0.5 * M_PI), Eigen::Vector3f::UnitX())));
   } else {
-    writeMesh(RVMMeshHelper2::makeRectangularTorus(params, m_maxSideSize, m_minSides), matrix);
+    writeMesh(*m_meshCache->makeRectangularTorus(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -423,8 +517,7 @@ void IFCConverter::createCircularTorus(const std::array<float, 12>& matrix, cons
                                 transform.rotate(Eigen::AngleAxisf(float(0.5 * M_PI), Eigen::Vector3f::UnitY()))
                                     .rotate(Eigen::AngleAxisf(float(0.5 * M_PI), Eigen::Vector3f::UnitX())));
   } else {
-    auto sides = RVMMeshHelper2::infoCircularTorusNumSides(params, m_maxSideSize, m_minSides);
-    writeMesh(RVMMeshHelper2::makeCircularTorus(params, sides.first, sides.second), matrix);
+    writeMesh(*m_meshCache->makeCircularTorus(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -481,8 +574,7 @@ void IFCConverter::createEllipticalDish(const std::array<float, 12>& matrix, con
     addRevolvedAreaSolidToShape(profileRef, axis, float(2.0 * M_PI),
                                 transform.rotate(Eigen::AngleAxisf(float(0.5 * M_PI), Eigen::Vector3f::UnitX())));
   } else {
-    auto sides = RVMMeshHelper2::infoEllipticalDishNumSides(params, m_maxSideSize, m_minSides);
-    writeMesh(RVMMeshHelper2::makeEllipticalDish(params, sides.first, sides.second), matrix);
+    writeMesh(*m_meshCache->makeEllipticalDish(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -541,7 +633,7 @@ void IFCConverter::createSphericalDish(const std::array<float, 12>& matrix, cons
     addRevolvedAreaSolidToShape(profileRef, axis, float(2.0 * M_PI),
                                 transform.rotate(Eigen::AngleAxisf(float(0.5 * M_PI), Eigen::Vector3f::UnitX())));
   } else {
-    writeMesh(RVMMeshHelper2::makeSphericalDish(params, m_maxSideSize, m_minSides), matrix);
+    writeMesh(*m_meshCache->makeSphericalDish(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -549,9 +641,8 @@ void IFCConverter::createSnout(const std::array<float, 12>& matrix, const Primit
   if (params.xtshear() > FLT_EPSILON || params.ytshear() > FLT_EPSILON || params.xbshear() > FLT_EPSILON ||
       params.ybshear() > FLT_EPSILON) {
     createSlopedCylinder(matrix, params);
-  } else {
-    auto sides = RVMMeshHelper2::infoSnoutNumSides(params, m_maxSideSize, m_minSides);
-    writeMesh(RVMMeshHelper2::makeSnout(params, sides), matrix);
+  } else if (!writeUnitMesh(Snout, params.data, matrix)) {
+    writeMesh(*m_meshCache->makeSnout(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -615,8 +706,7 @@ void IFCConverter::createSlopedCylinder(const std::array<float, 12>& matrix, con
 
     // "SweptSolid"
   } else {
-    auto sides = RVMMeshHelper2::infoSnoutNumSides(params, m_maxSideSize, m_minSides);
-    writeMesh(RVMMeshHelper2::makeSnout(params, sides), matrix);
+    writeMesh(*m_meshCache->makeSnout(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -650,9 +740,8 @@ void IFCConverter::createCylinder(const std::array<float, 12>& matrix, const Pri
     // SweptSolid
     addStyleToItem(cylinderRef);
 
-  } else {
-    auto sides = RVMMeshHelper2::infoCylinderNumSides(params, m_maxSideSize, m_minSides);
-    writeMesh(RVMMeshHelper2::makeCylinder(params, sides), matrix);
+  } else if (!writeUnitMesh(Cylinder, params.data, matrix)) {
+    writeMesh(*m_meshCache->makeCylinder(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -704,8 +793,8 @@ void IFCConverter::createSphere(const std::array<float, 12>& matrix, const Primi
     auto axisRef = addCartesianPoint(0, 1, 0, "IFCDIRECTION");
 
     addRevolvedAreaSolidToShape(profileRef, axisRef, 2.0 * (float)M_PI, transform);
-  } else {
-    writeMesh(RVMMeshHelper2::makeSphere(params, m_maxSideSize, m_minSides), matrix);
+  } else if (!writeUnitMesh(Sphere, &params.diameter, matrix)) {
+    writeMesh(*m_meshCache->makeSphere(params, m_maxSideSize, m_minSides), matrix);
   }
 }
 
@@ -735,17 +824,17 @@ void IFCConverter::createLine(const std::array<float, 12>& m, const float& lengt
   addStyleToItem(lineRef);
 }
 
-void IFCConverter::createFacetGroup(const std::array<float, 12>& m, const FGroup& vertices) {
+void IFCConverter::createFacetGroup(const std::array<float, 12>& m, const RVMFacetGroup& facetGroup) {
   Eigen::Matrix4f matrix = toEigenMatrix(m);
 
   IfcReferenceList faceSet;
-  for (unsigned int i = 0; i < vertices.size(); i++) {
+  for (size_t i = 0; i < facetGroup.polygonCount(); i++) {
     IfcReferenceList boundList;
-    for (unsigned int j = 0; j < vertices[i].size(); j++) {
+    for (size_t j = facetGroup.contourBegin(i); j < facetGroup.contourEnd(i); j++) {
       IfcReferenceList vertexList;
-      for (unsigned int k = 0; k < vertices[i][j].size(); k++) {
+      for (const PositionNormalTuple& tuple : facetGroup.contour(j)) {
         // Transform vertex
-        Vector3F v = vertices[i][j].at(k).first;
+        const Vector3F& v = tuple.first;
         Eigen::Vector4f vertex(v.x(), v.y(), v.z(), 1.0f);
         vertex = matrix * vertex;
 
@@ -942,17 +1031,47 @@ void IFCConverter::createParentChildRelation(const IfcReference parent, const If
   m_writer->addEntity(child_relations);
 }
 
-void IFCConverter::writeMesh(const Mesh& mesh, const std::array<float, 12>& m) {
+void IFCConverter::writeMesh(const Mesh& mesh, const std::array<float, 12>& matrix) {
+  auto surfaceModelRef = createSurfaceModel(mesh, matrix);
+  m_productRepresentationStack.top().push_back(surfaceModelRef);
+  addStyleToItem(surfaceModelRef);
+}
+
+bool IFCConverter::writeUnitMesh(int type, const float* params, const std::array<float, 12>& matrix) {
+  RVMMeshCache::UnitPrimitive unit;
+  if (m_primitives || !m_unitMeshes || !m_meshCache->unitPrimitive(type, params, m_maxSideSize, m_minSides, unit)) {
+    return false;
+  }
+  // Each unit mesh is written once as an unstyled representation map, each primitive maps it with its size
+  // in the transformation and gets the style of its group.
+  auto I = m_unitMaps.find(unit.key);
+  if (I == m_unitMaps.end()) {
+    const std::array<float, 12> identity = {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0};
+    IfcEntity shapeRepresentation("IFCSHAPEREPRESENTATION");
+    shapeRepresentation.attributes = {m_contextRef, "Body", "SurfaceModel",
+                                      IfcReferenceList{createSurfaceModel(*m_meshCache->makeUnit(unit), identity)}};
+    auto shapeRepresentationRef = m_writer->addEntity(shapeRepresentation);
+
+    IfcEntity map("IFCREPRESENTATIONMAP");
+    map.attributes = {mappingOrigin(), shapeRepresentationRef};
+    I = m_unitMaps.insert(std::make_pair(unit.key, m_writer->addEntity(map))).first;
+  }
+  auto itemRef = createMappedItem(I->second, unit.transform(matrix));
+  m_productRepresentationStack.top().push_back(itemRef);
+  addStyleToItem(itemRef);
+  return true;
+}
+
+IfcReference IFCConverter::createSurfaceModel(const Mesh& mesh, const std::array<float, 12>& m) {
   Eigen::Matrix4f matrix = toEigenMatrix(m);
 
   IfcReferenceList faceSet;
   // For each triangle
-  for (unsigned int i = 0; i < mesh.positionIndex.size() / 3; i++) {
+  for (size_t i = 0; i < mesh.positionIndex.size() / 3; i++) {
     IfcReferenceList vertexList;
     for (unsigned int j = 0; j < 3; j++) {
-      unsigned long idx = mesh.positionIndex.at(i * 3 + j);
       // Transform vertex
-      Vector3F v = mesh.positions.at(idx);
+      Vector3F v = mesh.position(mesh.positionIndex[i * 3 + j]);
       Eigen::Vector4f vertex(v.x(), v.y(), v.z(), 1.0f);
       vertex = matrix * vertex;
 
@@ -980,10 +1099,7 @@ void IFCConverter::writeMesh(const Mesh& mesh, const std::array<float, 12>& m) {
 
   IfcEntity surfaceModel("IFCFACEBASEDSURFACEMODEL");
   surfaceModel.attributes = {IfcReferenceList{csfRef}};
-  auto surfaceModelRef = m_writer->addEntity(surfaceModel);
-
-  m_productRepresentationStack.top().push_back(surfaceModelRef);
-  addStyleToItem(surfaceModelRef);
+  return m_writer->addEntity(surfaceModel);
 }
 
 void IFCConverter::addStyleToItem(IfcReference item) {
@@ -22,6 +22,7 @@
 #ifndef IFCCONVERTER_H
 #define IFCCONVERTER_H
 
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 #include "../api/rvmreader.h"
 #include "ifcwriter.h"
@@ -32,6 +33,7 @@
 #include <Eigen/Core>
 #include <map>
 #include <stack>
+#include <unordered_map>
 
 typedef Eigen::Transform<float, 3, Eigen::Affine> Transform3f;
 
@@ -59,7 +61,7 @@ class IFCConverter : public RVMReader {
   virtual void startMetaData();
   virtual void endMetaData();
 
-  virtual void startMetaDataPair(const std::string& name, const std::string& value);
+  virtual void startMetaDataPair(std::string_view name, std::string_view value);
   virtual void endMetaDataPair();
 
   virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
@@ -82,7 +84,16 @@ class IFCConverter : public RVMReader {
 
   virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
 
-  virtual void createFacetGroup(const std::array<float, 12>& matrix, const FGroup& vertexes);
+  using RVMReader::createFacetGroup;
+  virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
+
+  virtual bool supportsInstances() const;
+  virtual void definePrototype(std::uint32_t prototype);
+  virtual void startGroupInstance(const std::string& name,
+                                  const Vector3F& translation,
+                                  const int& materialId,
+                                  std::uint32_t prototype,
+                                  const std::array<float, 12>& matrix);
 
  private:
   std::string m_filename;
@@ -100,6 +111,14 @@ class IFCConverter : public RVMReader {
   std::stack<IfcReferenceList> m_productRepresentationStack;
   std::stack<IfcReference> m_placementStack;
   std::stack<int> m_currentMaterial;
+  std::stack<bool> m_instanceStack;
+
+  // Representation maps of each prototype, and prototypes being written with the depth of their group
+  std::map<std::uint32_t, IfcReferenceList> m_prototypeMaps;
+  std::vector<std::pair<std::uint32_t, size_t>> m_openPrototypes;
+  IfcReference m_mappingOrigin;
+  // Representation maps of the unit meshes, @see RVMReader::setUseUnitMeshes
+  std::unordered_map<RVMMeshCache::Key, IfcReference, RVMMeshCache::KeyHash> m_unitMaps;
 
   std::map<int, IfcReference> m_materials;
   std::map<int, IfcReference> m_styles;
@@ -112,8 +131,12 @@ class IFCConverter : public RVMReader {
   void addStyleToItem(IfcReference item);
   void addRevolvedAreaSolidToShape(IfcReference profile, IfcReference axis, float angle, const Transform3f& transform);
   void writeMesh(const Mesh& mesh, const std::array<float, 12>& matrix);
+  bool writeUnitMesh(int type, const float* params, const std::array<float, 12>& matrix);
 
   IfcReference createRepresentation();
+  IfcReference createMappedItem(IfcReference map, const std::array<float, 12>& matrix);
+  IfcReference createSurfaceModel(const Mesh& mesh, const std::array<float, 12>& matrix);
+  IfcReference mappingOrigin();
   IfcReference createMaterial(int id);
   IfcReference createSurfaceStyle(int id);
   IfcReference createCoordinateSystem(const Transform3f& matrix, const Eigen::Vector3f& offset);
@@ -25,6 +25,7 @@
 #include <set>
 
 #include "../api/rvmcolorhelper.h"
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 #include "../common/stringutils.h"
 
@@ -48,7 +49,7 @@ STLConverter::~STLConverter() {
 void STLConverter::startDocument() {}
 
 void STLConverter::endDocument() {
-  cout << "Facets: " << m_facetCount << endl;
+  *m_log << "Facets: " << m_facetCount << endl;
   // cout << "Bounding Box: " << endl;
   // cout << "Min: " << m_boundingBox.min() << "Max: " << m_boundingBox.max() << endl;
 
@@ -88,63 +89,53 @@ void STLConverter::startMetaData() {}
 
 void STLConverter::endMetaData() {}
 
-void STLConverter::startMetaDataPair(const string& name, const string& value) {}
+void STLConverter::startMetaDataPair(string_view name, string_view value) {}
 
 void STLConverter::endMetaDataPair() {}
 
 void STLConverter::createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& pyramid) {
-  writeMesh(matrix, RVMMeshHelper2::makePyramid(pyramid, m_maxSideSize, m_minSides), "RVMPyramid");
+  writeMesh(matrix, *m_meshCache->makePyramid(pyramid, m_maxSideSize, m_minSides), "RVMPyramid");
 }
 
 void STLConverter::createBox(const std::array<float, 12>& matrix, const Primitives::Box& box) {
-  writeMesh(matrix, RVMMeshHelper2::makeBox(box, m_maxSideSize, m_minSides), "RVMBox");
+  writeMesh(matrix, *m_meshCache->makeBox(box, m_maxSideSize, m_minSides), "RVMBox");
 }
 
 void STLConverter::createRectangularTorus(const std::array<float, 12>& matrix,
                                           const Primitives::RectangularTorus& torus) {
-  writeMesh(matrix, RVMMeshHelper2::makeRectangularTorus(torus, m_maxSideSize, m_minSides), "RVMRectangularTorus");
+  writeMesh(matrix, *m_meshCache->makeRectangularTorus(torus, m_maxSideSize, m_minSides), "RVMRectangularTorus");
 }
 
 void STLConverter::createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& torus) {
-  auto sides = RVMMeshHelper2::infoCircularTorusNumSides(torus, m_maxSideSize, m_minSides);
-  writeMesh(matrix, RVMMeshHelper2::makeCircularTorus(torus, sides.first, sides.second), "RVMCircularTorus");
+  writeMesh(matrix, *m_meshCache->makeCircularTorus(torus, m_maxSideSize, m_minSides), "RVMCircularTorus");
 }
 
 void STLConverter::createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& dish) {
-  auto sideInfo = RVMMeshHelper2::infoEllipticalDishNumSides(dish, m_maxSideSize, m_minSides);
-  writeMesh(matrix, RVMMeshHelper2::makeEllipticalDish(dish, sideInfo.first, sideInfo.second), "RVMEllipticalDish");
+  writeMesh(matrix, *m_meshCache->makeEllipticalDish(dish, m_maxSideSize, m_minSides), "RVMEllipticalDish");
 }
 
 void STLConverter::createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& dish) {
-  writeMesh(matrix, RVMMeshHelper2::makeSphericalDish(dish, m_maxSideSize, m_minSides), "RVMSphericalDish");
+  writeMesh(matrix, *m_meshCache->makeSphericalDish(dish, m_maxSideSize, m_minSides), "RVMSphericalDish");
 }
 
 void STLConverter::createSnout(const std::array<float, 12>& matrix, const Primitives::Snout& snout) {
-  writeMesh(matrix,
-            RVMMeshHelper2::makeSnout(snout, RVMMeshHelper2::infoSnoutNumSides(snout, m_maxSideSize, m_minSides)),
-            "RVMSnout");
+  writeMesh(matrix, *m_meshCache->makeSnout(snout, m_maxSideSize, m_minSides), "RVMSnout");
 }
 
 void STLConverter::createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& cylinder) {
-  writeMesh(
-      matrix,
-      RVMMeshHelper2::makeCylinder(cylinder, RVMMeshHelper2::infoCylinderNumSides(cylinder, m_maxSideSize, m_minSides)),
-      "RVMCylinder");
+  writeMesh(matrix, *m_meshCache->makeCylinder(cylinder, m_maxSideSize, m_minSides), "RVMCylinder");
 }
 
 void STLConverter::createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& sphere) {
-  writeMesh(matrix, RVMMeshHelper2::makeSphere(sphere, m_maxSideSize, m_minSides), "RVMSphere");
+  writeMesh(matrix, *m_meshCache->makeSphere(sphere, m_maxSideSize, m_minSides), "RVMSphere");
 }
 
 void STLConverter::createLine(const std::array<float, 12>& matrix, const float& thickness, const float& length) {}
 
-void STLConverter::createFacetGroup(const std::array<float, 12>& matrix,
-                                    const vector<vector<vector<Vertex> > >& vertexes) {
-  Mesh meshData;
+void STLConverter::createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
+  RVMMeshHelper2::tesselateFacetGroup(facetGroup, &m_facetGroupMesh, m_weldTolerance, m_welder, m_triangulator);
 
-  RVMMeshHelper2::tesselateFacetGroup(vertexes, &meshData);
-
-  writeMesh(matrix, meshData, "RVMFacetGroup");
+  writeMesh(matrix, m_facetGroupMesh, "RVMFacetGroup");
 }
 
 Eigen::Vector3f STLConverter::calculateFaceNormal(const Eigen::Vector3f& p1,
@@ -164,14 +155,10 @@ void STLConverter::writeMesh(const std::array<float, 12>& matrix, const Mesh& me
     }
   }
 
-  for (unsigned int i = 0; i < mesh.positionIndex.size(); i += 3) {
-    unsigned int idx1 = mesh.positionIndex.at(i);
-    unsigned int idx2 = mesh.positionIndex.at(i + 1);
-    unsigned int idx3 = mesh.positionIndex.at(i + 2);
-
-    Eigen::Vector3f p1(mesh.positions.at(idx1).m_values);
-    Eigen::Vector3f p2(mesh.positions.at(idx2).m_values);
-    Eigen::Vector3f p3(mesh.positions.at(idx3).m_values);
+  for (size_t i = 0; i < mesh.positionIndex.size(); i += 3) {
+    Eigen::Vector3f p1(&mesh.positions[mesh.positionIndex[i] * 3]);
+    Eigen::Vector3f p2(&mesh.positions[mesh.positionIndex[i + 1] * 3]);
+    Eigen::Vector3f p3(&mesh.positions[mesh.positionIndex[i + 2] * 3]);
 
     p1 = t * p1;
     p2 = t * p2;
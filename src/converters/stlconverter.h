@@ -58,7 +58,7 @@ class STLConverter : public RVMReader {
   virtual void startMetaData();
   virtual void endMetaData();
 
-  virtual void startMetaDataPair(const std::string& name, const std::string& value);
+  virtual void startMetaDataPair(std::string_view name, std::string_view value);
   virtual void endMetaDataPair();
 
   virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& params);
@@ -81,15 +81,18 @@ class STLConverter : public RVMReader {
 
   virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
 
-  virtual void createFacetGroup(
-      const std::array<float, 12>& matrix,
-      const std::vector<std::vector<std::vector<std::pair<Vector3F, Vector3F> > > >& vertexes);
+  using RVMReader::createFacetGroup;
+  virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
 
  private:
   std::ofstream mFile;
   std::vector<Vector3F> m_translations;
   unsigned long m_facetCount;
   Eigen::AlignedBox3f m_boundingBox;
+  // Reused by all the facet groups.
+  Mesh m_facetGroupMesh;
+  RVMVertexWelder m_welder;
+  RVMTriangulator m_triangulator;
 
   Eigen::Vector3f calculateFaceNormal(const Eigen::Vector3f& p1, const Eigen::Vector3f& p2, const Eigen::Vector3f& p3);
 
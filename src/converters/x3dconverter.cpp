@@ -39,6 +39,7 @@
 #include <Eigen/SVD>
 
 #include "../api/rvmcolorhelper.h"
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 #include "../api/vector3f.h"
 #include "../common/stringutils.h"
@@ -176,6 +177,28 @@ void X3DConverter::endGroup() {
     }
 }
 
+bool X3DConverter::supportsInstances() const {
+    // Split files can not share nodes.
+    return !m_split;
+}
+
+void X3DConverter::definePrototype(uint32_t prototype) {
+    m_writers.back()->setSFString(ID::DEF, "P" + toString(static_cast<long long>(prototype)));
+}
+
+void X3DConverter::startGroupInstance(const std::string& name, const Vector3F& translation, const int& materialId,
+                                      uint32_t prototype, const std::array<float, 12>& matrix) {
+    m_materials.push_back(materialId);
+    m_groups.push_back(name);
+    m_translations.push_back(translation);
+
+    // The instance transform holds the prototype and the metadata of the group.
+    startTransform(matrix);
+    startNode(ID::Transform);
+    m_writers.back()->setSFString(ID::USE, "P" + toString(static_cast<long long>(prototype)));
+    endNode(ID::Transform);
+}
+
 void X3DConverter::startMetaData() {
     startNode(ID::MetadataSet);
     m_writers.back()->setSFString(ID::containerField, "metadata");
@@ -185,33 +208,27 @@ void X3DConverter::endMetaData() {
     endNode(ID::MetadataSet); // MetadataSet
 }
 
-void X3DConverter::startMetaDataPair(const string &name, const string &value) {
-    writeMetaDataString(name, value, true);
+void X3DConverter::startMetaDataPair(string_view name, string_view value) {
+    writeMetaDataString(string(name), string(value), true);
 }
 
 void X3DConverter::endMetaDataPair() {
 }
 
 void X3DConverter::createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& pyramid) {
+    if (writeUnitMesh(Pyramid, pyramid.data, matrix)) {
+        return;
+    }
 
     startShape(matrix);
 
-    std::vector<float> params;
-    params.push_back(Pyramid);
-    params.push_back(pyramid.xbottom());
-    params.push_back(pyramid.ybottom());
-    params.push_back(pyramid.xtop());
-    params.push_back(pyramid.ytop());
-    params.push_back(pyramid.height());
-    params.push_back(pyramid.xoffset());
-    params.push_back(pyramid.yoffset());
-
-    pair<string,int> gid = getInstanceName(params);
+    const RVMMeshCache::Key key = m_meshCache->key(Pyramid, pyramid, m_maxSideSize, m_minSides);
+
+    pair<string,int> gid = getInstanceName(key);
     if(gid.first.empty()) {
         gid.first = createGeometryId();
-        Mesh c = RVMMeshHelper2::makePyramid(pyramid, m_maxSideSize, m_minSides);
-        gid.second = startMeshGeometry(c, gid.first);
-        m_instanceMap.insert(std::make_pair(params, gid));
+        gid.second = startMeshGeometry(*m_meshCache->makePyramid(pyramid, m_maxSideSize, m_minSides), gid.first);
+        m_instanceMap.insert(std::make_pair(key, gid));
     } else {
         writeMeshInstance(gid.second, gid.first);
     }
@@ -220,24 +237,23 @@ void X3DConverter::createPyramid(const std::array<float, 12>& matrix, const Prim
 }
 
 void X3DConverter::createBox(const std::array<float, 12>& matrix, const Primitives::Box& box) {
+    if (writeUnitMesh(Box, box.len, matrix)) {
+        return;
+    }
     startShape(matrix);
-    std::vector<float> params;
-    params.push_back(Box);
-    params.push_back(box.len[0]);
-    params.push_back(box.len[1]);
-    params.push_back(box.len[2]);
 
     if (m_primitives) {
         startNode(ID::Box);
         m_writers.back()->setSFVec3f(ID::size, box.len[0], box.len[1], box.len[2]);
         endNode(ID::Box);
     } else {
-        pair<string,int> gid = getInstanceName(params);
+        const RVMMeshCache::Key key = m_meshCache->key(Box, box, m_maxSideSize, m_minSides);
+
+        pair<string,int> gid = getInstanceName(key);
         if(gid.first.empty()) {
             gid.first = createGeometryId();
-            Mesh c = RVMMeshHelper2::makeBox(box, m_maxSideSize, m_minSides);
-            gid.second = startMeshGeometry(c, gid.first);
-            m_instanceMap.insert(std::make_pair(params, gid));
+            gid.second = startMeshGeometry(*m_meshCache->makeBox(box, m_maxSideSize, m_minSides), gid.first);
+            m_instanceMap.insert(std::make_pair(key, gid));
         } else {
             writeMeshInstance(gid.second, gid.first);
         }
@@ -250,19 +266,13 @@ void X3DConverter::createBox(const std::array<float, 12>& matrix, const Primitiv
 void X3DConverter::createRectangularTorus(const std::array<float, 12>& matrix, const Primitives::RectangularTorus& torus) {
 
     startShape(matrix);
-    std::vector<float> params;
-    params.push_back(RectangularTorus);
-    params.push_back(torus.rinside());
-    params.push_back(torus.routside());
-    params.push_back(torus.height());
-    params.push_back(torus.angle());
-
-    pair<string,int> gid = getInstanceName(params);
+    const RVMMeshCache::Key key = m_meshCache->key(RectangularTorus, torus, m_maxSideSize, m_minSides);
+
+    pair<string,int> gid = getInstanceName(key);
     if(gid.first.empty()) {
         gid.first = createGeometryId();
-        Mesh c = RVMMeshHelper2::makeRectangularTorus(torus, m_maxSideSize, m_minSides);
-        gid.second = startMeshGeometry(c, gid.first);
-        m_instanceMap.insert(std::make_pair(params, gid));
+        gid.second = startMeshGeometry(*m_meshCache->makeRectangularTorus(torus, m_maxSideSize, m_minSides), gid.first);
+        m_instanceMap.insert(std::make_pair(key, gid));
     } else {
         writeMeshInstance(gid.second, gid.first);
     }
@@ -274,19 +284,13 @@ void X3DConverter::createRectangularTorus(const std::array<float, 12>& matrix, c
 void X3DConverter::createCircularTorus(const std::array<float, 12>& matrix, const Primitives::CircularTorus& torus) {
     startShape(matrix);
 
-    std::vector<float> params;
-    params.push_back(CircularTorus);
-    params.push_back(torus.offset());
-    params.push_back(torus.radius());
-    params.push_back(torus.angle());
+    const RVMMeshCache::Key key = m_meshCache->key(CircularTorus, torus, m_maxSideSize, m_minSides);
 
-    pair<string,int> gid = getInstanceName(params);
+    pair<string,int> gid = getInstanceName(key);
     if(gid.first.empty()) {
         gid.first = createGeometryId();
-        auto sides = RVMMeshHelper2::infoCircularTorusNumSides(torus, m_maxSideSize, m_minSides);
-        Mesh c = RVMMeshHelper2::makeCircularTorus(torus, sides.first, sides.second);
-        gid.second = startMeshGeometry(c, gid.first);
-        m_instanceMap.insert(std::make_pair(params, gid));
+        gid.second = startMeshGeometry(*m_meshCache->makeCircularTorus(torus, m_maxSideSize, m_minSides), gid.first);
+        m_instanceMap.insert(std::make_pair(key, gid));
     } else {
         writeMeshInstance(gid.second, gid.first);
     }
@@ -297,19 +301,13 @@ void X3DConverter::createCircularTorus(const std::array<float, 12>& matrix, cons
 void X3DConverter::createEllipticalDish(const std::array<float, 12>& matrix, const Primitives::EllipticalDish& dish) {
     startShape(matrix);
 
-    std::vector<float> params;
-    params.push_back(EllipticalDish);
-    params.push_back(dish.diameter());
-    params.push_back(dish.radius());
+    const RVMMeshCache::Key key = m_meshCache->key(EllipticalDish, dish, m_maxSideSize, m_minSides);
 
-    pair<string,int> gid = getInstanceName(params);
+    pair<string,int> gid = getInstanceName(key);
     if(gid.first.empty()) {
         gid.first = createGeometryId();
-        auto sides = RVMMeshHelper2::infoEllipticalDishNumSides(dish, m_maxSideSize, m_minSides);
-        Mesh c = RVMMeshHelper2::makeEllipticalDish(dish, sides.first, sides.second);
-        
-        gid.second = startMeshGeometry(c, gid.first);
-        m_instanceMap.insert(std::make_pair(params, gid));
+        gid.second = startMeshGeometry(*m_meshCache->makeEllipticalDish(dish, m_maxSideSize, m_minSides), gid.first);
+        m_instanceMap.insert(std::make_pair(key, gid));
     } else {
         writeMeshInstance(gid.second, gid.first);
     }
@@ -321,17 +319,13 @@ void X3DConverter::createEllipticalDish(const std::array<float, 12>& matrix, con
 void X3DConverter::createSphericalDish(const std::array<float, 12>& matrix, const Primitives::SphericalDish& dish) {
     startShape(matrix);
 
-    std::vector<float> params;
-    params.push_back(SphericalDish);
-    params.push_back(dish.diameter());
-    params.push_back(dish.height());
+    const RVMMeshCache::Key key = m_meshCache->key(SphericalDish, dish, m_maxSideSize, m_minSides);
 
-    pair<string,int> gid = getInstanceName(params);
+    pair<string,int> gid = getInstanceName(key);
     if(gid.first.empty()) {
         gid.first = createGeometryId();
-        Mesh c = RVMMeshHelper2::makeSphericalDish(dish, m_maxSideSize, m_minSides);
-        gid.second = startMeshGeometry(c, gid.first);
-        m_instanceMap.insert(std::make_pair(params, gid));
+        gid.second = startMeshGeometry(*m_meshCache->makeSphericalDish(dish, m_maxSideSize, m_minSides), gid.first);
+        m_instanceMap.insert(std::make_pair(key, gid));
     } else {
         writeMeshInstance(gid.second, gid.first);
     }
@@ -345,26 +339,18 @@ void X3DConverter::createSnout(const std::array<float, 12>& matrix, const Primit
         cerr << "Error: Found degenerated snout. Skipping data ..." << endl;
         return;
     }
+    if (writeUnitMesh(Snout, snout.data, matrix)) {
+        return;
+    }
     startShape(matrix);
 
-    std::vector<float> params;
-    params.push_back(Snout);
-    params.push_back(snout.dtop());
-    params.push_back(snout.dbottom());
-    params.push_back(snout.height());
-    params.push_back(snout.xoffset());
-    params.push_back(snout.yoffset());
-    params.push_back(snout.xbshear());
-    params.push_back(snout.ybshear());
-    params.push_back(snout.xtshear());
-    params.push_back(snout.ytshear());
-
-    pair<string,int> gid = getInstanceName(params);
+    const RVMMeshCache::Key key = m_meshCache->key(Snout, snout, m_maxSideSize, m_minSides);
+
+    pair<string,int> gid = getInstanceName(key);
     if(gid.first.empty()) {
-        Mesh c = RVMMeshHelper2::makeSnout(snout, RVMMeshHelper2::infoSnoutNumSides(snout, m_maxSideSize, m_minSides));
         gid.first = createGeometryId();
-        gid.second = startMeshGeometry(c, gid.first);
-        m_instanceMap.insert(std::make_pair(params, gid));
+        gid.second = startMeshGeometry(*m_meshCache->makeSnout(snout, m_maxSideSize, m_minSides), gid.first);
+        m_instanceMap.insert(std::make_pair(key, gid));
     } else {
         writeMeshInstance(gid.second, gid.first);
     }
@@ -373,6 +359,9 @@ void X3DConverter::createSnout(const std::array<float, 12>& matrix, const Primit
 }
 
 void X3DConverter::createCylinder(const std::array<float, 12>& matrix, const Primitives::Cylinder& cylinder) {
+    if (writeUnitMesh(Cylinder, cylinder.data, matrix)) {
+        return;
+    }
     startShape(matrix);
 
     if (m_primitives) {
@@ -381,17 +370,13 @@ void X3DConverter::createCylinder(const std::array<float, 12>& matrix, const Pri
         m_writers.back()->setSFFloat(ID::height, cylinder.height());
         endNode(ID::Cylinder);
     } else {
-        std::vector<float> params;
-        params.push_back(Cylinder);
-        params.push_back(cylinder.radius());
-        params.push_back(cylinder.height());
+        const RVMMeshCache::Key key = m_meshCache->key(Cylinder, cylinder, m_maxSideSize, m_minSides);
 
-        pair<string,int> gid = getInstanceName(params);
+        pair<string,int> gid = getInstanceName(key);
         if(gid.first.empty()) {
             gid.first = createGeometryId();
-            Mesh c = RVMMeshHelper2::makeCylinder(cylinder, RVMMeshHelper2::infoCylinderNumSides(cylinder, m_maxSideSize, m_minSides));
-            gid.second = startMeshGeometry(c, gid.first);
-            m_instanceMap.insert(std::make_pair(params, gid));
+            gid.second = startMeshGeometry(*m_meshCache->makeCylinder(cylinder, m_maxSideSize, m_minSides), gid.first);
+            m_instanceMap.insert(std::make_pair(key, gid));
         } else {
             writeMeshInstance(gid.second, gid.first);
         }
@@ -403,22 +388,22 @@ void X3DConverter::createCylinder(const std::array<float, 12>& matrix, const Pri
 }
 
 void X3DConverter::createSphere(const std::array<float, 12>& matrix, const Primitives::Sphere& sphere) {
+    if (writeUnitMesh(Sphere, &sphere.diameter, matrix)) {
+        return;
+    }
     startShape(matrix);
     if (m_primitives) {
         startNode(ID::Sphere);
         m_writers.back()->setSFFloat(ID::radius, sphere.diameter);
         endNode(ID::Sphere);
     } else {
-        std::vector<float> params;
-        params.push_back(Sphere);
-        params.push_back(sphere.diameter);
+        const RVMMeshCache::Key key = m_meshCache->key(Sphere, sphere, m_maxSideSize, m_minSides);
 
-        pair<string,int> gid = getInstanceName(params);
+        pair<string,int> gid = getInstanceName(key);
         if(gid.first.empty()) {
-            Mesh c = RVMMeshHelper2::makeSphere(sphere, m_maxSideSize, m_minSides);
             gid.first = createGeometryId();
-            gid.second = startMeshGeometry(c, gid.first);
-            m_instanceMap.insert(std::make_pair(params, gid));
+            gid.second = startMeshGeometry(*m_meshCache->makeSphere(sphere, m_maxSideSize, m_minSides), gid.first);
+            m_instanceMap.insert(std::make_pair(key, gid));
         } else {
             writeMeshInstance(gid.second, gid.first);
         }
@@ -446,19 +431,33 @@ void X3DConverter::createLine(const std::array<float, 12>& matrix,
 }
 
 
+bool X3DConverter::writeUnitMesh(int type, const float* params, const std::array<float, 12>& matrix) {
+    RVMMeshCache::UnitPrimitive unit;
+    if (m_primitives || !m_unitMeshes || !m_meshCache->unitPrimitive(type, params, m_maxSideSize, m_minSides, unit)) {
+        return false;
+    }
+    // The size of the primitive goes to the transform, the mesh is shared by all the primitives of the same shape.
+    startShape(unit.transform(matrix));
+
+    pair<string,int> gid = getInstanceName(unit.key);
+    if(gid.first.empty()) {
+        gid.first = createGeometryId();
+        gid.second = startMeshGeometry(*m_meshCache->makeUnit(unit), gid.first);
+        m_instanceMap.insert(std::make_pair(unit.key, gid));
+    } else {
+        writeMeshInstance(gid.second, gid.first);
+    }
+    endNode(gid.second);
+    endShape();
+    return true;
+}
+
 int X3DConverter::startMeshGeometry(const Mesh &mesh, const string &id) {
     bool hasNormals = mesh.normals.size() > 0;
     bool hasNormalIndex = mesh.normalIndex.size() > 0;
     int meshType;
 
-    // Not nice, but okay for now
     vector<int> index;
-    vector<float> coordinates;
-    for (unsigned int i = 0; i < mesh.positions.size(); i++) {
-        for (unsigned int j = 0; j < 3; j++) {
-            coordinates.push_back(mesh.positions.at(i)[j]);
-        }
-    }
 
     if(hasNormalIndex) { // We have to use a IndexedFaceSet
         meshType = ID::IndexedFaceSet;
@@ -468,22 +467,24 @@ int X3DConverter::startMeshGeometry(const Mesh &mesh, const string &id) {
         }
         m_writers.back()->setSFBool(ID::solid, false);
 
-        vector<int> nindex;
-        for (unsigned int i = 0; i < mesh.positionIndex.size(); i++) {
-            index.push_back(mesh.positionIndex.at(i));
+        // Faces end with -1
+        index.reserve(mesh.positionIndex.size() / 3 * 4);
+        for (size_t i = 0; i < mesh.positionIndex.size(); i++) {
+            index.push_back(int(mesh.positionIndex[i]));
             if(i%3 == 2) {
                 index.push_back(-1);
             }
         }
         m_writers.back()->setMFInt32(ID::coordIndex, index);
 
-        for (unsigned int i = 0; i < mesh.normalIndex.size(); i++) {
-            nindex.push_back(mesh.normalIndex.at(i));
+        index.clear();
+        for (size_t i = 0; i < mesh.normalIndex.size(); i++) {
+            index.push_back(int(mesh.normalIndex[i]));
             if(i%3 == 2) {
-                nindex.push_back(-1);
+                index.push_back(-1);
             }
         }
-        m_writers.back()->setMFInt32(ID::normalIndex, nindex);
+        m_writers.back()->setMFInt32(ID::normalIndex, index);
     } else {
         meshType = ID::IndexedTriangleSet;
         startNode(meshType);
@@ -491,43 +492,34 @@ int X3DConverter::startMeshGeometry(const Mesh &mesh, const string &id) {
             m_writers.back()->setSFString(ID::DEF, id);
         }
         m_writers.back()->setSFBool(ID::solid, false);
-        for (unsigned int i = 0; i < mesh.positionIndex.size(); i++) {
-            index.push_back(mesh.positionIndex.at(i));
-        }
+        index.resize(mesh.positionIndex.size());
+        mesh.positionIndex.copy(index.data());
         m_writers.back()->setMFInt32(ID::index, index);
     }
 
+    // Positions and normals are already x, y, z arrays
     startNode(ID::Coordinate);
-    m_writers.back()->setMFFloat(ID::point, coordinates);
+    m_writers.back()->setMFFloat(ID::point, mesh.positions);
     endNode(ID::Coordinate);
 
     if(hasNormals) {
-        vector<float> normals;
-        for (unsigned int i = 0; i < mesh.normals.size(); i++) {
-            for (unsigned int j = 0; j < 3; j++) {
-                normals.push_back(mesh.normals.at(i)[j]);
-            }
-        }
-
         startNode(ID::Normal);
-        m_writers.back()->setMFFloat(ID::vector, normals);
+        m_writers.back()->setMFFloat(ID::vector, mesh.normals);
         endNode(ID::Normal);
     }
     return meshType;
 }
 
 
-void X3DConverter::createFacetGroup(const std::array<float, 12>& matrix,
-                             const vector<vector<vector<pair<Vector3F, Vector3F> > > >& vertexes) {
+void X3DConverter::createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup) {
     startShape(matrix);
-    Mesh meshData;
-    RVMMeshHelper2::tesselateFacetGroup(vertexes, &meshData);
-    startMeshGeometry(meshData, "");
+    RVMMeshHelper2::tesselateFacetGroup(facetGroup, &m_facetGroupMesh, m_weldTolerance, m_welder, m_triangulator);
+    startMeshGeometry(m_facetGroupMesh, "");
     endNode(ID::IndexedTriangleSet);
     endShape();
 }
 
-void X3DConverter::startShape(const std::array<float, 12>& matrix) {
+void X3DConverter::startTransform(const std::array<float, 12>& matrix) {
 
     // Finding axis/angle from matrix using Eigen for its bullet proof implementation.
     Eigen::Transform<float, 3, Eigen::Affine> t;
@@ -553,6 +545,10 @@ void X3DConverter::startShape(const std::array<float, 12>& matrix) {
     m_writers.back()->setSFVec3f(ID::translation, translation.x(), translation.y() , translation.z());
     m_writers.back()->setSFRotation(ID::rotation, aa.axis().x(), aa.axis().y(), aa.axis().z(), aa.angle());
     m_writers.back()->setSFVec3f(ID::scale, scale.x(), scale.y(), scale.z());
+}
+
+void X3DConverter::startShape(const std::array<float, 12>& matrix) {
+    startTransform(matrix);
     startNode(ID::Shape);
     startNode(ID::Appearance);
     startNode(ID::Material);
@@ -608,9 +604,9 @@ std::string X3DConverter::createGeometryId() {
         return "G" + toString(static_cast<long long>(m_id++));
 }
 
-std::pair<std::string, int> X3DConverter::getInstanceName(const std::vector<float> &params) {
+std::pair<std::string, int> X3DConverter::getInstanceName(const RVMMeshCache::Key &key) {
     if(!m_split) {
-        X3DInstanceMap::iterator I = m_instanceMap.find(params);
+        X3DInstanceMap::iterator I = m_instanceMap.find(key);
         if(I != m_instanceMap.end()) {
            return (*I).second;
         }
@@ -23,16 +23,17 @@
 #define X3DCONVERTER_H
 
 #include "../api/rvmreader.h"
+#include "../api/rvmmeshcache.h"
 #include "../api/rvmmeshhelper.h"
 
 #include <utility>
-#include <map>
+#include <unordered_map>
 
 namespace XIOT {
     class X3DWriter;
 }
 
-typedef std::map<std::vector<float>, std::pair<std::string,int> > X3DInstanceMap;
+typedef std::unordered_map<RVMMeshCache::Key, std::pair<std::string,int>, RVMMeshCache::KeyHash> X3DInstanceMap;
 
 class X3DConverter : public RVMReader
 {
@@ -55,7 +56,7 @@ class X3DConverter : public RVMReader
         virtual void startMetaData();
         virtual void endMetaData();
 
-        virtual void startMetaDataPair(const std::string& name, const std::string& value);
+        virtual void startMetaDataPair(std::string_view name, std::string_view value);
         virtual void endMetaDataPair();
 
         virtual void createPyramid(const std::array<float, 12>& matrix, const Primitives::Pyramid& pyramid);
@@ -78,10 +79,16 @@ class X3DConverter : public RVMReader
 
         virtual void createLine(const std::array<float, 12>& matrix, const float& startx, const float& endx);
 
-        virtual void createFacetGroup(const std::array<float, 12>& matrix,
-                                     const std::vector<std::vector<std::vector<std::pair<Vector3F, Vector3F> > > >& vertexes);
+        using RVMReader::createFacetGroup;
+        virtual void createFacetGroup(const std::array<float, 12>& matrix, const RVMFacetGroup& facetGroup);
+
+        virtual bool supportsInstances() const;
+        virtual void definePrototype(std::uint32_t prototype);
+        virtual void startGroupInstance(const std::string& name, const Vector3F& translation, const int& materialId,
+                                        std::uint32_t prototype, const std::array<float, 12>& matrix);
 
     private:
+        void startTransform(const std::array<float, 12>& matrix);
         void startShape(const std::array<float, 12>& matrix);
         void endShape();
 
@@ -90,9 +97,10 @@ class X3DConverter : public RVMReader
 
         int startMeshGeometry(const Mesh& mesh, const std::string &id);
         void writeMeshInstance(int meshType, const std::string &use);
+        bool writeUnitMesh(int type, const float* params, const std::array<float, 12>& matrix);
 
         void writeMetaDataString(const std::string &name, const std::string &value, bool isValue = false);
-        std::pair<std::string, int> getInstanceName(const std::vector<float> &params);
+        std::pair<std::string, int> getInstanceName(const RVMMeshCache::Key &key);
         std::string createGeometryId();
 
         X3DInstanceMap m_instanceMap;
@@ -104,6 +112,10 @@ class X3DConverter : public RVMReader
         std::vector<std::string> m_groups;
         bool m_binary;
         std::vector<int> m_nodeStack;
+        // Reused by all the facet groups.
+        Mesh m_facetGroupMesh;
+        RVMVertexWelder m_welder;
+        RVMTriangulator m_triangulator;
 };
 
 #endif // X3DCONVERTER_H
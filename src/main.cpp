@@ -21,11 +21,27 @@
 
 #include <ctime>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
-
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "api/rvmmeshcache.h"
+#include "api/rvmmulticastreader.h"
+#include "api/rvmpipelinereader.h"
 #include "api/rvmparser.h"
 #include "api/rvmprimitive.h"
+#include "api/rvmscenemodel.h"
 #include "converters/colladaconverter.h"
 #include "converters/dslconverter.h"
 #include "converters/dummyreader.h"
@@ -68,12 +84,25 @@ enum optionIndex {
   MINSIDES,
   OBJECT,
   COLOR,
-  SCALE
+  SCALE,
+  INDEX,
+  JOBS,
+  RESYNC,
+  ATTRIBUTES,
+  BATCH,
+  CACHE,
+  TOLERANCE,
+  MESHCACHE,
+  INSTANCES,
+  UNITMESHES,
+  WELD
 };
 
 const option::Descriptor usage[] = {
     {UNKNOWN, 0, "", "", option::Arg::None,
-     "\nusage: pmuc [options] <rvm file 1> ...\n\nChoose at least one format and one file to convert.\nOptions:"},
+     "\nusage: pmuc [options] <rvm file 1> ...\n\nChoose at least one format and one file to convert.\n"
+     "Inputs can also be directories (all their .rvm files), wildcard patterns (dir/*.rvm)\n"
+     "or @<manifest> files listing one input per line.\nOptions:"},
     {HELP, 0, "h", "help", option::Arg::None, "  --help, -h \tPrint usage and exit."},
     {X3D, 0, "", "x3d", option::Arg::None, "  --x3d  \tConvert to X3D XML format."},
     {X3DB, 0, "", "x3db", option::Arg::None, "  --x3db  \tConvert to X3D binary format."},
@@ -84,6 +113,8 @@ const option::Descriptor usage[] = {
     {DSL, 0, "", "dsl", option::Arg::None, "  --dsl  \tConvert to DSL language."},
     {DUMMY, 0, "", "dummy", option::Arg::None, "  --dummy\tPrint out the file structure."},
     {SKIPATT, 0, "", "skipattributes", option::Arg::None, "  --skipattributes \tIgnore attribute file."},
+    {ATTRIBUTES, 0, "", "attributes", option::Arg::Optional,
+     "  --attributes=<names> \tKeep only these attributes: comma separated names, or a regular expression between slashes."},
     {SPLIT, 0, "", "split", option::Arg::None, "  --split \tIf possible split in sub files (Only X3D)."},
     {AGGREGATE, 0, "", "aggregate", option::Arg::Optional,
      "  --aggregate=<name> \tCombine input files in one export file."},
@@ -91,8 +122,27 @@ const option::Descriptor usage[] = {
     {SIDESIZE, 0, "", "maxsidesize", option::Arg::Optional,
      "  --maxsidesize=<length>  \tUsed for tesselation. Default 1000."},
     {MINSIDES, 0, "", "minsides", option::Arg::Optional, "  --minsides=<nb>  \tUsed for tesselation. Default 8."},
+    {TOLERANCE, 0, "", "tolerance", option::Arg::Optional,
+     "  --tolerance=<length>  \tTesselate once primitives whose parameters differ by less than <length>. Default 0 (identical only)."},
+    {MESHCACHE, 0, "", "meshcache", option::Arg::Optional,
+     "  --meshcache=<file>  \tLoad tesselated primitives from <file>, and save them there for the next runs."},
+    {WELD, 0, "", "weld", option::Arg::Optional,
+     "  --weld=<length>  \tMerge the vertices of facet groups closer than <length> with the same normal. Default 0 (identical only)."},
+    {INSTANCES, 0, "", "instances", option::Arg::None,
+     "  --instances  \tWrite repeated groups once and place copies of them (X3D, COLLADA and IFC)."},
+    {UNITMESHES, 0, "", "unitmeshes", option::Arg::None,
+     "  --unitmeshes  \tTesselate boxes, cylinders, spheres, pyramids and snouts once per shape at unit size, and scale them "
+     "in their transform (X3D, COLLADA and IFC)."},
     {TEST, 0, "t", "test", option::Arg::None, "  --test, -t \tOutputs primitive samples for testing purposes."},
     {OBJECT, 0, "", "object", option::Arg::Optional, "  --object=<name> \tExtract only the named object."},
+    {INDEX, 0, "", "index", option::Arg::None,
+     "  --index \tWith --object, seek to the object using a chunk index (<rvm file>.idx, created if needed)."},
+    {CACHE, 0, "", "cache", option::Arg::None,
+     "  --cache \tReplay the model from a binary cache (<rvm file>.cache) when the RVM and ATT files did not change, or create it."},
+    {JOBS, 0, "j", "jobs", option::Arg::Optional, "  --jobs=<n>, -j<n> \tDecode the RVM data with <n> threads. Default 1."},
+    {RESYNC, 0, "", "resync", option::Arg::None, "  --resync \tSkip corrupted parts of the RVM data instead of failing."},
+    {BATCH, 0, "", "batch", option::Arg::None,
+     "  --batch \tConvert <jobs> files at a time, each with its own log file (<output name>.log), then print a summary. The files must have different names."},
     {COLOR, 0, "", "color", option::Arg::Optional, "  --color=<index> \tForce a PDMS color on all objects."},
     {SCALE, 0, "", "scale", option::Arg::Optional, "  --scale=<multiplier> \tScale the model."},
     {0, 0, 0, 0, 0, 0}};
@@ -115,23 +165,385 @@ const string primitiveNames[] = {
     "box",     "snout", "cylinder",       "sphere",       "circulartorus", "rectangulartorus",
     "pyramid", "line",  "ellipticaldish", "sphericaldish"};
 
-void printStats(time_t duration, RVMParser& parser) {
-  cout << "Statistics:" << endl;
-  cout << "  " << parser.nbGroups() << " group(s)" << endl;
-  cout << "  " << parser.nbPyramids() << " pyramid(s)" << endl;
-  cout << "  " << parser.nbBoxes() << " box(es)" << endl;
-  cout << "  " << parser.nbRectangularToruses() << " rectangular torus(es)" << endl;
-  cout << "  " << parser.nbCircularToruses() << " circular torus(es)" << endl;
-  cout << "  " << parser.nbEllipticalDishes() << " elliptical dish(es)" << endl;
-  cout << "  " << parser.nbSphericalDishes() << " spherical dish(es)" << endl;
-  cout << "  " << parser.nbSnouts() << " snout(s)" << endl;
-  cout << "  " << parser.nbCylinders() << " cylinder(s)" << endl;
-  cout << "  " << parser.nbSpheres() << " sphere(s)" << endl;
-  cout << "  " << parser.nbLines() << " line(s)" << endl;
-  cout << "  " << parser.nbFacetGroups() << " facet group(s)" << endl;
-  cout << "  " << parser.nbAttributes() << " attribute(s)" << endl;
-
-  cout << "Conversion done in " << (duration) << " second" << (duration > 1 ? "s" : "") << "." << endl;
+void printCacheStats(ostream& log, const RVMMeshCache& meshCache) {
+  if (meshCache.hits() + meshCache.misses() > 0) {
+    log << "  " << meshCache.hits() << " tesselation cache hit(s), " << meshCache.misses() << " miss(es)" << endl;
+  }
+}
+
+void printStats(ostream& log, time_t duration, RVMParser& parser, const RVMMeshCache& meshCache) {
+  log << "Statistics:" << endl;
+  log << "  " << parser.nbGroups() << " group(s)" << endl;
+  log << "  " << parser.nbPyramids() << " pyramid(s)" << endl;
+  log << "  " << parser.nbBoxes() << " box(es)" << endl;
+  log << "  " << parser.nbRectangularToruses() << " rectangular torus(es)" << endl;
+  log << "  " << parser.nbCircularToruses() << " circular torus(es)" << endl;
+  log << "  " << parser.nbEllipticalDishes() << " elliptical dish(es)" << endl;
+  log << "  " << parser.nbSphericalDishes() << " spherical dish(es)" << endl;
+  log << "  " << parser.nbSnouts() << " snout(s)" << endl;
+  log << "  " << parser.nbCylinders() << " cylinder(s)" << endl;
+  log << "  " << parser.nbSpheres() << " sphere(s)" << endl;
+  log << "  " << parser.nbLines() << " line(s)" << endl;
+  log << "  " << parser.nbFacetGroups() << " facet group(s)" << endl;
+  log << "  " << parser.nbAttributes() << " attribute(s)" << endl;
+  if (parser.nbResyncs() > 0) {
+    log << "  " << parser.nbResyncs() << " corrupted region(s) skipped" << endl;
+  }
+  printCacheStats(log, meshCache);
+
+  log << "Conversion done in " << (duration) << " second" << (duration > 1 ? "s" : "") << "." << endl;
+}
+
+void deleteReaders(vector<RVMReader*>& readers) {
+  for (RVMReader* reader : readers) {
+    delete reader;
+  }
+  readers.clear();
+}
+
+/**
+ * Finds the repeated groups of a parsed model, then writes the model with each reader.
+ * Each format is written by its own thread when there are several.
+ */
+void writeInstances(RVMSceneModel& model, const vector<RVMReader*>& readers, ostream& log) {
+  log << "Found " << model.findInstances() << " copies of repeated groups." << endl;
+  if (readers.size() == 1) {
+    model.replay(*readers.front());
+    return;
+  }
+  vector<thread> threads;
+  for (RVMReader* reader : readers) {
+    threads.emplace_back([&model, reader]() { model.replay(*reader); });
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+}
+
+/// Conversion options, shared by all input files.
+struct Settings {
+  option::Option* options;
+  int minSides;
+  float maxSideSize;
+  int forcedColor;
+  int jobs;
+  float scale;
+  float weldTolerance;
+  string objectName;
+  /// Writes each format on its own thread. Otherwise the formats are written one after the other by the parsing thread.
+  bool pipeline;
+  /// Tesselated primitives, shared by all the conversions.
+  shared_ptr<RVMMeshCache> meshCache;
+};
+
+/// Outcome of the conversion of one file, for the batch summary.
+struct FileResult {
+  string filename;
+  bool success;
+  string error;
+  double seconds;
+  int groups;
+  long attributes;
+};
+
+/**
+ * Converts a file to all the requested formats, in a single parsing pass.
+ * @param log receives the messages and statistics of the conversion.
+ * @return true if the conversion succeeded.
+ */
+bool convertFile(const string& filename, const Settings& settings, ostream& log, FileResult& result) {
+  const chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  time_t start = time(0);
+  // Counts the hits and misses of this conversion only, the cache being shared by all of them.
+  shared_ptr<RVMMeshCache> meshCache = make_shared<RVMMeshCache>(settings.meshCache);
+  vector<RVMReader*> readers;
+  string formats;
+  for (int format = TEST + 1; format <= DUMMY; format++) {
+    if (settings.options[format].count() > 0) {
+      RVMReader* reader;
+      switch (format) {
+        case DUMMY: {
+          reader = new DummyReader;
+        } break;
+
+        case X3D:
+        case X3DB: {
+          string name = !settings.objectName.empty() ? settings.objectName : filename;
+          if (settings.options[SPLIT].count() > 0)
+            name += "_origin";
+          name = name.substr(0, name.rfind(".")) + ".x3d" + (format == X3D ? "" : "b");
+          name = name.substr(name.rfind(PATHSEP) + 1);
+          reader = new X3DConverter(name, format == X3DB);
+        } break;
+
+        case COLLADA: {
+          string name = !settings.objectName.empty() ? settings.objectName : filename;
+          name = name.substr(0, name.rfind(".")) + ".dae";
+          name = name.substr(name.rfind(PATHSEP) + 1);
+          reader = new COLLADAConverter(name);
+        } break;
+
+        case IFC4: {
+          string name = !settings.objectName.empty() ? settings.objectName : filename;
+          name = name.substr(0, name.rfind(".")) + ".ifc";
+          name = name.substr(name.rfind(PATHSEP) + 1);
+          reader = new IFCConverter(name, "IFC4");
+        } break;
+        case IFC2X3: {
+          string name = !settings.objectName.empty() ? settings.objectName : filename;
+          name = name.substr(0, name.rfind(".")) + ".ifc";
+          name = name.substr(name.rfind(PATHSEP) + 1);
+          reader = new IFCConverter(name, "IFC2X3");
+        } break;
+
+        case DSL: {
+          string name = !settings.objectName.empty() ? settings.objectName : filename;
+          name = name.substr(0, name.rfind(".")) + ".dsl3d";
+          name = name.substr(name.rfind(PATHSEP) + 1);
+          reader = new DSLConverter(name);
+        } break;
+
+        case STL: {
+          string name = !settings.objectName.empty() ? settings.objectName : filename;
+          name = name.substr(0, name.rfind(".")) + ".stl";
+          name = name.substr(name.rfind(PATHSEP) + 1);
+          reader = new STLConverter(name);
+        } break;
+      }
+      if (settings.maxSideSize) {
+        reader->setMaxSideSize(settings.maxSideSize);
+      }
+      if (settings.minSides) {
+        reader->setMinSides(settings.minSides);
+      }
+      reader->setUsePrimitives(settings.options[PRIMITIVES].count() > 0);
+      reader->setUseUnitMeshes(settings.options[UNITMESHES].count() > 0);
+      reader->setWeldTolerance(settings.weldTolerance);
+      reader->setSplit(settings.options[SPLIT].count() > 0);
+      reader->setLog(log);
+      reader->setMeshCache(meshCache);
+      readers.push_back(reader);
+      formats += (formats.empty() ? "" : ", ") + formatnames[format];
+    }
+  }
+  log << "\nConverting file " << filename << " to " << formats << "...\n";
+  // Instances are found once the whole model is read.
+  const bool instances = settings.options[INSTANCES].count() > 0;
+  RVMSceneModel model;
+  unique_ptr<RVMReader> pipeline;
+  if (!instances && readers.size() > 1) {
+    pipeline.reset(settings.pipeline ? static_cast<RVMReader*>(new RVMPipelineReader(readers))
+                                     : static_cast<RVMReader*>(new RVMMulticastReader(readers)));
+  }
+  RVMParser parser(instances ? model : pipeline ? *pipeline : *readers.front());
+  parser.setLog(log);
+  if (settings.options[OBJECT].count() > 0) {
+    parser.setObjectName(settings.options[OBJECT].arg);
+  }
+  parser.setUseIndex(settings.options[INDEX].count() > 0);
+  parser.setUseCache(settings.options[CACHE].count() > 0);
+  parser.setJobs(settings.jobs);
+  parser.setResync(settings.options[RESYNC].count() > 0);
+  bool res = settings.options[ATTRIBUTES].count() == 0 || parser.setAttributeFilter(settings.options[ATTRIBUTES].arg);
+  if (settings.forcedColor != -1) {
+    parser.setForcedColor(settings.forcedColor);
+  }
+  parser.setScale(settings.scale);
+
+  if (res) {
+    res = parser.readFile(filename, settings.options[SKIPATT].count() > 0);
+  }
+  if (res && instances) {
+    writeInstances(model, readers, log);
+  }
+  pipeline.reset();
+  deleteReaders(readers);
+
+  result.filename = filename;
+  result.success = res;
+  result.error = res ? "" : parser.lastError();
+  result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  result.groups = parser.nbGroups();
+  result.attributes = parser.nbAttributes();
+  if (!res) {
+    log << "Conversion failed:" << endl;
+    log << "  " << parser.lastError() << endl;
+  } else {
+    printStats(log, time(0) - start, parser, *meshCache);
+  }
+  return res;
+}
+
+/// Matches a file name against a pattern with * and ? wildcards.
+bool matchWildcard(const string& pattern, const string& name, bool caseSensitive) {
+  size_t p = 0, n = 0, star = string::npos, resume = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      resume = n;
+    } else if (p < pattern.size() &&
+               (pattern[p] == '?' || pattern[p] == name[n] ||
+                (!caseSensitive && tolower((unsigned char)pattern[p]) == tolower((unsigned char)name[n])))) {
+      p++;
+      n++;
+    } else if (star != string::npos) {
+      p = star + 1;
+      n = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    p++;
+  }
+  return p == pattern.size();
+}
+
+/// Adds the files of a directory whose name matches a pattern, in alphabetical order.
+bool addMatchingFiles(const filesystem::path& directory, const string& pattern, bool caseSensitive,
+                      vector<string>& files) {
+  error_code error;
+  vector<string> matches;
+  for (filesystem::directory_iterator it(directory.empty() ? filesystem::path(".") : directory, error), end;
+       !error && it != end; it.increment(error)) {
+    const string name = it->path().filename().string();
+    if (it->is_regular_file(error) && matchWildcard(pattern, name, caseSensitive)) {
+      matches.push_back(directory.empty() ? name : (directory / name).string());
+    }
+  }
+  if (error) {
+    cerr << "\nCould not list directory " << directory.string() << ": " << error.message() << "\n";
+    return false;
+  }
+  sort(matches.begin(), matches.end());
+  files.insert(files.end(), matches.begin(), matches.end());
+  return true;
+}
+
+/**
+ * Adds the RVM files designated by a command line input: a file, a directory (all its .rvm files),
+ * a wildcard pattern on file names, or @<manifest>, a text file listing inputs one per line.
+ * @return false if a directory or manifest can not be read.
+ */
+bool expandInput(const string& input, vector<string>& files) {
+  if (input.size() > 1 && input[0] == '@') {
+    ifstream manifest(input.substr(1));
+    if (!manifest) {
+      cerr << "\nCould not read manifest " << input.substr(1) << ".\n";
+      return false;
+    }
+    string line;
+    while (getline(manifest, line)) {
+      // Blank lines and # comments are ignored
+      const size_t first = line.find_first_not_of(" \t\r");
+      if (first == string::npos || line[first] == '#') {
+        continue;
+      }
+      const size_t last = line.find_last_not_of(" \t\r");
+      if (!expandInput(line.substr(first, last - first + 1), files)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const filesystem::path path(input);
+  error_code error;
+  if (filesystem::is_directory(path, error)) {
+    return addMatchingFiles(path, "*.rvm", false, files);
+  }
+  const string pattern = path.filename().string();
+  if (pattern.find_first_of("*?") != string::npos) {
+    return addMatchingFiles(path.parent_path(), pattern, true, files);
+  }
+  files.push_back(input);
+  return true;
+}
+
+/// Name of the log of a file converted in a batch: the same as its outputs, in the current directory.
+string logName(const string& filename) {
+  const string name = filename.substr(0, filename.rfind(".")) + ".log";
+  return name.substr(name.rfind(PATHSEP) + 1);
+}
+
+/**
+ * Converts files concurrently, --jobs files at a time, each on a single thread.
+ * Each conversion writes its messages to a log file named after its output,
+ * and a summary of all the conversions is printed at the end.
+ * @return true if all the conversions succeeded.
+ */
+bool convertBatch(const vector<string>& files, const Settings& settings) {
+  const chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  Settings fileSettings = settings;
+  fileSettings.jobs = 1;
+  // The workers already use all the threads: each one writes the formats of its file itself.
+  fileSettings.pipeline = false;
+  // Outputs and logs are named after the files, in the current directory: files with the same name would overwrite
+  // each other's.
+  map<string, string> lognames;
+  for (const string& file : files) {
+    const auto inserted = lognames.emplace(logName(file), file);
+    if (!inserted.second) {
+      cerr << "\nCan not convert both " << inserted.first->second << " and " << file
+           << " in the same batch: their outputs would have the same names.\n";
+      return false;
+    }
+  }
+  const size_t workers = min(size_t(settings.jobs), files.size());
+  cout << "\nConverting " << files.size() << " file(s), " << workers << " at a time...\n";
+
+  vector<FileResult> results(files.size());
+  atomic<size_t> next(0);
+  mutex lock;
+  size_t done = 0;
+  auto worker = [&]() {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      const string logname = logName(files[i]);
+      ofstream log(logname);
+      if (log) {
+        convertFile(files[i], fileSettings, log, results[i]);
+      } else {
+        results[i].filename = files[i];
+        results[i].success = false;
+        results[i].error = "Could not create " + logname;
+        results[i].seconds = 0;
+        results[i].groups = 0;
+        results[i].attributes = 0;
+      }
+      lock_guard<mutex> guard(lock);
+      cout << "[" << ++done << "/" << files.size() << "] " << files[i] << (results[i].success ? "" : " failed") << endl;
+    }
+  };
+  vector<thread> threads;
+  for (size_t i = 0; i < workers; i++) {
+    threads.emplace_back(worker);
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+
+  size_t width = 4;
+  for (const FileResult& result : results) {
+    width = max(width, result.filename.size());
+  }
+  size_t failures = 0;
+  cout << "\nSummary:\n"
+       << "  " << left << setw(int(width)) << "File" << right << setw(8) << "Status" << setw(10) << "Groups"
+       << setw(12) << "Attributes" << setw(10) << "Seconds" << endl;
+  for (const FileResult& result : results) {
+    cout << "  " << left << setw(int(width)) << result.filename << right << setw(8)
+         << (result.success ? "ok" : "failed") << setw(10) << result.groups << setw(12) << result.attributes
+         << setw(10) << fixed << setprecision(2) << result.seconds;
+    if (!result.success) {
+      cout << "  " << result.error;
+      failures++;
+    }
+    cout << endl;
+  }
+  const double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  cout << files.size() - failures << " file(s) converted, " << failures << " failed, in " << fixed
+       << setprecision(2) << seconds << " seconds." << endl;
+  return failures == 0;
 }
 
 int main(int argc, char** argv) {
@@ -167,6 +579,12 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  if (options[OBJECT].count() > 0 && options[BATCH].count() > 0) {
+    cerr << "\n--object can not be used with --batch: the outputs of all the files would have the same name.\n";
+    option::printUsage(std::cerr, usage);
+    return 1;
+  }
+
   int minSides = 16;
   if (options[MINSIDES].count() > 0) {
     minSides = atoi(options[MINSIDES].arg);
@@ -187,6 +605,26 @@ int main(int argc, char** argv) {
     }
   }
 
+  float tolerance = 0;
+  if (options[TOLERANCE].count() > 0) {
+    tolerance = options[TOLERANCE].arg ? (float)atof(options[TOLERANCE].arg) : -1;
+    if (tolerance < 0) {
+      cout << "\n--tolerance option should be >= 0.\n";
+      option::printUsage(std::cout, usage);
+      return 1;
+    }
+  }
+
+  float weldTolerance = 0;
+  if (options[WELD].count() > 0) {
+    weldTolerance = options[WELD].arg ? (float)atof(options[WELD].arg) : -1;
+    if (weldTolerance < 0) {
+      cout << "\n--weld option should be >= 0.\n";
+      option::printUsage(std::cout, usage);
+      return 1;
+    }
+  }
+
   int forcedColor = -1;
   if (options[COLOR].count()) {
     forcedColor = atoi(options[COLOR].arg);
@@ -197,6 +635,32 @@ int main(int argc, char** argv) {
     }
   }
 
+  int jobs = 1;
+  if (options[JOBS].count()) {
+    jobs = options[JOBS].arg ? atoi(options[JOBS].arg) : 0;
+    if (jobs < 1) {
+      cout << "\n--jobs option should be > 0.\n";
+      option::printUsage(std::cout, usage);
+      return 1;
+    }
+  }
+
+  if (options[ATTRIBUTES].count()) {
+    // Checked once here rather than by each conversion.
+    DummyReader reader;
+    RVMParser parser(reader);
+    if (!options[ATTRIBUTES].arg || !*options[ATTRIBUTES].arg) {
+      cout << "\n--attributes option should list at least one attribute.\n";
+      option::printUsage(std::cout, usage);
+      return 1;
+    }
+    if (!parser.setAttributeFilter(options[ATTRIBUTES].arg)) {
+      cout << "\n--attributes option: " << parser.lastError() << "\n";
+      option::printUsage(std::cout, usage);
+      return 1;
+    }
+  }
+
   float scale = 1.;
   if (options[SCALE].count()) {
     scale = (float)atof(options[SCALE].arg);
@@ -214,6 +678,54 @@ int main(int argc, char** argv) {
     }
   }
 
+  Settings settings;
+  settings.options = options;
+  settings.minSides = minSides;
+  settings.maxSideSize = maxSideSize;
+  settings.forcedColor = forcedColor;
+  settings.jobs = jobs;
+  settings.scale = scale;
+  settings.weldTolerance = weldTolerance;
+  settings.objectName = objectName;
+  settings.pipeline = true;
+  settings.meshCache = make_shared<RVMMeshCache>(tolerance);
+
+  string meshCacheFilename;
+  if (options[MESHCACHE].count() > 0) {
+    if (!options[MESHCACHE].arg || !*options[MESHCACHE].arg) {
+      cout << "\n--meshcache option should name a file.\n";
+      option::printUsage(std::cout, usage);
+      return 1;
+    }
+    meshCacheFilename = options[MESHCACHE].arg;
+    if (settings.meshCache->load(meshCacheFilename)) {
+      cout << "Found tesselation cache file: " << meshCacheFilename << " (" << settings.meshCache->size()
+           << " mesh(es))" << endl;
+    }
+  }
+
+  vector<string> files;
+  for (int file = 0; file < parse.nonOptionsCount(); file++) {
+    if (!expandInput(parse.nonOption(file), files)) {
+      return 1;
+    }
+  }
+  // Inputs listed several times, even through different paths, are converted once. An aggregation keeps them all.
+  if (options[AGGREGATE].count() == 0) {
+    set<string> seen;
+    files.erase(remove_if(files.begin(), files.end(),
+                          [&seen](const string& file) {
+                            error_code error;
+                            const filesystem::path path = filesystem::weakly_canonical(file, error);
+                            return !seen.insert(error ? file : path.string()).second;
+                          }),
+                files.end());
+  }
+  if (files.empty() && options[TEST].count() == 0) {
+    cerr << "\nNo RVM file found.\n";
+    return 1;
+  }
+
   // Testing: outputs primitives in individual files.
   if (options[TEST].count() > 0) {
     cout << "\nWriting primitive example files..." << endl;
@@ -262,6 +774,8 @@ int main(int argc, char** argv) {
             reader->setMinSides(minSides);
           }
           reader->setUsePrimitives(options[PRIMITIVES].count() > 0);
+          reader->setUseUnitMeshes(options[UNITMESHES].count() > 0);
+          reader->setWeldTolerance(weldTolerance);
           reader->setSplit(options[SPLIT].count() > 0);
           vector<float> translation;
           for (int j = 0; j < 3; j++)
@@ -364,12 +878,17 @@ int main(int argc, char** argv) {
   }
 
   // File conversions.
+  // All the requested formats are written from a single parsing pass.
+  int status = 0;
   if (options[AGGREGATE].count() > 0) {
+    time_t start = time(0);
+    string name = options[AGGREGATE].arg;
+    shared_ptr<RVMMeshCache> meshCache = make_shared<RVMMeshCache>(settings.meshCache);
+    vector<RVMReader*> readers;
+    string formats;
     for (int format = TEST + 1; format <= DUMMY; format++) {
       if (options[format].count() > 0) {
-        time_t start = time(0);
         RVMReader* reader;
-        string name = options[AGGREGATE].arg;
         switch (format) {
           case DUMMY: {
             reader = new DummyReader;
@@ -407,120 +926,71 @@ int main(int argc, char** argv) {
           reader->setMinSides(minSides);
         }
         reader->setUsePrimitives(options[PRIMITIVES].count() > 0);
+        reader->setUseUnitMeshes(options[UNITMESHES].count() > 0);
+        reader->setWeldTolerance(weldTolerance);
         reader->setSplit(options[SPLIT].count() > 0);
-        cout << "\nConverting files to " << formatnames[format] << "...\n";
-        RVMParser parser(*reader);
-        if (options[OBJECT].count() > 0) {
-          parser.setObjectName(options[OBJECT].arg);
-        }
-        if (forcedColor != -1) {
-          parser.setForcedColor(forcedColor);
-        }
-        parser.setScale(scale);
-
-        vector<string> files;
-        for (int file = 0; file < parse.nonOptionsCount(); file++) {
-          string filename = parse.nonOption(file);
-          files.push_back(filename);
-        }
-        bool res = parser.readFiles(files, name, options[SKIPATT].count() > 0);
-        delete reader;
-        if (!res) {
-          cout << "Conversion failed:" << endl;
-          cout << "  " << parser.lastError() << endl;
-          return 1;
-        } else {
-          printStats(time(0) - start, parser);
-        }
+        reader->setMeshCache(meshCache);
+        readers.push_back(reader);
+        formats += (formats.empty() ? "" : ", ") + formatnames[format];
       }
     }
-  } else {
-    for (int file = 0; file < parse.nonOptionsCount(); file++) {
-      string filename = parse.nonOption(file);
-      for (int format = TEST + 1; format <= DUMMY; format++) {
-        if (options[format].count() > 0) {
-          time_t start = time(0);
-          RVMReader* reader;
-          switch (format) {
-            case DUMMY: {
-              reader = new DummyReader;
-            } break;
-
-            case X3D:
-            case X3DB: {
-              string name = !objectName.empty() ? objectName : filename;
-              if (options[SPLIT].count() > 0)
-                name += "_origin";
-              name = name.substr(0, name.rfind(".")) + ".x3d" + (format == X3D ? "" : "b");
-              name = name.substr(name.rfind(PATHSEP) + 1);
-              reader = new X3DConverter(name, format == X3DB);
-            } break;
-
-            case COLLADA: {
-              string name = !objectName.empty() ? objectName : filename;
-              name = name.substr(0, name.rfind(".")) + ".dae";
-              name = name.substr(name.rfind(PATHSEP) + 1);
-              reader = new COLLADAConverter(name);
-            } break;
-
-            case IFC4: {
-              string name = !objectName.empty() ? objectName : filename;
-              name = name.substr(0, name.rfind(".")) + ".ifc";
-              name = name.substr(name.rfind(PATHSEP) + 1);
-              reader = new IFCConverter(name, "IFC4");
-            } break;
-            case IFC2X3: {
-              string name = !objectName.empty() ? objectName : filename;
-              name = name.substr(0, name.rfind(".")) + ".ifc";
-              name = name.substr(name.rfind(PATHSEP) + 1);
-              reader = new IFCConverter(name, "IFC2X3");
-            } break;
-
-            case DSL: {
-              string name = !objectName.empty() ? objectName : filename;
-              name = name.substr(0, name.rfind(".")) + ".dsl3d";
-              name = name.substr(name.rfind(PATHSEP) + 1);
-              reader = new DSLConverter(name);
-            } break;
-
-            case STL: {
-              string name = !objectName.empty() ? objectName : filename;
-              name = name.substr(0, name.rfind(".")) + ".stl";
-              name = name.substr(name.rfind(PATHSEP) + 1);
-              reader = new STLConverter(name);
-            } break;
-          }
-          if (maxSideSize) {
-            reader->setMaxSideSize(maxSideSize);
-          }
-          if (minSides) {
-            reader->setMinSides(minSides);
-          }
-          reader->setUsePrimitives(options[PRIMITIVES].count() > 0);
-          reader->setSplit(options[SPLIT].count() > 0);
-          cout << "\nConverting file " << filename << " to " << formatnames[format] << "...\n";
-          RVMParser parser(*reader);
-          if (options[OBJECT].count() > 0) {
-            parser.setObjectName(options[OBJECT].arg);
-          }
-          if (forcedColor != -1) {
-            parser.setForcedColor(forcedColor);
-          }
-          parser.setScale(scale);
+    cout << "\nConverting files to " << formats << "...\n";
+    // Each format is written by its own thread when there are several.
+    const bool instances = options[INSTANCES].count() > 0;
+    RVMSceneModel model;
+    unique_ptr<RVMPipelineReader> pipeline(!instances && readers.size() > 1 ? new RVMPipelineReader(readers) : nullptr);
+    RVMParser parser(instances ? model : pipeline ? *pipeline : *readers.front());
+    if (options[OBJECT].count() > 0) {
+      parser.setObjectName(options[OBJECT].arg);
+    }
+    parser.setUseIndex(options[INDEX].count() > 0);
+    parser.setUseCache(options[CACHE].count() > 0);
+    parser.setJobs(jobs);
+    parser.setResync(options[RESYNC].count() > 0);
+    if (options[ATTRIBUTES].count() > 0 && !parser.setAttributeFilter(options[ATTRIBUTES].arg)) {
+      cout << parser.lastError() << endl;
+      pipeline.reset();
+      deleteReaders(readers);
+      return 1;
+    }
+    if (forcedColor != -1) {
+      parser.setForcedColor(forcedColor);
+    }
+    parser.setScale(scale);
 
-          bool res = parser.readFile(filename, options[SKIPATT].count() > 0);
-          delete reader;
-          if (!res) {
-            cout << "Conversion failed:" << endl;
-            cout << "  " << parser.lastError() << endl;
-            return 1;
-          } else {
-            printStats(time(0) - start, parser);
-          }
-        }
+    bool res = parser.readFiles(files, name, options[SKIPATT].count() > 0);
+    if (res && instances) {
+      writeInstances(model, readers, cout);
+    }
+    pipeline.reset();
+    deleteReaders(readers);
+    if (!res) {
+      cout << "Conversion failed:" << endl;
+      cout << "  " << parser.lastError() << endl;
+      status = 1;
+    } else {
+      printStats(cout, time(0) - start, parser, *meshCache);
+    }
+  } else if (options[BATCH].count() > 0) {
+    status = convertBatch(files, settings) ? 0 : 1;
+  } else {
+    for (const string& filename : files) {
+      FileResult result;
+      if (!convertFile(filename, settings, cout, result)) {
+        status = 1;
+        break;
       }
     }
   }
 
-  return 0;
+  if (settings.meshCache->hits() + settings.meshCache->misses() > 0) {
+    cout << "\nTesselation cache:" << endl;
+    printCacheStats(cout, *settings.meshCache);
+  }
+
+  // Only new meshes are worth writing the cache again.
+  if (!meshCacheFilename.empty() && settings.meshCache->misses() > 0 && !settings.meshCache->save(meshCacheFilename)) {
+    cout << "Could not write tesselation cache file: " << meshCacheFilename << endl;
+  }
+  return status;
 }